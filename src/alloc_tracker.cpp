@@ -0,0 +1,61 @@
+#include "alloc_tracker.h"
+#include <esp_heap_caps.h>
+
+// Zero-initialised, usable from the first allocation on
+StationAllocTracker allocTracker;
+
+static TaskHandle_t ownerTask = nullptr;
+
+void allocTrackerBegin() {
+    ownerTask = xTaskGetCurrentTaskHandle();
+}
+
+#if ALLOC_TRACKING
+
+// Linked with -Wl,--wrap=malloc,... (the lilygo-t-display-diagnostics
+// environment) so every allocation in the firmware, including String,
+// ArduinoJson and framework code, passes through here. IDF components
+// calling heap_caps_malloc() directly are not seen. Sizes are the heap's
+// block sizes, so an allocation and its free cancel out exactly.
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+static size_t blockSize(void* ptr) {
+    return ptr ? heap_caps_get_allocated_size(ptr) : 0;
+}
+
+void* __wrap_malloc(size_t size) {
+    void* ptr = __real_malloc(size);
+    if (ptr) allocTracker.recordAlloc(blockSize(ptr), xTaskGetCurrentTaskHandle() == ownerTask);
+    return ptr;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    void* ptr = __real_calloc(count, size);
+    if (ptr) allocTracker.recordAlloc(blockSize(ptr), xTaskGetCurrentTaskHandle() == ownerTask);
+    return ptr;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    size_t oldSize = blockSize(ptr);
+    void* moved = __real_realloc(ptr, size);
+    if (moved) {
+        allocTracker.recordRealloc(oldSize, blockSize(moved), xTaskGetCurrentTaskHandle() == ownerTask);
+    } else if (size == 0 && ptr) {
+        allocTracker.recordFree(oldSize, xTaskGetCurrentTaskHandle() == ownerTask);
+    }
+    return moved;
+}
+
+void __wrap_free(void* ptr) {
+    if (ptr) allocTracker.recordFree(blockSize(ptr), xTaskGetCurrentTaskHandle() == ownerTask);
+    __real_free(ptr);
+}
+
+}
+
+#endif // ALLOC_TRACKING
@@ -0,0 +1,117 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+struct AllocTagStats {
+    const char* name;
+    uint32_t allocs;     // malloc/calloc/realloc calls while the tag was active
+    uint64_t bytes;      // Block sizes handed out by those calls
+    int32_t retained;    // Bytes allocated minus bytes freed under the tag, grows with leaks
+    uint32_t scopes;     // Times the tag was entered
+};
+
+// Heap usage attributed to subsystems.
+// The owner task (the network task, where the web server allocates) marks which subsystem runs with
+// enter()/leave(); allocations and frees it makes meanwhile are counted for
+// that tag by block size, so what the subsystem kept is its own balance and
+// not a free-heap difference, which would also include whatever the sensing
+// task and the BLE/WiFi stacks allocate on the other core at the same time.
+// A block freed under another tag than it was allocated under moves between
+// the two tags. Allocations from other tasks are only counted in total.
+// Has no constructor so a zero-initialised global is usable before static
+// constructors run, which allocator hooks require.
+template <uint8_t MaxTags>
+class AllocTracker {
+private:
+    AllocTagStats tags[MaxTags];  // Index 0 collects untagged allocations
+    uint8_t tagCount;             // Registered tags, not counting index 0
+    volatile uint8_t current;
+    std::atomic<uint32_t> foreignAllocs;
+    std::atomic<uint32_t> foreignBytes;
+    std::atomic<uint32_t> frees;
+
+public:
+    // Returns the tag index, 0 (untagged) when the table is full
+    uint8_t registerTag(const char* name) {
+        if (tagCount + 1 >= MaxTags) return 0;
+        uint8_t index = ++tagCount;
+        tags[index].name = name;
+        return index;
+    }
+
+    // Only from the owner task
+    void enter(uint8_t tag) {
+        current = tag <= tagCount ? tag : 0;
+        tags[current].scopes++;
+    }
+
+    void leave() { current = 0; }
+
+    // Called from the allocator hooks, must not allocate; sizes are block sizes
+    void recordAlloc(size_t size, bool ownerTask) {
+        if (ownerTask) {
+            AllocTagStats& tag = tags[current];
+            tag.allocs++;
+            tag.bytes += size;
+            tag.retained += (int32_t)size;
+        } else {
+            foreignAllocs.fetch_add(1, std::memory_order_relaxed);
+            foreignBytes.fetch_add((uint32_t)size, std::memory_order_relaxed);
+        }
+    }
+
+    // A realloc counts as one allocation of the new size that gives back the old block
+    void recordRealloc(size_t oldSize, size_t newSize, bool ownerTask) {
+        recordAlloc(newSize, ownerTask);
+        if (ownerTask) tags[current].retained -= (int32_t)oldSize;
+    }
+
+    void recordFree(size_t size, bool ownerTask) {
+        frees.fetch_add(1, std::memory_order_relaxed);
+        if (ownerTask) tags[current].retained -= (int32_t)size;
+    }
+
+    uint8_t getTagCount() const { return tagCount + 1; }
+    const AllocTagStats& getTag(uint8_t index) const { return tags[index]; }
+    const char* getTagName(uint8_t index) const { return index == 0 ? "untagged" : tags[index].name; }
+    uint32_t getForeignAllocs() const { return foreignAllocs.load(std::memory_order_relaxed); }
+    uint32_t getForeignBytes() const { return foreignBytes.load(std::memory_order_relaxed); }
+    uint32_t getFrees() const { return frees.load(std::memory_order_relaxed); }
+
+    uint32_t getTotalAllocs() const {
+        uint32_t total = getForeignAllocs();
+        for (uint8_t i = 0; i <= tagCount; i++) total += tags[i].allocs;
+        return total;
+    }
+
+    void resetCounts() {
+        for (uint8_t i = 0; i <= tagCount; i++) {
+            tags[i].allocs = 0;
+            tags[i].bytes = 0;
+            tags[i].retained = 0;
+            tags[i].scopes = 0;
+        }
+        foreignAllocs.store(0, std::memory_order_relaxed);
+        foreignBytes.store(0, std::memory_order_relaxed);
+        frees.store(0, std::memory_order_relaxed);
+    }
+};
+
+// Share of free heap not usable as one block, 0 (none) to 100
+inline uint8_t heapFragmentationPercent(uint32_t freeHeap, uint32_t largestBlock) {
+    if (freeHeap == 0 || largestBlock >= freeHeap) return 0;
+    return (uint8_t)(100 - (uint64_t)largestBlock * 100 / freeHeap);
+}
+
+typedef AllocTracker<ALLOC_MAX_TAGS> StationAllocTracker;
+extern StationAllocTracker allocTracker;
+
+// Makes the calling task the owner whose allocations are attributed to tags.
+// Called once, by the network task; allocations before that, from setup()
+// and from every other task, are counted under other tasks.
+void allocTrackerBegin();
+
+#endif // ALLOC_TRACKER_H
@@ -0,0 +1,85 @@
+#ifndef API_FIELDS_H
+#define API_FIELDS_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "measurement_store.h"
+
+// Each entry computes and writes exactly one value of the /api/status document,
+// so a ?fields= projection never touches unrequested values. An entry without
+// a writer stands for a group whose fields come from another table, see
+// writeApiFields().
+struct ApiField {
+    const char* name;  // Dotted path, also the document location
+    void (*write)(JsonDocument& doc);
+};
+
+// Writes the fields of a group that `fields` selects, every one of them for a
+// null list; returns how many
+typedef size_t (*ApiGroupWriter)(JsonDocument& doc, const char* group, const char* fields);
+
+// True if `name` matches an entry of the comma-separated `list`, either exactly
+// or as a group prefix ("indoor" selects every "indoor.*" field). Blanks around
+// entries are ignored, empty entries match nothing.
+inline bool isFieldSelected(const char* name, const char* list) {
+    const char* token = list;
+    while (*token) {
+        const char* end = strchr(token, ',');
+        const char* stop = end ? end : token + strlen(token);
+        while (token < stop && *token == ' ') token++;
+        while (stop > token && stop[-1] == ' ') stop--;
+        size_t len = stop - token;
+        if (len > 0 && strncmp(name, token, len) == 0 &&
+            (name[len] == '\0' || name[len] == '.')) {
+            return true;
+        }
+        if (!end) break;
+        token = end + 1;
+    }
+    return false;
+}
+
+// Runs the writer of every field in `fields`, or of the whole table when the
+// list is null or empty; group entries are handed to `writeGroup` at their
+// place in the table. Returns how many fields were written.
+inline size_t writeApiFields(JsonDocument& doc, const ApiField* table, size_t count, const char* fields,
+                             ApiGroupWriter writeGroup = nullptr) {
+    bool all = !fields || !*fields;
+    size_t written = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!table[i].write) {
+            if (writeGroup) written += writeGroup(doc, table[i].name, all ? nullptr : fields);
+        } else if (all || isFieldSelected(table[i].name, fields)) {
+            table[i].write(doc);
+            written++;
+        }
+    }
+    return written;
+}
+
+// The channels of `group` as the store holds them, those `fields` selects or
+// every one for a null list; the ApiGroupWriter behind the channel rows
+inline size_t writeChannelFields(JsonDocument& doc, const MeasurementStore& store,
+                                 const char* group, const char* fields) {
+    size_t written = 0;
+    char path[32];
+    for (uint8_t g = 0; g < CHANNEL_GROUP_COUNT; g++) {
+        if (strcmp(CHANNEL_GROUPS[g].name, group) != 0) continue;
+        for (uint8_t id = CHANNEL_GROUPS[g].first; id < CHANNEL_GROUPS[g].end; id++) {
+            formatChannelPath(path, sizeof(path), (ChannelId)id);
+            if (fields && !isFieldSelected(path, fields)) continue;
+            doc[group][CHANNELS[id].key] = store.value((ChannelId)id);
+            written++;
+        }
+    }
+    return written;
+}
+
+// Every channel of a sample's group under its key, as ?since= items and the station list carry them
+inline void writeChannelValues(JsonObject out, const ChannelSample& sample, ChannelGroup group) {
+    for (uint8_t id = CHANNEL_GROUPS[group].first; id < CHANNEL_GROUPS[group].end; id++) {
+        out[CHANNELS[id].key] = sample.values[id];
+    }
+}
+
+#endif // API_FIELDS_H
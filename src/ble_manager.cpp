@@ -1,13 +1,65 @@
 #include "ble_manager.h"
+#include "sample_ring.h"
+#include "trace.h"
+#include "logger.h"
+#include "measurement_store.h"
+#include "event_bus.h"
 
-BLEManager::BLEManager() : pCharacteristic(nullptr), isConnected(false), isInitialized(false) {
+// getValue<T>() copies sizeof(T) bytes out of the attribute without the
+// heap copy getValue() makes, so each valid frame size needs its own T
+template <size_t Size>
+struct FrameBytes {
+    uint8_t bytes[Size];
+};
+
+template <size_t Size>
+static bool copyFrame(BLECharacteristic* characteristic, uint8_t* out) {
+    FrameBytes<Size> frame = characteristic->getValue<FrameBytes<Size> >();
+    memcpy(out, frame.bytes, Size);
+    return true;
+}
+
+template <uint8_t Count>
+struct BatchFrameReader {
+    static bool read(BLECharacteristic* characteristic, size_t length, uint8_t* out) {
+        if (length == outdoorFrameSize(Count)) return copyFrame<outdoorFrameSize(Count)>(characteristic, out);
+        return BatchFrameReader<Count - 1>::read(characteristic, length, out);
+    }
+};
+
+template <>
+struct BatchFrameReader<0> {
+    static bool read(BLECharacteristic*, size_t, uint8_t*) { return false; }
+};
+
+// False when the length is not that of any frame
+static bool readFrame(BLECharacteristic* characteristic, size_t length, uint8_t* out) {
+    if (length == OUTDOOR_LEGACY_FRAME_SIZE) return copyFrame<OUTDOOR_LEGACY_FRAME_SIZE>(characteristic, out);
+    return BatchFrameReader<OUTDOOR_BATCH_MAX>::read(characteristic, length, out);
+}
+
+static const IndoorDeadband INDOOR_DEADBAND = {
+    BLE_NOTIFY_DEADBAND_TEMPERATURE,
+    BLE_NOTIFY_DEADBAND_HUMIDITY,
+    BLE_NOTIFY_DEADBAND_PRESSURE,
+    BLE_NOTIFY_DEADBAND_IAQ
+};
+
+BLEManager::BLEManager()
+    : pCharacteristic(nullptr), pIndoorCharacteristic(nullptr), indoorFilter(INDOOR_DEADBAND),
+      indoorNotified(0), indoorSuppressed(0), isConnected(false), isInitialized(false),
+      requestedProfile(BLE_PROFILE_BALANCED), profile(BLE_PROFILE_BALANCED),
+      hasPrimary(false), negotiatedMtu(BLE_ATT_MTU_DFLT), pendingSetupCount(0),
+      protocolStats(), links(), eventPending(false) {
     resetData();
 }
 
 void BLEManager::begin() {
     Serial.println("Starting BLE server!");
     BLEDevice::init(BLE_DEVICE_NAME);
-    BLEDevice::setPower(ESP_PWR_LVL_P9);
+    // Offered in the exchange a peer starts; the smaller of the two is used
+    BLEDevice::setMTU(BLE_PREFERRED_MTU);
+    profile = requestedProfile.load();
     setupBLEServer();
     isInitialized = true;
     Serial.println("BLE server initialized");
@@ -15,82 +67,350 @@ void BLEManager::begin() {
 
 void BLEManager::setupBLEServer() {
     BLEServer* pServer = BLEDevice::createServer();
+    pServer->setCallbacks(new ServerCallbacks(this));
     BLEService* pService = pServer->createService(BLE_SERVICE_UUID);
     
+    // NimBLE joins the prepared writes of a long write before onWrite sees
+    // the value, so any frame up to the maximum arrives whole
     pCharacteristic = pService->createCharacteristic(
         BLE_CHARACTERISTIC_UUID,
-        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE,
+        OUTDOOR_FRAME_MAX_SIZE
     );
     
     pCharacteristic->setValue("");
     pCharacteristic->setCallbacks(new CharacteristicCallbacks(this));
+    
+    // Clients subscribe instead of polling; NimBLE adds the CCCD for NOTIFY
+    pIndoorCharacteristic = pService->createCharacteristic(
+        BLE_INDOOR_CHARACTERISTIC_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::NOTIFY,
+        INDOOR_SNAPSHOT_SIZE
+    );
+    uint8_t empty[INDOOR_SNAPSHOT_SIZE] = {0};
+    pIndoorCharacteristic->setValue(empty, sizeof(empty));
     pService->start();
     
     BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
     pAdvertising->addServiceUUID(BLE_SERVICE_UUID);
     pAdvertising->setScanResponse(true);
-    BLEDevice::startAdvertising();
+    applyProfile();
+}
+
+void BLEManager::setProfile(BleProfile newProfile) {
+    requestedProfile = newProfile < BLE_PROFILE_COUNT ? newProfile : BLE_PROFILE_BALANCED;
 }
 
+void BLEManager::applyProfile() {
+    const BleProfileSettings& settings = bleProfileSettings(getProfile());
+    
+    // esp_power_level_t counts up from -12 dBm in 3 dB steps
+    esp_power_level_t power = (esp_power_level_t)((settings.txPowerDbm + 12) / 3);
+    BLEDevice::setPower(power, ESP_BLE_PWR_TYPE_ADV);
+    BLEDevice::setPower(power, ESP_BLE_PWR_TYPE_DEFAULT);
+    
+    // Interval changes only apply to a fresh advertising set
+    BLEAdvertising* pAdvertising = BLEDevice::getAdvertising();
+    bool wasAdvertising = pAdvertising->isAdvertising();
+    if (wasAdvertising) pAdvertising->stop();
+    pAdvertising->setMinInterval(settings.advMin);
+    pAdvertising->setMaxInterval(settings.advMax);
+    pAdvertising->setMinPreferred(settings.connMin);
+    pAdvertising->setMaxPreferred(settings.connMax);
+    if (wasAdvertising || !isInitialized) BLEDevice::startAdvertising();
+    
+    BLEServer* pServer = BLEDevice::getServer();
+    for (uint16_t handle : pServer->getPeerDevices()) {
+        pServer->updateConnParams(handle, settings.connMin, settings.connMax, settings.latency, settings.timeout);
+    }
+    LOGGER_INFO("BLE profile %s: adv %u-%u, conn %u-%u, %d dBm", settings.name,
+                settings.advMin, settings.advMax, settings.connMin, settings.connMax, settings.txPowerDbm);
+}
+
+void BLEManager::completeSetup(uint16_t connHandle, uint32_t nowMs) {
+    for (uint8_t i = 0; i < pendingSetupCount; i++) {
+        if (pendingSetups[i].connHandle != connHandle) continue;
+        profileStats[getProfile()].setupMs.record(nowMs - pendingSetups[i].connectedMs);
+        pendingSetups[i] = pendingSetups[--pendingSetupCount];
+        return;
+    }
+}
+
+void BLEManager::dropSetup(uint16_t connHandle) {
+    for (uint8_t i = 0; i < pendingSetupCount; i++) {
+        if (pendingSetups[i].connHandle == connHandle) {
+            pendingSetups[i] = pendingSetups[--pendingSetupCount];
+            return;
+        }
+    }
+}
+
+// Advertising and connection updates happen here, on one task, rather than
+// in whichever task asked for the change
 void BLEManager::update() {
-    // BLE updates are handled via callbacks
-    // This method can be used for periodic tasks if needed
+    uint8_t requested = requestedProfile.load();
+    if (isInitialized && requested != profile.load()) {
+        profile = requested;
+        applyProfile();
+    }
 }
 
-bool BLEManager::hasNewData() const {
-    return currentData.isValid && currentData.timestamp > 0;
+void BLEManager::publishIndoor(const IndoorSnapshot& snapshot) {
+    if (!isInitialized) return;
+    uint8_t payload[INDOOR_SNAPSHOT_SIZE];
+    encodeIndoorSnapshot(payload, snapshot);
+    // The value also serves reads, so it follows every sample; the deadband only gates notifications
+    pIndoorCharacteristic->setValue(payload, sizeof(payload));
+    if (indoorFilter.update(snapshot)) {
+        pIndoorCharacteristic->notify();
+        indoorNotified++;
+    } else {
+        indoorSuppressed++;
+    }
 }
 
 void BLEManager::resetData() {
-    currentData = {0};
-    currentData.isValid = false;
-    currentData.timestamp = 0;
+    stations.clear();
+    hasPrimary = false;
+    publishViews();
 }
 
-bool BLEManager::validateDataLength(size_t length) const {
-    return length == sizeof(float) * OUTDOOR_VALUES_COUNT;
+// Host task: copies what other tasks may read. Called once per callback, so
+// a reader sees the state between two callbacks, never one halfway through.
+void BLEManager::publishViews() {
+    StationsView& view = stationsScratch;
+    view.count = stations.size();
+    view.primary = primarySlot();
+    for (uint8_t i = 0; i < view.count; i++) {
+        const OutdoorStation& station = stations.get(i);
+        StationView& out = view.stations[i];
+        memcpy(out.address, station.address, STATION_ADDRESS_SIZE);
+        out.data = station.data;
+        out.writes = station.writes;
+        out.lastSeenMs = station.lastSeenMs;
+        out.connected = links[i].connected;
+        out.disconnects = links[i].disconnects;
+        out.metrics = links[i].metrics;
+    }
+    stationsView.write(view);
+    
+    BleStatsView& stats = statsScratch;
+    stats.protocol = protocolStats;
+    stats.transfer = transfer;
+    for (uint8_t i = 0; i < BLE_PROFILE_COUNT; i++) stats.profiles[i] = profileStats[i];
+    stats.mtu = negotiatedMtu;
+    statsView.write(stats);
 }
 
-void BLEManager::parseOutdoorData(const std::string& data) {
-    if (!validateDataLength(data.length())) {
-        Serial.println("Invalid BLE data length received");
-        return;
+// The first station to write becomes primary and stays so until its slot is
+// evicted, then the next station to write takes over; true if `slot` is primary
+bool BLEManager::claimPrimary(uint8_t slot) {
+    const uint8_t* address = stations.get(slot).address;
+    if (hasPrimary && memcmp(primaryAddress, address, STATION_ADDRESS_SIZE) == 0) return true;
+    if (hasPrimary && stations.find(primaryAddress) >= 0) return false;
+    
+    char formatted[18];
+    formatStationAddress(formatted, sizeof(formatted), address);
+    LOGGER_INFO("Outdoor station %s (slot %u) is now primary", formatted, slot);
+    memcpy(primaryAddress, address, STATION_ADDRESS_SIZE);
+    hasPrimary = true;
+    return true;
+}
+
+// Stations are told apart by their identity address, stable across reconnects
+int8_t BLEManager::stationSlot(const ble_gap_conn_desc* desc, uint32_t nowMs) {
+    int8_t slot = stations.lookupOrAdd(desc->peer_id_addr.val, nowMs, BLE_STATION_STALE_MS);
+    if (slot < 0) {
+        LOGGER_WARN("Outdoor station table full (%u), ignoring write", (unsigned)BLE_MAX_STATIONS);
+        return slot;
+    }
+    StationLink& link = links[slot];
+    if (stations.get(slot).writes == 0) {
+        // New in this slot, possibly replacing an evicted station
+        link.metrics.reset();
+        link.reassembler.reset();
+        link.disconnects = 0;
+    }
+    link.connected = true;
+    return slot;
+}
+
+void BLEManager::parseOutdoorData(uint8_t slot, const OutdoorBatch& batch, uint32_t nowMs) {
+    OutdoorData& currentData = stations.get(slot).data;
+    bool primary = claimPrimary(slot);
+    uint8_t accepted = 0;
+    
+    for (uint8_t i = 0; i < batch.count; i++) {
+        const OutdoorSample& sample = batch.samples[i];
+        
+        if (batch.version >= OUTDOOR_PROTOCOL_VERSION) {
+            uint32_t remote = batch.firstSequence + i;
+            uint32_t lost;
+            OutdoorSequenceClass order = classifyOutdoorSequence(currentData.remoteSequence, remote,
+                                                                 BLE_SEQUENCE_RESTART_WINDOW, lost);
+            if (order == OUTDOOR_SEQUENCE_DUPLICATE) {
+                protocolStats.duplicates++;
+                continue;
+            }
+            if (order == OUTDOOR_SEQUENCE_RESTART) {
+                protocolStats.restarts++;
+                LOGGER_INFO("Outdoor station %u restarted at sequence %lu", slot, remote);
+            }
+            protocolStats.lostSamples += lost;
+            currentData.remoteSequence = remote;
+            if (sample.ageSeconds > 0) protocolStats.backfilled++;
+        }
+        
+        ChannelSample& reading = currentData.sample;
+        reading.values[CH_OUTDOOR_TEMPERATURE] = sample.temperature;
+        reading.values[CH_OUTDOOR_HUMIDITY] = sample.humidity;
+        reading.values[CH_OUTDOOR_PRESSURE] = sample.pressure;
+        reading.values[CH_OUTDOOR_BATTERY_VOLTAGE] = sample.batteryVoltage;
+        reading.values[CH_OUTDOOR_BATTERY_PERCENTAGE] = sample.batteryPercentage;
+        reading.isValid = true;
+        reading.timestamp = nowMs - (uint32_t)sample.ageSeconds * 1000;
+        reading.sequence = nextSampleSequence();
+        accepted++;
+        
+        if (primary) primarySamples.push(reading);
+    }
+    
+    // The primary station is the one the outdoor channels follow
+    if (primary && accepted > 0) {
+        measurements().writeSample(CHANNEL_GROUP_OUTDOOR, currentData.sample);
+    }
+    
+    // Posted once the views are published, see onWrite()
+    if (accepted > 0) {
+        pendingEvent = makeEvent(EVENT_OUTDOOR_SAMPLE, slot, currentData.sample.sequence, currentData.sample.timestamp);
+        eventPending = true;
     }
     
-    // Parse the 5 float values from outdoor station
-    memcpy(&currentData.temperature, data.data(), sizeof(float));
-    memcpy(&currentData.humidity, data.data() + sizeof(float), sizeof(float));
-    memcpy(&currentData.pressure, data.data() + 2 * sizeof(float), sizeof(float));
-    memcpy(&currentData.batteryVoltage, data.data() + 3 * sizeof(float), sizeof(float));
-    memcpy(&currentData.batteryPercentage, data.data() + 4 * sizeof(float), sizeof(float));
+    LOGGER_DEBUG("Outdoor station %u updated: v%u, %u samples, T=%.1f, H=%.1f, V=%.2f",
+                 slot, batch.version, batch.count, currentData.sample.values[CH_OUTDOOR_TEMPERATURE],
+                 currentData.sample.values[CH_OUTDOOR_HUMIDITY], currentData.sample.values[CH_OUTDOOR_BATTERY_VOLTAGE]);
+}
+
+// ServerCallbacks implementation
+void BLEManager::ServerCallbacks::onConnect(BLEServer* pServer, ble_gap_conn_desc* desc) {
+    uint32_t now = millis();
+    manager->isConnected = true;
     
-    currentData.isValid = true;
-    currentData.timestamp = millis();
+    BleProfile profile = manager->getProfile();
+    const BleProfileSettings& settings = bleProfileSettings(profile);
+    pServer->updateConnParams(desc->conn_handle, settings.connMin, settings.connMax,
+                              settings.latency, settings.timeout);
     
-    Serial.print("Outdoor data updated: ");
-    Serial.printf("T=%.1f, H=%.1f, P=%.1f, V=%.2f, %%%.1f\n",
-                  currentData.temperature, currentData.humidity, 
-                  currentData.pressure, currentData.batteryVoltage, 
-                  currentData.batteryPercentage);
+    int8_t slot = manager->stations.find(desc->peer_id_addr.val);
+    if (slot >= 0 && manager->links[slot].disconnects > 0) {
+        manager->profileStats[profile].reconnectMs.record(now - manager->links[slot].disconnectedMs);
+    }
+    if (manager->pendingSetupCount < BLE_MAX_STATIONS) {
+        BLEManager::PendingSetup& pending = manager->pendingSetups[manager->pendingSetupCount++];
+        pending.connHandle = desc->conn_handle;
+        pending.connectedMs = now;
+    }
+    
+    // NimBLE stops advertising on connect; keep accepting stations up to the limit
+    if (pServer->getConnectedCount() < BLE_MAX_STATIONS) {
+        BLEDevice::startAdvertising();
+    }
+    manager->publishViews();
+}
+
+void BLEManager::ServerCallbacks::onDisconnect(BLEServer* pServer, ble_gap_conn_desc* desc) {
+    // The leaving connection is still counted here
+    manager->isConnected = pServer->getConnectedCount() > 1;
+    int8_t slot = manager->stations.find(desc->peer_id_addr.val);
+    if (slot >= 0) {
+        manager->links[slot].connected = false;
+        manager->links[slot].disconnects++;
+        manager->links[slot].disconnectedMs = millis();
+    }
+    manager->dropSetup(desc->conn_handle);
+    manager->publishViews();
+}
+
+void BLEManager::ServerCallbacks::onMTUChange(uint16_t MTU, ble_gap_conn_desc* desc) {
+    manager->negotiatedMtu = MTU;
+    LOGGER_INFO("BLE MTU %u on connection %u", MTU, desc->conn_handle);
+    manager->publishViews();
 }
 
 // CharacteristicCallbacks implementation
-void BLEManager::CharacteristicCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
-    std::string serializedData = pCharacteristic->getValue();
-    size_t receivedLength = serializedData.length();
+void BLEManager::CharacteristicCallbacks::onWrite(BLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc) {
+    TRACE_SCOPE("ble.onWrite");
+    manager->eventPending = false;
+    manager->receive(pCharacteristic, desc);
+    manager->publishViews();
+    // Host task, so the sensing task delivers it on its next dispatch and
+    // finds the station views already showing the batch
+    if (manager->eventPending) eventBus().post(EVENT_PRODUCER_BLE, manager->pendingEvent);
+}
+
+// Host task: one write, accepted or not
+void BLEManager::receive(BLECharacteristic* characteristic, const ble_gap_conn_desc* desc) {
+    size_t receivedLength = characteristic->getDataLength();
     
-    Serial.print("Received BLE data length: ");
-    Serial.println(receivedLength);
+    LOGGER_DEBUG("Received BLE data length: %u", receivedLength);
     
-    if (receivedLength == sizeof(float) * OUTDOOR_VALUES_COUNT) {
-        manager->parseOutdoorData(serializedData);
-    } else {
-        Serial.println("Invalid BLE data length!");
-        Serial.print("Raw bytes: ");
-        for (size_t i = 0; i < receivedLength; ++i) {
-            Serial.print((uint8_t)serializedData[i], HEX);
-            Serial.print(" ");
+    if (!readFrame(characteristic, receivedLength, rxFrame)) {
+        protocolStats.rejected++;
+        LOGGER_WARN("Invalid BLE data length %u", receivedLength);
+        return;
+    }
+    
+    uint32_t now = millis();
+    const uint8_t* frame = rxFrame;
+    size_t frameLength = receivedLength;
+    uint32_t elapsedMs = 0;
+    int8_t slot = -1;
+    bool fragment = isOutdoorFragment(rxFrame, receivedLength);
+    transfer.recordWrite(receivedLength, fragment);
+    
+    if (fragment) {
+        slot = stationSlot(desc, now);
+        if (slot < 0) return;
+        OutdoorReassembler& reassembler = links[slot].reassembler;
+        OutdoorReassemblyStatus assembly = reassembler.add(rxFrame, now);
+        if (assembly == OUTDOOR_REASSEMBLY_PENDING) {
+            stations.touch(slot, now);
+            return;
+        }
+        if (assembly != OUTDOOR_REASSEMBLY_COMPLETE) {
+            protocolStats.rejected++;
+            LOGGER_WARN("Dropped fragmented outdoor frame: %s", outdoorReassemblyStatusName(assembly));
+            return;
+        }
+        frame = reassembler.data();
+        frameLength = reassembler.size();
+        elapsedMs = reassembler.getElapsedMs();
+    }
+    
+    OutdoorFrameStatus status = decodeOutdoorFrame(frame, frameLength, rxBatch);
+    if (status != OUTDOOR_FRAME_OK) {
+        if (status == OUTDOOR_FRAME_BAD_CRC) {
+            protocolStats.crcErrors++;
+        } else {
+            protocolStats.rejected++;
         }
-        Serial.println();
+        LOGGER_WARN("Rejected outdoor frame of %u bytes: %s", frameLength, outdoorFrameStatusName(status));
+        return;
+    }
+    
+    if (slot < 0) {
+        slot = stationSlot(desc, now);
+        if (slot < 0) return;
+    }
+    transfer.recordBatch(frameLength, elapsedMs);
+    completeSetup(desc->conn_handle, now);
+    uint32_t gapMs = links[slot].metrics.record(now, BLE_LINK_GAP_FACTOR, BLE_LINK_WARMUP_INTERVALS,
+                                                BLE_LINK_REBASELINE_GAPS);
+    if (gapMs) {
+        LOGGER_INFO("Outdoor station %u back after a %lu s gap", slot, gapMs / 1000);
     }
+    protocolStats.frames++;
+    if (rxBatch.version == 1) protocolStats.legacyFrames++;
+    parseOutdoorData(slot, rxBatch, now);
+    stations.touch(slot, now);
 }
@@ -2,49 +2,195 @@
 #define BLE_MANAGER_H
 
 #include <NimBLEDevice.h>
+#include <atomic>
 #include "config.h"
+#include "station_registry.h"
+#include "outdoor_protocol.h"
+#include "spsc_queue.h"
+#include "indoor_snapshot.h"
+#include "link_metrics.h"
+#include "ble_profile.h"
+#include "histogram.h"
+#include "seqlock.h"
+#include "event_bus.h"
+#include "measurement_store.h"
 
+// A station's newest sample, in the outdoor channels
 struct OutdoorData {
-    float temperature;
-    float humidity;
-    float pressure;
-    float batteryVoltage;
-    float batteryPercentage;
-    bool isValid;
-    unsigned long timestamp;
+    ChannelSample sample;
+    uint32_t remoteSequence;  // Station's own number of the sample, 0 from legacy stations
+};
+
+// Counters over all outdoor writes
+struct OutdoorProtocolStats {
+    uint32_t frames;          // Accepted writes
+    uint32_t legacyFrames;    // Of those, in the version 1 layout
+    uint32_t rejected;        // Bad length, version or fragment order
+    uint32_t crcErrors;
+    uint32_t duplicates;      // Samples already received, e.g. a resent batch
+    uint32_t lostSamples;     // Sequence numbers that never arrived
+    uint32_t restarts;        // Stations that started counting over
+    uint32_t backfilled;      // Samples that arrived after a delay
+};
+
+// Connection side of a station slot, written from the NimBLE host task
+struct StationLink {
+    LinkMetrics metrics;
+    OutdoorReassembler reassembler;
+    bool connected;
+    uint32_t disconnects;
+    uint32_t disconnectedMs;
+};
+
+// Measured while a profile was active
+struct BleProfileStats {
+    LogHistogram<16> setupMs;      // Connection to the first accepted frame
+    LogHistogram<16> reconnectMs;  // A known station's disconnect to its next connection
+};
+
+typedef RegisteredStation<OutdoorData> OutdoorStation;
+typedef StationRegistry<OutdoorData, BLE_MAX_STATIONS> OutdoorStationRegistry;
+
+// Copy of a station slot for tasks other than the NimBLE host task
+struct StationView {
+    uint8_t address[STATION_ADDRESS_SIZE];
+    OutdoorData data;
+    uint32_t writes;
+    uint32_t lastSeenMs;
+    bool connected;
+    uint32_t disconnects;
+    LinkMetrics metrics;
+    
+    LinkFreshness freshness(uint32_t nowMs) const { return metrics.freshness(nowMs, BLE_DATA_STALE_MS); }
+};
+
+struct StationsView {
+    uint8_t count;
+    int8_t primary;  // Slot of the primary station, -1 until one has written
+    StationView stations[BLE_MAX_STATIONS];
+    
+    LinkFreshness freshness(int8_t slot, uint32_t nowMs) const {
+        return slot >= 0 && slot < count ? stations[slot].freshness(nowMs) : LINK_FRESH_NONE;
+    }
+};
+
+// Counters the NimBLE host task keeps, as of its latest callback
+struct BleStatsView {
+    OutdoorProtocolStats protocol;
+    OutdoorTransferMeter transfer;
+    BleProfileStats profiles[BLE_PROFILE_COUNT];
+    uint16_t mtu;  // Of the latest connection
 };
 
 class BLEManager {
 private:
     BLECharacteristic* pCharacteristic;
-    OutdoorData currentData;
+    BLECharacteristic* pIndoorCharacteristic;
+    DeadbandFilter indoorFilter;  // Sensing task only
+    std::atomic<uint32_t> indoorNotified;
+    std::atomic<uint32_t> indoorSuppressed;
     bool isConnected;
     bool isInitialized;
+    // Any task asks for a profile, the sensing task applies it in update();
+    // the host callbacks read the applied one
+    std::atomic<uint8_t> requestedProfile;
+    std::atomic<uint8_t> profile;
+    
+    // Everything from here to the views is written and read only on the
+    // NimBLE host task; other tasks read the views it publishes
+    OutdoorStationRegistry stations;
+    // The station the outdoor channels follow, kept by address so an eviction
+    // of its slot cannot silently hand them to another station
+    uint8_t primaryAddress[STATION_ADDRESS_SIZE];
+    bool hasPrimary;
+    uint16_t negotiatedMtu;
+    BleProfileStats profileStats[BLE_PROFILE_COUNT];
+    
+    // Connections still waiting for their first frame
+    struct PendingSetup {
+        uint16_t connHandle;
+        uint32_t connectedMs;
+    };
+    PendingSetup pendingSetups[BLE_MAX_STATIONS];
+    uint8_t pendingSetupCount;
+    
+    uint8_t rxFrame[OUTDOOR_FRAME_MAX_SIZE];
+    OutdoorBatch rxBatch;
+    OutdoorProtocolStats protocolStats;
+    OutdoorTransferMeter transfer;
+    StationLink links[BLE_MAX_STATIONS];  // By station slot
+    // Every sample of the primary station, in order, for the network task's sample ring
+    SpscQueue<ChannelSample, BLE_SAMPLE_QUEUE_SIZE> primarySamples;
+    bool eventPending;  // An outdoor event for the write being handled
+    Event pendingEvent;
+    
+    // Published by the host task at the end of each callback, built in the
+    // scratch copies to keep them off its stack
+    SeqLock<StationsView> stationsView;
+    SeqLock<BleStatsView> statsView;
+    StationsView stationsScratch;
+    BleStatsView statsScratch;
     
     class CharacteristicCallbacks : public BLECharacteristicCallbacks {
     private:
         BLEManager* manager;
     public:
         CharacteristicCallbacks(BLEManager* mgr) : manager(mgr) {}
-        void onWrite(BLECharacteristic* pCharacteristic) override;
+        void onWrite(BLECharacteristic* pCharacteristic, ble_gap_conn_desc* desc) override;
+    };
+    
+    // Keeps advertising while there is room for more stations
+    class ServerCallbacks : public BLEServerCallbacks {
+    private:
+        BLEManager* manager;
+    public:
+        ServerCallbacks(BLEManager* mgr) : manager(mgr) {}
+        void onConnect(BLEServer* pServer, ble_gap_conn_desc* desc) override;
+        void onDisconnect(BLEServer* pServer, ble_gap_conn_desc* desc) override;
+        void onMTUChange(uint16_t MTU, ble_gap_conn_desc* desc) override;
     };
     
     void setupBLEServer();
-    void parseOutdoorData(const std::string& data);
-    bool validateDataLength(size_t length) const;
+    void applyProfile();
+    void completeSetup(uint16_t connHandle, uint32_t nowMs);
+    void dropSetup(uint16_t connHandle);
+    int8_t stationSlot(const ble_gap_conn_desc* desc, uint32_t nowMs);
+    bool claimPrimary(uint8_t slot);
+    int8_t primarySlot() const { return hasPrimary ? stations.find(primaryAddress) : -1; }
+    void receive(BLECharacteristic* characteristic, const ble_gap_conn_desc* desc);
+    void parseOutdoorData(uint8_t slot, const OutdoorBatch& batch, uint32_t nowMs);
+    void publishViews();
     
 public:
     BLEManager();
     
     void begin();
+    // Sensing task: applies a requested profile change
     void update();
-    OutdoorData getData() const { return currentData; }
-    bool hasNewData() const;
     bool isBLEConnected() const { return isConnected; }
     bool isReady() const { return isInitialized; }
     
-    // Data validation
-    bool isOutdoorDataValid() const { return currentData.isValid; }
+    // Consistent copies of the host task's state, from any task. The
+    // primary station is the one history and the sample ring follow.
+    void getStations(StationsView& out) const { stationsView.read(out); }
+    void getStats(BleStatsView& out) const { statsView.read(out); }
+    
+    // Next sample of the primary station, including backfilled ones; network task only
+    bool popSample(ChannelSample& sample) { return primarySamples.pop(sample); }
+    uint32_t getSampleQueueDrops() const { return primarySamples.getRejected(); }
+    
+    // Safe from any task. Applied by the next update(), including to connected
+    // stations; before begin() it is the profile begin() starts with
+    void setProfile(BleProfile newProfile);
+    BleProfile getProfile() const { return (BleProfile)profile.load(); }
+    
+    // Keeps the readable value current, notifies subscribed clients only when the
+    // snapshot moved past the deadband; sensing task only
+    void publishIndoor(const IndoorSnapshot& snapshot);
+    uint32_t getIndoorNotifications() const { return indoorNotified.load(); }
+    uint32_t getIndoorSuppressed() const { return indoorSuppressed.load(); }
+    
+    // Host task, or before begin()
     void resetData();
 };
 
@@ -0,0 +1,83 @@
+#ifndef BLE_PROFILE_H
+#define BLE_PROFILE_H
+
+#include <Arduino.h>
+
+// Radio settings traded between latency and power, in the units the
+// controller takes: advertising interval 0.625 ms, connection interval
+// 1.25 ms, supervision timeout 10 ms. The connection values are what
+// the station asks a peer for after it connects; the peer may refuse.
+
+enum BleProfile : uint8_t {
+    BLE_PROFILE_LOW_LATENCY,
+    BLE_PROFILE_BALANCED,
+    BLE_PROFILE_LOW_POWER,
+    BLE_PROFILE_COUNT
+};
+
+struct BleProfileSettings {
+    const char* name;        // Stored in the configuration and shown on the config page
+    const char* label;
+    uint16_t advMin;         // 0.625 ms
+    uint16_t advMax;
+    int8_t txPowerDbm;       // One of the ESP32 levels, -12 to +9 in steps of 3
+    uint16_t connMin;        // 1.25 ms
+    uint16_t connMax;
+    uint16_t latency;        // Connection events the peripheral may skip
+    uint16_t timeout;        // 10 ms
+};
+
+static const BleProfileSettings BLE_PROFILES[BLE_PROFILE_COUNT] = {
+    {"low_latency", "Low latency",  32,   64, 9,  6,  12, 0, 200},  // Adv 20-40 ms, conn 7.5-15 ms, 2 s timeout
+    {"balanced",    "Balanced",    160,  240, 3, 24,  40, 0, 400},  // Adv 100-150 ms, conn 30-50 ms, 4 s timeout
+    {"low_power",   "Low power",   800, 1600, 0, 80, 160, 4, 600},  // Adv 0.5-1 s, conn 100-200 ms skipping 4, 6 s timeout
+};
+
+inline const BleProfileSettings& bleProfileSettings(BleProfile profile) {
+    return BLE_PROFILES[profile < BLE_PROFILE_COUNT ? profile : BLE_PROFILE_BALANCED];
+}
+
+// Profile stored under name; false leaves profile unchanged
+inline bool bleProfileFromName(const char* name, BleProfile& profile) {
+    for (uint8_t i = 0; i < BLE_PROFILE_COUNT; i++) {
+        if (strcmp(BLE_PROFILES[i].name, name) == 0) {
+            profile = (BleProfile)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline float bleAdvIntervalMs(uint16_t units) { return units * 0.625f; }
+inline float bleConnIntervalMs(uint16_t units) { return units * 1.25f; }
+
+// Rough radio current model, for comparing profiles rather than for a
+// battery budget. TX draw is a linear fit of the ESP32 datasheet figures
+// (about 130 mA at +9 dBm), RX about 100 mA. An advertising event sends a
+// 31-byte packet on three channels and listens briefly after each; an
+// idle connection event is one empty packet each way. Every event also
+// pays about a millisecond of radio wake-up at 40 mA. Charge per event in
+// microcoulombs (ms x mA) times events per second gives microamps.
+inline float bleTxCurrentMa(int8_t dbm) { return 112.0f + 2.0f * dbm; }
+
+inline float bleAdvEventChargeUc(int8_t dbm) {
+    return 3 * (0.376f * bleTxCurrentMa(dbm) + 0.15f * 100.0f) + 1.0f * 40.0f;
+}
+
+inline float bleConnEventChargeUc(int8_t dbm) {
+    return 0.08f * bleTxCurrentMa(dbm) + 0.3f * 100.0f + 1.0f * 40.0f;
+}
+
+// Average radio current while advertising, taking the middle of the interval range
+inline uint32_t bleAdvertisingCurrentUa(const BleProfileSettings& profile) {
+    float intervalMs = bleAdvIntervalMs((profile.advMin + profile.advMax) / 2);
+    return (uint32_t)(bleAdvEventChargeUc(profile.txPowerDbm) * 1000.0f / intervalMs);
+}
+
+// Average radio current per idle connection at the longest interval, which peers usually pick
+inline uint32_t bleConnectedCurrentUa(const BleProfileSettings& profile) {
+    float intervalMs = bleConnIntervalMs(profile.connMax) * (1 + profile.latency);
+    return (uint32_t)(bleConnEventChargeUc(profile.txPowerDbm) * 1000.0f / intervalMs);
+}
+
+#endif // BLE_PROFILE_H
@@ -0,0 +1,221 @@
+#ifndef CHART_DOWNSAMPLER_H
+#define CHART_DOWNSAMPLER_H
+
+#include <Arduino.h>
+
+enum ChartMode : uint8_t {
+    CHART_MODE_LTTB = 0,   // Largest-Triangle-Three-Buckets, one point per bucket
+    CHART_MODE_MINMAX      // Minimum and maximum of every bucket
+};
+
+// Streaming time-bucketed downsampler for chart data.
+// Points must arrive in ascending x order. The x range is split into
+// `width` equal buckets, so gaps in the data simply leave buckets empty.
+// LTTB needs two passes over the data: accumulate() then select()/finish().
+// Min/max needs only select()/finish(). Memory is O(MaxBuckets), independent
+// of the number of input points.
+template <size_t MaxBuckets>
+class ChartDownsampler {
+private:
+    struct Bucket {
+        uint64_t sumX;   // After prepareSelect(): average x of the next non-empty bucket
+        float sumY;      // After prepareSelect(): average y of the next non-empty bucket
+        uint32_t count;  // After prepareSelect(): non-zero if a next bucket exists
+    };
+
+    Bucket buckets[MaxBuckets];
+    uint32_t xStart;
+    uint32_t xEnd;
+    size_t bucketCount;
+    ChartMode mode;
+
+    // Pass 1 state
+    uint32_t lastX;
+    float lastY;
+    bool hasLast;
+
+    // Pass 2 state
+    bool hasAnchor;
+    uint32_t anchorX;
+    float anchorY;
+    long currentBucket;
+    uint32_t bestX;
+    float bestY;
+    float bestArea;
+    uint32_t minX, maxX;
+    float minY, maxY;
+    bool bucketHasPoint;
+    uint32_t finalX;
+    float finalY;
+    size_t emitted;
+
+    size_t bucketOf(uint32_t x) const {
+        if (x <= xStart) return 0;
+        uint64_t offset = (uint64_t)(x - xStart) * bucketCount / ((uint64_t)(xEnd - xStart) + 1);
+        return offset >= bucketCount ? bucketCount - 1 : (size_t)offset;
+    }
+
+    template <typename Emit>
+    void emitPoint(uint32_t x, float y, Emit& emit) {
+        emit(x, y);
+        emitted++;
+    }
+
+    template <typename Emit>
+    void flushBucket(Emit& emit) {
+        if (!bucketHasPoint) return;
+        if (mode == CHART_MODE_LTTB) {
+            emitPoint(bestX, bestY, emit);
+            anchorX = bestX;
+            anchorY = bestY;
+        } else if (minX == maxX) {
+            emitPoint(minX, minY, emit);
+        } else if (minX < maxX) {
+            emitPoint(minX, minY, emit);
+            emitPoint(maxX, maxY, emit);
+        } else {
+            emitPoint(maxX, maxY, emit);
+            emitPoint(minX, minY, emit);
+        }
+        bucketHasPoint = false;
+    }
+
+public:
+    ChartDownsampler()
+        : xStart(0), xEnd(0), bucketCount(0), mode(CHART_MODE_LTTB) {
+        begin(0, 0, 1, CHART_MODE_LTTB);
+    }
+
+    // Returns the bucket count actually used (clamped to MaxBuckets)
+    size_t begin(uint32_t rangeStart, uint32_t rangeEnd, size_t width, ChartMode chartMode) {
+        xStart = rangeStart;
+        xEnd = rangeEnd < rangeStart ? rangeStart : rangeEnd;
+        bucketCount = width == 0 ? 1 : (width > MaxBuckets ? MaxBuckets : width);
+        mode = chartMode;
+        memset(buckets, 0, sizeof(buckets));
+        hasLast = false;
+        lastX = 0;
+        lastY = 0;
+        hasAnchor = false;
+        anchorX = 0;
+        anchorY = 0;
+        currentBucket = -1;
+        bestX = minX = maxX = finalX = 0;
+        bestY = minY = maxY = finalY = 0;
+        bestArea = 0;
+        bucketHasPoint = false;
+        emitted = 0;
+        return bucketCount;
+    }
+
+    bool needsAveragePass() const { return mode == CHART_MODE_LTTB; }
+
+    // Pass 1 (LTTB only): bucket sums
+    void accumulate(uint32_t x, float y) {
+        Bucket& bucket = buckets[bucketOf(x)];
+        bucket.sumX += x;
+        bucket.sumY += y;
+        bucket.count++;
+        lastX = x;
+        lastY = y;
+        hasLast = true;
+    }
+
+    // Between passes: replace each bucket by the average of the next non-empty one
+    void prepareSelect() {
+        bool hasNext = hasLast;
+        uint64_t nextX = lastX;
+        float nextY = lastY;
+        for (size_t i = bucketCount; i-- > 0; ) {
+            Bucket& bucket = buckets[i];
+            bool nonEmpty = bucket.count > 0;
+            uint64_t avgX = nonEmpty ? bucket.sumX / bucket.count : 0;
+            float avgY = nonEmpty ? bucket.sumY / bucket.count : 0;
+            bucket.sumX = nextX;
+            bucket.sumY = nextY;
+            bucket.count = hasNext ? 1 : 0;
+            if (nonEmpty) {
+                nextX = avgX;
+                nextY = avgY;
+                hasNext = true;
+            }
+        }
+        finalX = lastX;
+        finalY = lastY;
+    }
+
+    // Pass 2: feed every point again; emit(x, y) receives the chosen points
+    template <typename Emit>
+    void select(uint32_t x, float y, Emit emit) {
+        if (mode == CHART_MODE_LTTB && !hasAnchor) {
+            // The first point is always kept
+            emitPoint(x, y, emit);
+            hasAnchor = true;
+            anchorX = x;
+            anchorY = y;
+            currentBucket = (long)bucketOf(x);
+            return;
+        }
+        if (mode == CHART_MODE_LTTB && x == finalX && hasLast) {
+            return;  // The last point is emitted by finish()
+        }
+
+        long bucketIndex = (long)bucketOf(x);
+        if (bucketIndex != currentBucket) {
+            flushBucket(emit);
+            currentBucket = bucketIndex;
+        }
+
+        if (mode == CHART_MODE_LTTB) {
+            const Bucket& next = buckets[bucketIndex];
+            float nextDx = next.count ? (float)((int64_t)next.sumX - (int64_t)anchorX) : 0;
+            float dx = (float)((int64_t)x - (int64_t)anchorX);
+            float area = fabsf(dx * (next.sumY - anchorY) - nextDx * (y - anchorY));
+            if (!bucketHasPoint || area > bestArea) {
+                bestArea = area;
+                bestX = x;
+                bestY = y;
+                bucketHasPoint = true;
+            }
+        } else {
+            if (!bucketHasPoint) {
+                minX = maxX = x;
+                minY = maxY = y;
+                bucketHasPoint = true;
+            } else if (y < minY) {
+                minX = x;
+                minY = y;
+            } else if (y > maxY) {
+                maxX = x;
+                maxY = y;
+            }
+        }
+    }
+
+    template <typename Emit>
+    size_t finish(Emit emit) {
+        flushBucket(emit);
+        if (mode == CHART_MODE_LTTB && hasLast && !(hasAnchor && anchorX == finalX && emitted == 1)) {
+            emitPoint(finalX, finalY, emit);
+        }
+        return emitted;
+    }
+
+    size_t getEmittedCount() const { return emitted; }
+};
+
+// Convenience wrapper for in-memory series
+template <size_t MaxBuckets, typename Emit>
+size_t downsampleSeries(const uint32_t* xs, const float* ys, size_t count, size_t width,
+                        ChartMode mode, ChartDownsampler<MaxBuckets>& sampler, Emit emit) {
+    if (count == 0) return 0;
+    sampler.begin(xs[0], xs[count - 1], width, mode);
+    if (sampler.needsAveragePass()) {
+        for (size_t i = 0; i < count; i++) sampler.accumulate(xs[i], ys[i]);
+        sampler.prepareSelect();
+    }
+    for (size_t i = 0; i < count; i++) sampler.select(xs[i], ys[i], emit);
+    return sampler.finish(emit);
+}
+
+#endif // CHART_DOWNSAMPLER_H
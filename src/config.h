@@ -13,16 +13,59 @@
 #define WIFI_AP_SSID "WeatherStation"
 #define WIFI_AP_PASSWORD "12345678"  // Default AP password (change in secrets.h)
 #define WIFI_CONFIG_TIMEOUT 180  // 3 minutes
+#define WIFI_RECONNECT_TIMEOUT_MS 10000  // Per reconnect attempt
+#define WIFI_BACKOFF_BASE_MS 1000        // First retry delay after a failed attempt
+#define WIFI_BACKOFF_MAX_MS 60000        // Retry delay cap
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 3000  // Boot attempt against the cached BSSID/channel
+#define WIFI_REUSE_IP_LEASE 0              // Reuse the last DHCP address as a static IP on fast connects.
+                                           // The lease expiry is not tracked, so only enable this with a
+                                           // DHCP reservation; otherwise the address may be handed out again
+#define WIFI_FAST_CACHE_NAMESPACE "wificache"
+#define WIFI_FAST_CACHE_MAGIC 0x57464331   // "WFC1"
+#define WIFI_PORTAL_AFTER_FAILURES 5       // Open the config portal after this many failed reconnects
+#define WIFI_PORTAL_DNS_PORT 53
+
+// Persistent Configuration (NVS namespace shared with the web interface)
+#define CONFIG_NAMESPACE "weatherconfig"
 
 // Web Server Configuration
 #define WEB_SERVER_PORT 80
 #define ENDPOINT_GET "/get"
 #define ENDPOINT_RESET "/reset"
+#define ENDPOINT_HISTORY "/history"
+#define ENDPOINT_CHART "/chart"
+#define ENDPOINT_DEBUG_LATENCY "/debug/latency"
+#define ENDPOINT_DEBUG_TRACE "/debug/trace"
+#define ENDPOINT_DEBUG_HEAP "/debug/heap"
+
+// Data API Configuration
+#define SAMPLE_RING_SIZE 64  // Recent samples kept per source for ?since= queries
+#define JSON_ARENA_SIZE 12288  // Static buffer API documents are built in; the full status document needs about 9 KB
+
+// Event Bus Configuration
+#define EVENT_MAX_SUBSCRIBERS 8
+#define EVENT_QUEUE_SIZE 16  // Events each other task can post between dispatches, power of two
 
 // BLE Configuration
 #define BLE_SERVICE_UUID "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define BLE_CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
+#define BLE_INDOOR_CHARACTERISTIC_UUID "beb5483f-36e1-4688-b7f5-ea07361b26a8"  // Indoor readings, read and notify
 #define BLE_DEVICE_NAME "Weather Station Indoor"
+#define BLE_MAX_STATIONS 3  // Outdoor stations tracked; keep CONFIG_BT_NIMBLE_MAX_CONNECTIONS in step
+#define BLE_STATION_STALE_MS 600000  // A silent station may lose its slot to a new one after this
+#define BLE_DATA_STALE_MS 300000     // Outdoor readings older than this are reported and shown as stale
+#define BLE_LINK_GAP_FACTOR 3        // An interval this many times the mean counts as a gap
+#define BLE_LINK_WARMUP_INTERVALS 3  // Intervals averaged before gaps are detected
+#define BLE_LINK_REBASELINE_GAPS 3   // Gaps in a row taken as a new cadence rather than outages
+#define BLE_SAMPLE_QUEUE_SIZE 64  // Outdoor samples handed from the BLE task to the loop, power of two
+// Indoor notifications are sent only when a value moves at least this far
+#define BLE_NOTIFY_DEADBAND_TEMPERATURE 0.2f  // C
+#define BLE_NOTIFY_DEADBAND_HUMIDITY 1.0f     // %
+#define BLE_NOTIFY_DEADBAND_PRESSURE 0.5f     // hPa
+#define BLE_NOTIFY_DEADBAND_IAQ 10.0f
+#define BLE_DEFAULT_PROFILE "balanced"  // low_latency, balanced or low_power; changeable on the config page
+#define BLE_PREFERRED_MTU 517  // Room for a 512-byte attribute in one write; keep CONFIG_BT_NIMBLE_ATT_PREFERRED_MTU in step
+#define BLE_SEQUENCE_RESTART_WINDOW 256  // A sequence further back than this means the station restarted
 
 // GY-MCU680 Sensor Configuration
 #define GY_RXD_PIN 25
@@ -33,11 +76,102 @@
 // Display Configuration - LilyGo T-Display
 #define TFT_ROTATION 0
 #define TFT_BL   4   // Backlight pin for LilyGo T-Display
+#define DISPLAY_STATION_ROTATE_MS 6000  // Time each outdoor station is shown when there are several
+#define DISPLAY_MIN_REDRAW_MS 100       // Readings arriving closer together share one redraw
 
 // Time Configuration
 #define TIMEZONE_LOCATION "Asia/Jerusalem"  // Default timezone (change in secrets.h)
+#define TIME_NTP_SERVER "pool.ntp.org"
+#define TIMEZONE_LOOKUP_RETRY_MS 600000   // Retry a failed location lookup after 10 minutes
+#define TIMEZONE_LOOKUP_STACK 4096         // One-shot task running the blocking ezTime location lookup
+
+// Task Layout
+// Sensing (sensor, BLE ingestion, events, display) and network (WiFi, HTTP,
+// time, sample rings, history, console) each run a scheduler in their own
+// task, pinned to opposite cores. The WiFi and NimBLE stacks run on core 0.
+#define SENSING_TASK_CORE 1
+#define SENSING_TASK_PRIORITY 2
+#define SENSING_TASK_STACK 6144
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 1
+#define NETWORK_TASK_STACK 8192
+#define INDOOR_HANDOFF_QUEUE_SIZE 16 // Indoor samples passed to the network task, power of two
+
+// Loop Scheduler Configuration
+// Period and start deadline in ms, CPU budget in us, per task
+#define TASK_WIFI_PERIOD_MS 100
+#define TASK_WIFI_DEADLINE_MS 100
+#define TASK_WIFI_BUDGET_US 2000
+#define TASK_SENSOR_PERIOD_MS 20         // UART frames arrive at 9600 baud
+#define TASK_SENSOR_DEADLINE_MS 50
+#define TASK_SENSOR_BUDGET_US 1000
+#define TASK_BLE_PERIOD_MS 1000
+#define TASK_BLE_DEADLINE_MS 500
+#define TASK_BLE_BUDGET_US 500
+#define TASK_WEB_PERIOD_MS 5
+#define TASK_WEB_DEADLINE_MS 50
+#define TASK_WEB_BUDGET_US 50000
+#define TASK_TIME_PERIOD_MS 100
+#define TASK_TIME_DEADLINE_MS 400
+#define TASK_TIME_BUDGET_US 1000
+#define TASK_EVENTS_PERIOD_MS 20         // Delivers events posted by the BLE and network tasks
+#define TASK_EVENTS_DEADLINE_MS 100
+#define TASK_EVENTS_BUDGET_US 2000       // Handlers only mark the display, it redraws in its own task
+#define TASK_SAMPLES_PERIOD_MS 100       // Moves handed-off samples into the rings
+#define TASK_SAMPLES_DEADLINE_MS 100
+#define TASK_SAMPLES_BUDGET_US 500
+#define TASK_HISTORY_PERIOD_MS 1000
+#define TASK_HISTORY_DEADLINE_MS 1000
+#define TASK_HISTORY_BUDGET_US 20000
+#define TASK_DISPLAY_PERIOD_MS 5          // Picks up a marked screen soon after the poll that read it
+#define TASK_DISPLAY_DEADLINE_MS 500
+#define TASK_DISPLAY_BUDGET_US 40000
+#define TASK_CONSOLE_PERIOD_MS 50
+#define TASK_CONSOLE_DEADLINE_MS 200
+#define TASK_CONSOLE_BUDGET_US 5000
+#define TASK_STATS_PERIOD_MS 500         // Copies each task's statistics for readers on the other task
+#define TASK_STATS_DEADLINE_MS 500
+#define TASK_STATS_BUDGET_US 200
+#define SCHEDULER_MAX_TASKS 8            // Per scheduler
+#define SCHEDULER_MAX_IDLE_MS 5          // Longest single sleep when nothing is due
+
+// Diagnostics Configuration
+#define DEBUG_COMMAND_SIZE 32            // Longest serial console command
+#define DEBUG_MAX_SCHEDULERS 2           // Loop schedulers reported, one per task
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0                  // Build with -DTRACE_ENABLED=1 for event tracing
+#endif
+#define TRACE_RING_SIZE 512              // Events kept, power of two, 16 bytes each
+#define TRACE_LINE_SIZE 96               // Longest formatted trace event
+#ifndef ALLOC_TRACKING
+#define ALLOC_TRACKING 0                 // 1 in the lilygo-t-display-diagnostics env, which adds the --wrap link flags
+#endif
+#define ALLOC_MAX_TAGS 16                // Subsystem tags for heap attribution
+#ifndef LOGGER_LEVEL
+#define LOGGER_LEVEL 3                   // 1 error, 2 warn, 3 info, 4 debug; lower levels compile out
+#endif
+#define LOGGER_RING_SIZE 64              // Queued records, power of two, ~60 bytes each
+#define LOGGER_MAX_ARGS 6                // Arguments per log call
+#define LOGGER_LINE_SIZE 160             // Longest formatted log line
+#define LOGGER_DRAIN_PRIORITY 1          // As the network task and below the sensing task; unpinned, so it drains on whichever core is free
+#define LOGGER_DRAIN_STACK 3072
+#define LOGGER_DRAIN_INTERVAL_MS 20
+
+// History Storage Configuration (LittleFS)
+#define HISTORY_FILE_A "/history_a.bin"
+#define HISTORY_FILE_B "/history_b.bin"
+#define HISTORY_TRIM_FILE_A "/history_a.trim"  // Kept records while a file is cut back
+#define HISTORY_TRIM_FILE_B "/history_b.trim"
+#define HISTORY_RECORD_INTERVAL 60      // Seconds between stored records
+#define HISTORY_RECORDS_PER_FILE 15000  // ~10 days per file at 1/min, 20 bytes each
+#define HISTORY_READ_BATCH 16           // Records read per flash access on export
+#define HISTORY_CHUNK_SIZE 1024         // Bytes per chunk of a streamed export
+#define HISTORY_LINE_SIZE 320           // Longest single CSV/NDJSON line
+#define CHART_MAX_WIDTH 480             // Max downsampled points per chart request
+#define CHART_DEFAULT_WIDTH 240
 
 // Data Array Size
-#define OUTDOOR_VALUES_COUNT 5
+#define OUTDOOR_VALUES_COUNT 5  // Floats in a legacy (version 1) outdoor payload
+#define OUTDOOR_BATCH_MAX 32    // Samples per version 2 outdoor payload, 360 bytes at most
 
 #endif // CONFIG_H
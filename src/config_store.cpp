@@ -0,0 +1,119 @@
+#include "config_store.h"
+
+const ConfigStore::KeyBinding ConfigStore::KEYS[] = {
+    {"timezone",      &StationConfig::timezone,     TIMEZONE_LOCATION},
+    {"hostname",      &StationConfig::hostname,     WIFI_HOSTNAME},
+    {"ap_ssid",       &StationConfig::apSSID,       WIFI_AP_SSID},
+    {"ap_password",   &StationConfig::apPassword,   WIFI_AP_PASSWORD},
+    {"wifi_ssid",     &StationConfig::wifiSSID,     ""},
+    {"wifi_password", &StationConfig::wifiPassword, ""},
+    {"ble_profile",   &StationConfig::bleProfile,   BLE_DEFAULT_PROFILE},
+};
+const size_t ConfigStore::KEY_COUNT = sizeof(ConfigStore::KEYS) / sizeof(ConfigStore::KEYS[0]);
+
+ConfigStore::ConfigStore(const char* nvsNamespace)
+    : nvsNamespace(nvsNamespace), stats({0, 0, 0, 0}), isLoaded(false) {
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        current.*(KEYS[i].field) = KEYS[i].defaultValue;
+    }
+}
+
+void ConfigStore::begin() {
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(nvsNamespace, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        // Namespace does not exist until the first save
+        Serial.println("No stored configuration, using defaults");
+        isLoaded = true;
+        return;
+    }
+
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        String value;
+        if (readString(handle, KEYS[i].key, value)) {
+            current.*(KEYS[i].field) = value;
+        }
+    }
+    nvs_close(handle);
+
+    isLoaded = true;
+    Serial.printf("Configuration loaded (%u NVS reads)\n", (unsigned)stats.reads);
+}
+
+bool ConfigStore::readString(nvs_handle_t handle, const char* key, String& value) {
+    size_t length = 0;
+    stats.reads++;
+    if (nvs_get_str(handle, key, nullptr, &length) != ESP_OK || length == 0) {
+        return false;
+    }
+
+    char* buffer = (char*)malloc(length);
+    if (!buffer) return false;
+    stats.reads++;
+    bool ok = nvs_get_str(handle, key, buffer, &length) == ESP_OK;
+    if (ok) value = buffer;
+    free(buffer);
+    return ok;
+}
+
+bool ConfigStore::writeString(nvs_handle_t handle, const char* key, const String& value) {
+    stats.writes++;
+    return nvs_set_str(handle, key, value.c_str()) == ESP_OK;
+}
+
+size_t ConfigStore::countChanges(const StationConfig& updated) const {
+    size_t changed = 0;
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        if (current.*(KEYS[i].field) != updated.*(KEYS[i].field)) changed++;
+    }
+    return changed;
+}
+
+bool ConfigStore::save(const StationConfig& updated) {
+    // Nothing changed: no NVS handle, no writes, no commit
+    if (countChanges(updated) == 0) return true;
+
+    nvs_handle_t handle;
+    if (nvs_open(nvsNamespace, NVS_READWRITE, &handle) != ESP_OK) {
+        Serial.println("Failed to open configuration storage");
+        return false;
+    }
+
+    // Write changed keys only, remembering how far we got
+    size_t written = 0;
+    bool ok = true;
+    for (; written < KEY_COUNT; written++) {
+        const String& oldValue = current.*(KEYS[written].field);
+        const String& newValue = updated.*(KEYS[written].field);
+        if (oldValue == newValue) continue;
+        if (!writeString(handle, KEYS[written].key, newValue)) {
+            ok = false;
+            break;
+        }
+    }
+
+    if (ok) {
+        stats.commits++;
+        ok = nvs_commit(handle) == ESP_OK;
+    }
+
+    if (!ok) {
+        // Restore the keys already written so storage matches the cache again
+        for (size_t i = 0; i < written && i < KEY_COUNT; i++) {
+            const String& oldValue = current.*(KEYS[i].field);
+            if (oldValue != updated.*(KEYS[i].field)) {
+                writeString(handle, KEYS[i].key, oldValue);
+            }
+        }
+        stats.commits++;
+        nvs_commit(handle);
+        stats.rollbacks++;
+        nvs_close(handle);
+        Serial.println("Configuration save failed, changes rolled back");
+        return false;
+    }
+
+    nvs_close(handle);
+    current = updated;
+    return true;
+}
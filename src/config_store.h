@@ -0,0 +1,63 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <nvs.h>
+#include "config.h"
+
+// Typed copy of the persisted station configuration
+struct StationConfig {
+    String timezone;
+    String hostname;
+    String apSSID;
+    String apPassword;
+    String wifiSSID;
+    String wifiPassword;
+    String bleProfile;  // Name from ble_profile.h
+};
+
+// NVS operation counters, for comparing storage traffic over time
+struct NVSStats {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t commits;
+    uint32_t rollbacks;
+};
+
+// In-memory configuration cache.
+// Values are loaded from NVS once at boot and then served from RAM.
+// save() writes only changed keys and commits them as one batch, and does
+// not touch NVS at all when nothing changed; if any write fails, the keys
+// already written are restored to their old values.
+class ConfigStore {
+private:
+    const char* nvsNamespace;
+    StationConfig current;
+    NVSStats stats;
+    bool isLoaded;
+
+    struct KeyBinding {
+        const char* key;
+        String StationConfig::*field;
+        const char* defaultValue;
+    };
+    static const KeyBinding KEYS[];
+    static const size_t KEY_COUNT;
+
+    bool readString(nvs_handle_t handle, const char* key, String& value);
+    bool writeString(nvs_handle_t handle, const char* key, const String& value);
+
+public:
+    explicit ConfigStore(const char* nvsNamespace = CONFIG_NAMESPACE);
+
+    void begin();
+    const StationConfig& get() const { return current; }
+    bool save(const StationConfig& updated);
+    // Keys whose value differs from the cached configuration
+    size_t countChanges(const StationConfig& updated) const;
+
+    const NVSStats& getStats() const { return stats; }
+    bool isReady() const { return isLoaded; }
+};
+
+#endif // CONFIG_STORE_H
@@ -0,0 +1,257 @@
+#include "diagnostics_manager.h"
+#include <ArduinoJson.h>
+#include "trace.h"
+#include "alloc_tracker.h"
+
+DiagnosticsManager::DiagnosticsManager() : reading(), schedulerCount(0), commandLength(0) {
+    commandBuffer[0] = '\0';
+}
+
+void DiagnosticsManager::begin() {
+    Serial.println("Debug console ready, type 'help' for commands");
+}
+
+void DiagnosticsManager::addScheduler(const char* name, LoopScheduler* loopScheduler) {
+    if (schedulerCount >= DEBUG_MAX_SCHEDULERS) return;
+    schedulers[schedulerCount] = loopScheduler;
+    schedulerNames[schedulerCount] = name;
+    schedulerCount++;
+}
+
+void DiagnosticsManager::publish(const LoopScheduler& loopScheduler) {
+    for (uint8_t s = 0; s < schedulerCount; s++) {
+        if (schedulers[s] == &loopScheduler) {
+            views[s].update([&loopScheduler](LoopSchedulerView& view) { loopScheduler.snapshot(view); });
+            return;
+        }
+    }
+}
+
+const LoopSchedulerView& DiagnosticsManager::readScheduler(uint8_t index) {
+    views[index].read(reading);
+    return reading;
+}
+
+void DiagnosticsManager::update() {
+    // Consume whatever arrived, one line at a time, without waiting
+    while (Serial.available()) {
+        char c = (char)Serial.read();
+        if (c == '\r') continue;
+        if (c == '\n') {
+            commandBuffer[commandLength] = '\0';
+            if (commandLength > 0) handleCommand(commandBuffer);
+            commandLength = 0;
+        } else if (commandLength < sizeof(commandBuffer) - 1) {
+            commandBuffer[commandLength++] = c;
+        }
+    }
+}
+
+void DiagnosticsManager::handleCommand(const char* command) {
+    if (strcmp(command, "latency") == 0) {
+        printLatency(Serial);
+    } else if (strcmp(command, "latency reset") == 0) {
+        resetLatency();
+        Serial.println("Latency statistics reset");
+    } else if (strcmp(command, "heap") == 0) {
+        printHeap(Serial);
+    } else if (strcmp(command, "heap reset") == 0) {
+        allocTracker.resetCounts();
+        Serial.println("Allocation counts reset");
+    } else if (strcmp(command, "trace") == 0) {
+        printTrace(Serial);
+    } else if (strcmp(command, "trace clear") == 0) {
+#if TRACE_ENABLED
+        traceRing().clear();
+#endif
+        Serial.println("Trace ring cleared");
+    } else {
+        printHelp(Serial);
+    }
+}
+
+void DiagnosticsManager::printHelp(Print& out) const {
+    out.println("Commands:");
+    out.println("  latency        Loop and per-task run time (us)");
+    out.println("  latency reset  Clear latency statistics");
+    out.println("  heap           Heap, fragmentation and allocations per task");
+    out.println("  heap reset     Clear allocation counts");
+    out.println("  trace          Dump recent events as Chrome trace JSON");
+    out.println("  trace clear    Drop recorded trace events");
+}
+
+// Each loop's whole-pass row is followed by its tasks
+void DiagnosticsManager::printLatency(Print& out) {
+    out.printf("%-10s %8s %8s %8s %8s %8s %8s\n", "task", "runs", "p50", "p99", "max", "overrun", "late");
+    for (uint8_t s = 0; s < schedulerCount; s++) {
+        const LoopSchedulerView& view = readScheduler(s);
+        const LogHistogram<32>& pass = view.passUs;
+        out.printf("%-10s %8u %8u %8u %8u %8s %8s\n", schedulerNames[s], (unsigned)pass.getCount(),
+                   (unsigned)pass.percentile(50), (unsigned)pass.percentile(99),
+                   (unsigned)pass.getMax(), "-", "-");
+        for (uint8_t i = 0; i < view.taskCount; i++) {
+            const TickTask& task = view.tasks[i];
+            out.printf("  %-8s %8u %8u %8u %8u %8u %8u\n", task.name, (unsigned)task.stats.runs,
+                       (unsigned)task.runUs.percentile(50),
+                       (unsigned)task.runUs.percentile(99),
+                       (unsigned)task.runUs.getMax(),
+                       (unsigned)task.stats.overruns, (unsigned)task.stats.missedDeadlines);
+        }
+    }
+}
+
+static void writeLatency(JsonObject out, const LogHistogram<32>& runUs) {
+    out["count"] = runUs.getCount();
+    out["p50_us"] = runUs.percentile(50);
+    out["p99_us"] = runUs.percentile(99);
+    out["max_us"] = runUs.getMax();
+}
+
+// GET /debug/latency[?reset=1]
+void DiagnosticsManager::handleLatencyRequest(WebServer* server) {
+    if (!server) return;
+    
+    JsonDocument doc;
+    doc["cpu_mhz"] = ESP.getCpuFreqMHz();
+    JsonObject loops = doc["loop"].to<JsonObject>();
+    JsonArray tasks = doc["tasks"].to<JsonArray>();
+    for (uint8_t s = 0; s < schedulerCount; s++) {
+        const LoopSchedulerView& view = readScheduler(s);
+        writeLatency(loops[schedulerNames[s]].to<JsonObject>(), view.passUs);
+        for (uint8_t i = 0; i < view.taskCount; i++) {
+            const TickTask& task = view.tasks[i];
+            JsonObject entry = tasks.add<JsonObject>();
+            entry["name"] = task.name;
+            entry["loop"] = schedulerNames[s];
+            writeLatency(entry, task.runUs);
+            entry["budget_us"] = task.budgetUs;
+            entry["overruns"] = task.stats.overruns;
+            entry["missed_deadlines"] = task.stats.missedDeadlines;
+        }
+    }
+    
+    String output;
+    serializeJson(doc, output);
+    server->send(200, "application/json", output);
+    
+    if (server->arg("reset") == "1") {
+        resetLatency();
+    }
+}
+
+// Each scheduler clears its own statistics at the start of its next pass
+void DiagnosticsManager::resetLatency() {
+    for (uint8_t s = 0; s < schedulerCount; s++) schedulers[s]->requestReset();
+}
+
+void DiagnosticsManager::printTrace(Print& out) const {
+#if TRACE_ENABLED
+    out.print(TRACE_JSON_HEADER);
+    bool first = true;
+    traceRing().forEach([&](const TraceEvent& event) {
+        char line[TRACE_LINE_SIZE];
+        size_t len = formatTraceEvent(line, sizeof(line), event, first);
+        out.write((const uint8_t*)line, len);
+        first = false;
+    });
+    out.println(TRACE_JSON_FOOTER);
+#else
+    out.println("Tracing disabled, build with -DTRACE_ENABLED=1");
+#endif
+}
+
+// GET /debug/trace[?clear=1]
+void DiagnosticsManager::handleTraceRequest(WebServer* server) {
+    if (!server) return;
+#if TRACE_ENABLED
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, "application/json", "");
+    
+    // Events are batched into one chunk buffer before going to the socket
+    char chunk[HISTORY_CHUNK_SIZE];
+    size_t used = (size_t)snprintf(chunk, sizeof(chunk), "%s", TRACE_JSON_HEADER);
+    bool first = true;
+    traceRing().forEach([&](const TraceEvent& event) {
+        char line[TRACE_LINE_SIZE];
+        size_t len = formatTraceEvent(line, sizeof(line), event, first);
+        first = false;
+        if (used + len > sizeof(chunk)) {
+            server->sendContent(chunk, used);
+            used = 0;
+        }
+        memcpy(chunk + used, line, len);
+        used += len;
+    });
+    if (used + sizeof(TRACE_JSON_FOOTER) > sizeof(chunk)) {
+        server->sendContent(chunk, used);
+        used = 0;
+    }
+    memcpy(chunk + used, TRACE_JSON_FOOTER, sizeof(TRACE_JSON_FOOTER) - 1);
+    used += sizeof(TRACE_JSON_FOOTER) - 1;
+    server->sendContent(chunk, used);
+    server->sendContent("");
+    
+    if (server->arg("clear") == "1") {
+        traceRing().clear();
+    }
+#else
+    server->send(404, "text/plain", "Tracing disabled, build with -DTRACE_ENABLED=1");
+#endif
+}
+
+void DiagnosticsManager::printHeap(Print& out) const {
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    out.printf("Free %u, min ever %u, largest block %u, fragmentation %u%%\n",
+               (unsigned)freeHeap, (unsigned)ESP.getMinFreeHeap(), (unsigned)largest,
+               (unsigned)heapFragmentationPercent(freeHeap, largest));
+    out.printf("Allocations %u, frees %u (tracking %s)\n", (unsigned)allocTracker.getTotalAllocs(),
+               (unsigned)allocTracker.getFrees(), ALLOC_TRACKING ? "on" : "off");
+    out.printf("%-10s %8s %10s %10s\n", "tag", "allocs", "bytes", "retained");
+    for (uint8_t i = 0; i < allocTracker.getTagCount(); i++) {
+        const AllocTagStats& tag = allocTracker.getTag(i);
+        out.printf("%-10s %8u %10llu %10d\n", allocTracker.getTagName(i), (unsigned)tag.allocs,
+                   (unsigned long long)tag.bytes, (int)tag.retained);
+    }
+    out.printf("%-10s %8u %10u %10s\n", "(tasks)", (unsigned)allocTracker.getForeignAllocs(),
+               (unsigned)allocTracker.getForeignBytes(), "-");
+}
+
+// GET /debug/heap[?reset=1]
+void DiagnosticsManager::handleHeapRequest(WebServer* server) {
+    if (!server) return;
+    
+    uint32_t freeHeap = ESP.getFreeHeap();
+    uint32_t largest = ESP.getMaxAllocHeap();
+    JsonDocument doc;
+    doc["free"] = freeHeap;
+    doc["min_free"] = ESP.getMinFreeHeap();
+    doc["largest_block"] = largest;
+    doc["fragmentation_pct"] = heapFragmentationPercent(freeHeap, largest);
+    doc["tracking"] = ALLOC_TRACKING ? true : false;
+    doc["allocs"] = allocTracker.getTotalAllocs();
+    doc["frees"] = allocTracker.getFrees();
+    
+    // Per network task; "retained" is what its runs allocated and did not free
+    JsonArray tags = doc["tags"].to<JsonArray>();
+    for (uint8_t i = 0; i < allocTracker.getTagCount(); i++) {
+        const AllocTagStats& tag = allocTracker.getTag(i);
+        JsonObject entry = tags.add<JsonObject>();
+        entry["name"] = allocTracker.getTagName(i);
+        entry["allocs"] = tag.allocs;
+        entry["bytes"] = tag.bytes;
+        entry["retained"] = tag.retained;
+        entry["runs"] = tag.scopes;
+    }
+    JsonObject other = doc["other_tasks"].to<JsonObject>();
+    other["allocs"] = allocTracker.getForeignAllocs();
+    other["bytes"] = allocTracker.getForeignBytes();
+    
+    String output;
+    serializeJson(doc, output);
+    server->send(200, "application/json", output);
+    
+    if (server->arg("reset") == "1") {
+        allocTracker.resetCounts();
+    }
+}
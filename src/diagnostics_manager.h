@@ -0,0 +1,57 @@
+#ifndef DIAGNOSTICS_MANAGER_H
+#define DIAGNOSTICS_MANAGER_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include "config.h"
+#include "tick_scheduler.h"
+#include "seqlock.h"
+
+typedef TickScheduler<SCHEDULER_MAX_TASKS> LoopScheduler;
+typedef TickSchedulerView<SCHEDULER_MAX_TASKS> LoopSchedulerView;
+
+// Runtime diagnostics: serial debug console and /debug/* endpoints.
+// Runs on the network task. Each scheduler's statistics are read from a copy
+// its own task publishes, and resets are carried out by that task too.
+class DiagnosticsManager {
+private:
+    LoopScheduler* schedulers[DEBUG_MAX_SCHEDULERS];
+    const char* schedulerNames[DEBUG_MAX_SCHEDULERS];
+    SeqLock<LoopSchedulerView> views[DEBUG_MAX_SCHEDULERS];
+    LoopSchedulerView reading;  // Last view read, kept off the network task's stack
+    uint8_t schedulerCount;
+    char commandBuffer[DEBUG_COMMAND_SIZE];
+    uint8_t commandLength;
+    
+    void handleCommand(const char* command);
+    void printHelp(Print& out) const;
+    
+public:
+    DiagnosticsManager();
+    
+    void begin();
+    void addScheduler(const char* name, LoopScheduler* loopScheduler);  // Before the tasks start
+    void update();  // Reads serial commands without blocking
+    
+    // Copies a scheduler's statistics for the readers; only from its own task
+    void publish(const LoopScheduler& loopScheduler);
+    // The scheduler's last published statistics, valid until the next read
+    const LoopSchedulerView& readScheduler(uint8_t index);
+    uint8_t getSchedulerCount() const { return schedulerCount; }
+    const char* getSchedulerName(uint8_t index) const { return schedulerNames[index]; }
+    
+    // Per-loop and per-task latency (p50/p99/max)
+    void printLatency(Print& out);
+    void handleLatencyRequest(WebServer* server);
+    void resetLatency();
+    
+    // Recent trace events as Chrome trace JSON (needs TRACE_ENABLED)
+    void printTrace(Print& out) const;
+    void handleTraceRequest(WebServer* server);
+    
+    // Free/minimum/largest-block heap and per-subsystem allocations
+    void printHeap(Print& out) const;
+    void handleHeapRequest(WebServer* server);
+};
+
+#endif // DIAGNOSTICS_MANAGER_H
@@ -0,0 +1,36 @@
+#ifndef DISPLAY_DATA_H
+#define DISPLAY_DATA_H
+
+#include <Arduino.h>
+#include <math.h>
+#include "measurement_store.h"
+
+// What the TFT shows, one full screen
+struct DisplayData {
+    float values[CHANNEL_COUNT];  // By channel, those with displayDecimals are drawn
+    uint8_t station;       // Outdoor station shown, from 0
+    uint8_t stationCount;  // Stations that have reported
+    uint16_t outdoorStaleMin;  // Age of stale outdoor data in minutes, 0 while fresh
+};
+
+// A value as drawn: drawFloat() rounds to one decimal, drawNumber() truncates to a long
+inline long displayedTenths(float value) { return lroundf(value * 10.0f); }
+inline long displayedWhole(float value) { return (long)value; }
+
+// True if the screens for a and b would differ, so a reading that only moved
+// below the drawn precision costs no redraw
+inline bool isDisplayedDifferently(const DisplayData& a, const DisplayData& b) {
+    for (uint8_t id = 0; id < CHANNEL_COUNT; id++) {
+        int8_t decimals = CHANNELS[id].displayDecimals;
+        if (decimals == CHANNEL_NOT_DRAWN) continue;
+        if (decimals > 0 ? displayedTenths(a.values[id]) != displayedTenths(b.values[id])
+                         : displayedWhole(a.values[id]) != displayedWhole(b.values[id])) {
+            return true;
+        }
+    }
+    return a.station != b.station ||
+           a.stationCount != b.stationCount ||
+           a.outdoorStaleMin != b.outdoorStaleMin;
+}
+
+#endif // DISPLAY_DATA_H
@@ -1,9 +1,11 @@
 #include "display_manager.h"
+#include "trace.h"
 
-DisplayManager::DisplayManager() : isInitialized(false), needsFullRefresh(true), lastUpdateTime(0) {
+DisplayManager::DisplayManager() : isInitialized(false), needsFullRefresh(true) {
     // Initialize display data
     currentData = {0};
     lastData = {0};
+    strcpy(timeText, "00:00");
 }
 
 void DisplayManager::begin() {
@@ -45,20 +47,15 @@ void DisplayManager::begin() {
 void DisplayManager::update(const DisplayData& data) {
     if (!isInitialized) return;
     
-    // Check if data has actually changed
-    if (!hasDataChanged(data)) {
-        // Only update time if it's been more than 30 seconds
-        if (millis() - lastUpdateTime > 30000) {
-            updateTimeOnly();
-            lastUpdateTime = millis();
-        }
+    // Only when something on screen would change; the time is redrawn by updateTime()
+    if (!isDisplayedDifferently(data, lastData)) {
         return;
     }
     
     // Data has changed, do full refresh
+    TRACE_SCOPE("display.push");
     currentData = data;
     lastData = data;
-    lastUpdateTime = millis();
     
     clearScreen();
     drawIndoorData();
@@ -92,40 +89,65 @@ void DisplayManager::drawIndoorData() {
     // Indoor temperature and humidity (top section)
     tft.setFreeFont(&FreeSansBold18pt7b);
     tft.setTextColor(TFT_NAVY, TFT_BLACK);
-    tft.drawFloat(currentData.tempIn, 1, 3, 3);
-    tft.drawNumber(currentData.humiIn, 93, 3);
+    tft.drawFloat(currentData.values[CH_INDOOR_TEMPERATURE], 1, 3, 3);
+    tft.drawNumber(displayedWhole(currentData.values[CH_INDOOR_HUMIDITY]), 93, 3);
     
     // IAQ values
     tft.setFreeFont(&FreeSans12pt7b);
     tft.setTextColor(TFT_NAVY, TFT_BLACK);
-    tft.drawNumber(currentData.iaq, 3, 35);
-    tft.drawNumber(currentData.iaqAcc, 93, 35);
+    tft.drawNumber(displayedWhole(currentData.values[CH_INDOOR_IAQ]), 3, 35);
+    tft.drawNumber(displayedWhole(currentData.values[CH_INDOOR_IAQ_ACCURACY]), 93, 35);
 }
 
 void DisplayManager::drawOutdoorData() {
+    // Stale readings are greyed out so they are not taken for current ones
+    bool stale = currentData.outdoorStaleMin > 0;
+    uint16_t color = stale ? TFT_DARKGREY : TFT_NAVY;
+    
     // Outdoor temperature and humidity (middle section)
     tft.setFreeFont(&FreeSansBold18pt7b);
-    tft.setTextColor(TFT_NAVY, TFT_BLACK);
-    tft.drawFloat(currentData.tempOut, 1, 3, 148);
-    tft.drawNumber(currentData.humiOut, 93, 148);
+    tft.setTextColor(color, TFT_BLACK);
+    tft.drawFloat(currentData.values[CH_OUTDOOR_TEMPERATURE], 1, 3, 148);
+    tft.drawNumber(displayedWhole(currentData.values[CH_OUTDOOR_HUMIDITY]), 93, 148);
     
     // Pressure
     tft.setFreeFont(&FreeSans12pt7b);
-    tft.setTextColor(TFT_NAVY, TFT_BLACK);
-    tft.drawNumber(currentData.press, 3, 148 + 32);
+    tft.setTextColor(color, TFT_BLACK);
+    tft.drawNumber(displayedWhole(currentData.values[CH_OUTDOOR_PRESSURE]), 3, 148 + 32);
+    
+    if (stale) {
+        char age[8];
+        if (currentData.outdoorStaleMin < 60) {
+            snprintf(age, sizeof(age), "%um", currentData.outdoorStaleMin);
+        } else {
+            snprintf(age, sizeof(age), "%uh", currentData.outdoorStaleMin / 60);
+        }
+        tft.setTextFont(2);
+        tft.setTextColor(TFT_ORANGE, TFT_BLACK);
+        tft.drawString(age, 3, 130);
+    }
+    
+    // Which station this is when several take turns
+    if (currentData.stationCount > 1) {
+        char label[8];
+        snprintf(label, sizeof(label), "%u/%u", currentData.station + 1, currentData.stationCount);
+        tft.setTextFont(2);
+        tft.setTextColor(TFT_DARKGREY, TFT_BLACK);
+        tft.drawString(label, 100, 130);
+    }
 }
 
 void DisplayManager::drawTime() {
     tft.setFreeFont(&FreeSans12pt7b);
     tft.setTextColor(TFT_DARKCYAN, TFT_BLACK);
-    tft.drawString(currentData.timeString, -1, 78, 7);
+    tft.drawString(timeText, -1, 78, 7);
 }
 
 void DisplayManager::drawBatteryStatus() {
     tft.setFreeFont(&FreeSans9pt7b);
     tft.setTextColor(TFT_DARKGREEN, TFT_BLACK);
-    tft.drawFloat(currentData.batV, 1, 3, 170 + 42);
-    tft.drawNumber(currentData.batP, 93, 170 + 42);
+    tft.drawFloat(currentData.values[CH_OUTDOOR_BATTERY_VOLTAGE], 1, 3, 170 + 42);
+    tft.drawNumber(displayedWhole(currentData.values[CH_OUTDOOR_BATTERY_PERCENTAGE]), 93, 170 + 42);
 }
 
 void DisplayManager::showError(const String& message) {
@@ -150,29 +172,11 @@ void DisplayManager::showStatus(const String& message) {
     tft.drawString(message, 10, 80, 2);
 }
 
-bool DisplayManager::hasDataChanged(const DisplayData& newData) const {
-    // Compare critical values that would affect the display
-    return (newData.tempIn != lastData.tempIn ||
-            newData.humiIn != lastData.humiIn ||
-            newData.iaq != lastData.iaq ||
-            newData.iaqAcc != lastData.iaqAcc ||
-            newData.tempOut != lastData.tempOut ||
-            newData.humiOut != lastData.humiOut ||
-            newData.press != lastData.press ||
-            newData.batV != lastData.batV ||
-            newData.batP != lastData.batP);
-}
-
-void DisplayManager::updateTimeOnly() {
+void DisplayManager::updateTime(const char* time) {
+    strlcpy(timeText, time, sizeof(timeText));
     if (!isInitialized) return;
     
     // Only update the time portion without clearing the screen
+    TRACE_SCOPE("display.time");
     drawTime();
 }
-
-void DisplayManager::updateTime() {
-    if (!isInitialized) return;
-    
-    // Only update the time portion without clearing the screen
-    updateTimeOnly();
-}
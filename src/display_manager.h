@@ -4,19 +4,7 @@
 #include <TFT_eSPI.h>
 #include <SPI.h>
 #include "config.h"
-
-struct DisplayData {
-    float tempIn;
-    float humiIn;
-    int iaq;
-    int iaqAcc;
-    float tempOut;
-    float humiOut;
-    float press;
-    float batV;
-    float batP;
-    String timeString;
-};
+#include "display_data.h"
 
 class DisplayManager {
 private:
@@ -25,22 +13,20 @@ private:
     DisplayData lastData;
     bool isInitialized;
     bool needsFullRefresh;
-    unsigned long lastUpdateTime;
+    char timeText[6];  // "HH:MM", set by updateTime()
     
     void drawIndoorData();
     void drawOutdoorData();
     void drawTime();
     void drawBatteryStatus();
     void clearScreen();
-    bool hasDataChanged(const DisplayData& newData) const;
-    void updateTimeOnly();
     
 public:
     DisplayManager();
     
     void begin();
     void update(const DisplayData& data);
-    void updateTime();
+    void updateTime(const char* time);  // Redraws only the time region
     void clear();
     void setBrightness(uint8_t brightness);
     void setRotation(uint8_t rotation);
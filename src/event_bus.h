@@ -0,0 +1,156 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "spsc_queue.h"
+
+// Typed notifications from the managers to whoever reacts to new data, so
+// consumers run when something actually changed instead of polling on a
+// timer. Events are small values and subscribers are plain functions in a
+// fixed table; nothing is allocated after startup.
+
+enum EventType : uint8_t {
+    EVENT_INDOOR_SAMPLE,   // New valid sensor reading, in the measurement store
+    EVENT_OUTDOOR_SAMPLE,  // Batch accepted from the station in source
+    EVENT_TIME_MINUTE,     // Local minute changed, see Event::minute
+    EVENT_TIME_SYNC,       // Clock quality changed, e.g. the first NTP sync
+    EVENT_TYPE_COUNT
+};
+
+// Tasks other than the sensing task, each with its own queue to post into
+enum EventProducer : uint8_t {
+    EVENT_PRODUCER_BLE,      // NimBLE host task
+    EVENT_PRODUCER_NETWORK,  // Network task
+    EVENT_PRODUCER_COUNT
+};
+
+#define EVENT_MASK(type) (1u << (type))
+#define EVENT_MASK_ALL ((1u << EVENT_TYPE_COUNT) - 1)
+
+struct Event {
+    EventType type;
+    uint8_t source;        // Station slot for outdoor events, else 0
+    union {
+        uint32_t sequence;  // Sample events: newest sample sequence, else 0
+        uint32_t minute;    // EVENT_TIME_MINUTE: local minutes since epoch
+    };
+    uint32_t timestampMs;  // When the data was taken
+};
+
+typedef void (*EventHandler)(const Event& event);
+
+struct EventBusStats {
+    uint32_t published[EVENT_TYPE_COUNT];
+    uint32_t deliveries;  // Handler calls
+};
+
+// publish() delivers at once, in subscription order, and is for the sensing
+// task. Other tasks post() into their producer's own single-producer queue,
+// so posting never locks, and the sensing task's next dispatch() delivers
+// them; a full queue drops the event and counts the drop. Handlers run on
+// the sensing task either way and may publish.
+template <uint8_t MaxSubscribers, uint16_t QueueSize>
+class EventBus {
+private:
+    struct Subscriber {
+        uint32_t mask;
+        EventHandler handler;
+    };
+    Subscriber subscribers[MaxSubscribers];
+    uint8_t subscriberCount;
+    SpscQueue<Event, QueueSize> posted[EVENT_PRODUCER_COUNT];
+    EventBusStats stats;
+
+public:
+    EventBus() : subscriberCount(0), stats() {}
+
+    // Mask of EVENT_MASK bits; false when the table is full
+    bool subscribe(uint32_t mask, EventHandler handler) {
+        if (subscriberCount >= MaxSubscribers || !handler) return false;
+        subscribers[subscriberCount].mask = mask;
+        subscribers[subscriberCount].handler = handler;
+        subscriberCount++;
+        return true;
+    }
+
+    void publish(const Event& event) {
+        if (event.type >= EVENT_TYPE_COUNT) return;
+        stats.published[event.type]++;
+        for (uint8_t i = 0; i < subscriberCount; i++) {
+            if (subscribers[i].mask & EVENT_MASK(event.type)) {
+                subscribers[i].handler(event);
+                stats.deliveries++;
+            }
+        }
+    }
+
+    // Only ever from the task the producer names
+    bool post(EventProducer producer, const Event& event) { return posted[producer].push(event); }
+
+    // Delivers what was posted so far, producer by producer; returns how many events
+    uint16_t dispatch() {
+        uint16_t count = 0;
+        Event event;
+        for (uint8_t i = 0; i < EVENT_PRODUCER_COUNT; i++) {
+            uint16_t taken = 0;
+            while (taken < QueueSize && posted[i].pop(event)) {
+                publish(event);
+                taken++;
+            }
+            count += taken;
+        }
+        return count;
+    }
+
+    uint8_t getSubscriberCount() const { return subscriberCount; }
+
+    uint32_t getPending() const {
+        uint32_t pending = 0;
+        for (uint8_t i = 0; i < EVENT_PRODUCER_COUNT; i++) pending += posted[i].size();
+        return pending;
+    }
+
+    uint32_t getDropped() const {
+        uint32_t dropped = 0;
+        for (uint8_t i = 0; i < EVENT_PRODUCER_COUNT; i++) dropped += posted[i].getRejected();
+        return dropped;
+    }
+
+    const EventBusStats& getStats() const { return stats; }
+};
+
+typedef EventBus<EVENT_MAX_SUBSCRIBERS, EVENT_QUEUE_SIZE> AppEventBus;
+
+inline AppEventBus& eventBus() {
+    static AppEventBus bus;
+    return bus;
+}
+
+inline Event makeEvent(EventType type, uint8_t source, uint32_t sequence, uint32_t timestampMs) {
+    Event event;
+    event.type = type;
+    event.source = source;
+    event.sequence = sequence;
+    event.timestampMs = timestampMs;
+    return event;
+}
+
+inline Event makeMinuteEvent(uint32_t minute, uint32_t timestampMs) {
+    Event event = makeEvent(EVENT_TIME_MINUTE, 0, 0, timestampMs);
+    event.minute = minute;
+    return event;
+}
+
+inline const char* eventTypeName(EventType type) {
+    switch (type) {
+        case EVENT_INDOOR_SAMPLE: return "indoor_sample";
+        case EVENT_OUTDOOR_SAMPLE: return "outdoor_sample";
+        case EVENT_TIME_MINUTE: return "time_minute";
+        case EVENT_TIME_SYNC: return "time_sync";
+        case EVENT_TYPE_COUNT: break;
+    }
+    return "unknown";
+}
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,73 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <Arduino.h>
+
+// Fixed-bucket base-2 logarithmic histogram.
+// Bucket 0 holds 0, bucket i holds [2^(i-1), 2^i), the last bucket is open
+// ended. Recording is a count-leading-zeros and an increment, so it is cheap
+// enough for hot paths; percentiles are resolved to a bucket upper bound,
+// clamped to the largest value recorded.
+template <uint8_t BucketCount = 24>
+class LogHistogram {
+private:
+    uint32_t counts[BucketCount];
+    uint32_t total;
+    uint32_t maxValue;
+    uint64_t sum;
+
+public:
+    LogHistogram() { reset(); }
+
+    static uint8_t bucketOf(uint32_t value) {
+        if (value == 0) return 0;
+        uint8_t bucket = 32 - __builtin_clz(value);
+        return bucket < BucketCount ? bucket : BucketCount - 1;
+    }
+
+    // Largest value that falls into `bucket`; the last bucket is open ended
+    static uint32_t bucketUpperBound(uint8_t bucket) {
+        if (bucket == 0) return 0;
+        if (bucket >= BucketCount - 1 || bucket >= 32) return UINT32_MAX;
+        return (uint32_t)((1ULL << bucket) - 1);
+    }
+
+    void record(uint32_t value) {
+        counts[bucketOf(value)]++;
+        total++;
+        sum += value;
+        if (value > maxValue) maxValue = value;
+    }
+
+    // Upper bound of the bucket holding the p-th percentile (0..100),
+    // clamped to the largest value seen
+    uint32_t percentile(float p) const {
+        if (total == 0) return 0;
+        uint32_t rank = (uint32_t)ceilf(total * p / 100.0f);
+        if (rank == 0) rank = 1;
+        uint32_t seen = 0;
+        for (uint8_t i = 0; i < BucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank) {
+                uint32_t bound = bucketUpperBound(i);
+                return bound < maxValue ? bound : maxValue;
+            }
+        }
+        return maxValue;
+    }
+
+    uint32_t getCount() const { return total; }
+    uint32_t getMax() const { return maxValue; }
+    uint32_t getMean() const { return total ? (uint32_t)(sum / total) : 0; }
+    uint32_t getBucket(uint8_t bucket) const { return bucket < BucketCount ? counts[bucket] : 0; }
+    static uint8_t getBucketCount() { return BucketCount; }
+
+    void reset() {
+        memset(counts, 0, sizeof(counts));
+        total = 0;
+        maxValue = 0;
+        sum = 0;
+    }
+};
+
+#endif // HISTOGRAM_H
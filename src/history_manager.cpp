@@ -0,0 +1,312 @@
+#include "history_manager.h"
+
+HistoryManager::HistoryManager()
+    : isInitialized(false), activeFile(0), activeCount(0), lastRecordEpoch(0) {
+}
+
+void HistoryManager::begin() {
+    if (!LittleFS.begin(true)) {
+        Serial.println("Failed to mount LittleFS, history disabled");
+        return;
+    }
+
+    finishInterruptedTrim(0);
+    finishInterruptedTrim(1);
+    selectActiveFile();
+    isInitialized = true;
+    Serial.printf("History initialized: %u records stored\n", (unsigned)getRecordCount());
+}
+
+const char* HistoryManager::filePath(uint8_t index) {
+    return index == 0 ? HISTORY_FILE_A : HISTORY_FILE_B;
+}
+
+const char* HistoryManager::trimPath(uint8_t index) {
+    return index == 0 ? HISTORY_TRIM_FILE_A : HISTORY_TRIM_FILE_B;
+}
+
+size_t HistoryManager::countRecords(uint8_t index) {
+    File file = LittleFS.open(filePath(index), "r");
+    if (!file) return 0;
+    size_t count = file.size() / sizeof(HistoryRecord);
+    file.close();
+    return count;
+}
+
+uint32_t HistoryManager::lastEpochOf(uint8_t index) {
+    File file = LittleFS.open(filePath(index), "r");
+    if (!file) return 0;
+
+    HistoryRecord record = {0};
+    size_t count = file.size() / sizeof(HistoryRecord);
+    if (count > 0) {
+        file.seek((count - 1) * sizeof(HistoryRecord));
+        file.read((uint8_t*)&record, sizeof(record));
+    }
+    file.close();
+    return record.epoch;
+}
+
+uint32_t HistoryManager::firstEpochOf(uint8_t index) {
+    File file = LittleFS.open(filePath(index), "r");
+    if (!file) return 0;
+
+    HistoryRecord record = {0};
+    file.read((uint8_t*)&record, sizeof(record));
+    file.close();
+    return record.epoch;
+}
+
+void HistoryManager::selectActiveFile() {
+    size_t countA = countRecords(0);
+    size_t countB = countRecords(1);
+    bool fullA = countA >= HISTORY_RECORDS_PER_FILE;
+    bool fullB = countB >= HISTORY_RECORDS_PER_FILE;
+
+    if (fullA && !fullB) {
+        activeFile = 1;
+    } else if (fullB && !fullA) {
+        activeFile = 0;
+    } else if (fullA && fullB) {
+        // Interrupted rotation: reuse the older file
+        activeFile = lastEpochOf(0) <= lastEpochOf(1) ? 0 : 1;
+        File file = LittleFS.open(filePath(activeFile), "w");
+        file.close();
+    } else {
+        activeFile = lastEpochOf(0) >= lastEpochOf(1) ? 0 : 1;
+    }
+
+    activeCount = countRecords(activeFile);
+    lastRecordEpoch = max(lastEpochOf(0), lastEpochOf(1));
+}
+
+void HistoryManager::rotate() {
+    activeFile = 1 - activeFile;
+    File file = LittleFS.open(filePath(activeFile), "w");
+    file.close();
+    activeCount = 0;
+}
+
+// Cuts a file back to its records stamped at or before `epoch`. LittleFS
+// files cannot be shortened in place, so the kept records are copied to a
+// trim file that then replaces the original.
+void HistoryManager::dropRecordsAfter(uint8_t index, uint32_t epoch) {
+    File file = LittleFS.open(filePath(index), "r");
+    if (!file) return;
+    size_t count = file.size() / sizeof(HistoryRecord);
+    size_t keep = findFirstRecordAtOrAfter(count, epoch + 1, [&file](size_t i) {
+        HistoryRecord record;
+        file.seek(i * sizeof(HistoryRecord));
+        file.read((uint8_t*)&record, sizeof(record));
+        return record.epoch;
+    });
+    if (keep == count) {
+        file.close();
+        return;
+    }
+
+    File trimmed = LittleFS.open(trimPath(index), "w");
+    if (!trimmed) {
+        file.close();
+        return;
+    }
+    HistoryRecord batch[HISTORY_READ_BATCH];
+    file.seek(0);
+    for (size_t i = 0; i < keep; ) {
+        size_t n = min((size_t)HISTORY_READ_BATCH, keep - i);
+        n = file.read((uint8_t*)batch, n * sizeof(HistoryRecord)) / sizeof(HistoryRecord);
+        if (n == 0) break;
+        trimmed.write((const uint8_t*)batch, n * sizeof(HistoryRecord));
+        i += n;
+    }
+    file.close();
+    trimmed.close();
+    LittleFS.remove(filePath(index));
+    LittleFS.rename(trimPath(index), filePath(index));
+}
+
+// A trim file left by a reset is complete once the original is gone;
+// while the original still exists the cut is simply redone later
+void HistoryManager::finishInterruptedTrim(uint8_t index) {
+    if (!LittleFS.exists(trimPath(index))) return;
+    if (LittleFS.exists(filePath(index))) {
+        LittleFS.remove(trimPath(index));
+    } else {
+        LittleFS.rename(trimPath(index), filePath(index));
+    }
+}
+
+uint8_t HistoryManager::olderFile() const {
+    uint32_t firstA = firstEpochOf(0);
+    uint32_t firstB = firstEpochOf(1);
+    if (firstA == 0) return 1;
+    if (firstB == 0) return 0;
+    return firstA <= firstB ? 0 : 1;
+}
+
+void HistoryManager::update(uint32_t epoch, const ChannelSample& indoor, const ChannelSample& outdoor) {
+    if (!isInitialized || epoch == 0) return;
+    // Stored records ahead of the clock were stamped before a sync or the
+    // clock was stepped back. They are dropped so that the files stay in time
+    // order across reboots and recording does not wait for the clock to catch
+    // up. A step back of less than one interval only delays a record.
+    if (epoch + HISTORY_RECORD_INTERVAL < lastRecordEpoch) {
+        Serial.printf("History: clock at %lu is behind last record %lu, dropping the records ahead of it\n",
+                      (unsigned long)epoch, (unsigned long)lastRecordEpoch);
+        dropRecordsAfter(0, epoch);
+        dropRecordsAfter(1, epoch);
+        selectActiveFile();
+    }
+    if (epoch < lastRecordEpoch + HISTORY_RECORD_INTERVAL) return;
+    if (!indoor.isValid && !outdoor.isValid) return;
+
+    HistoryRecord record;
+    record.epoch = epoch;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNEL_COUNT; ch++) {
+        ChannelId channel = HISTORY_CHANNELS[ch].channel;
+        const ChannelSample& sample = CHANNELS[channel].group == CHANNEL_GROUP_INDOOR ? indoor : outdoor;
+        record.values[ch] = encodeHistoryValue((HistoryChannel)ch, sample.values[channel], sample.isValid);
+    }
+
+    append(record);
+}
+
+bool HistoryManager::append(const HistoryRecord& record) {
+    if (!isInitialized || record.epoch <= lastRecordEpoch) return false;
+
+    if (activeCount >= HISTORY_RECORDS_PER_FILE) {
+        rotate();
+    }
+
+    File file = LittleFS.open(filePath(activeFile), "a");
+    if (!file) {
+        Serial.println("Failed to open history file");
+        return false;
+    }
+    size_t written = file.write((const uint8_t*)&record, sizeof(record));
+    file.close();
+
+    if (written != sizeof(record)) {
+        Serial.println("Failed to append history record");
+        return false;
+    }
+
+    activeCount++;
+    lastRecordEpoch = record.epoch;
+    return true;
+}
+
+void HistoryManager::clear() {
+    if (!isInitialized) return;
+    LittleFS.remove(HISTORY_FILE_A);
+    LittleFS.remove(HISTORY_FILE_B);
+    activeFile = 0;
+    activeCount = 0;
+    lastRecordEpoch = 0;
+}
+
+size_t HistoryManager::getRecordCount() const {
+    if (!isInitialized) return 0;
+    return countRecords(0) + countRecords(1);
+}
+
+uint32_t HistoryManager::getFirstEpoch() const {
+    if (!isInitialized) return 0;
+    return firstEpochOf(olderFile());
+}
+
+size_t HistoryManager::streamRange(WebServer* server, uint32_t from, uint32_t to,
+                                   uint16_t channelMask, uint32_t step, HistoryFormat format) const {
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, format == HISTORY_FORMAT_NDJSON ? "application/x-ndjson" : "text/csv", "");
+
+    // Lines are batched into one chunk buffer before going to the socket
+    char chunk[HISTORY_CHUNK_SIZE];
+    size_t used = 0;
+    if (format == HISTORY_FORMAT_CSV) {
+        used = formatHistoryHeader(chunk, sizeof(chunk), channelMask);
+    }
+
+    uint32_t nextEpoch = from;
+    size_t emitted = 0;
+    forEachInRange(from, to, [&](const HistoryRecord& record) {
+        if (step > 0) {
+            if (record.epoch < nextEpoch) return;
+            nextEpoch = record.epoch + step;
+        }
+
+        char line[HISTORY_LINE_SIZE];
+        size_t len = formatHistoryRow(line, sizeof(line), record, channelMask, format);
+        if (used + len > sizeof(chunk)) {
+            server->sendContent(chunk, used);
+            used = 0;
+        }
+        memcpy(chunk + used, line, len);
+        used += len;
+        emitted++;
+    });
+
+    if (used > 0) {
+        server->sendContent(chunk, used);
+    }
+    server->sendContent("");  // Terminating chunk
+    return emitted;
+}
+
+size_t HistoryManager::streamChart(WebServer* server, HistoryChannel channel, uint32_t from, uint32_t to,
+                                   size_t width, ChartMode mode) const {
+    // Bucket state is ~8 KB, so keep it off the network task's stack
+    static ChartDownsampler<CHART_MAX_WIDTH> sampler;
+
+    if (from == 0) from = getFirstEpoch();
+    if (to == UINT32_MAX) to = lastRecordEpoch;
+    sampler.begin(from, to, width, mode);
+
+    if (sampler.needsAveragePass()) {
+        forEachInRange(from, to, [channel](const HistoryRecord& record) {
+            if (record.values[channel] != HISTORY_NO_VALUE) {
+                sampler.accumulate(record.epoch, decodeHistoryValue(channel, record.values[channel]));
+            }
+        });
+        sampler.prepareSelect();
+    }
+
+    server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server->send(200, "application/json", "");
+
+    char chunk[HISTORY_CHUNK_SIZE];
+    size_t used = (size_t)snprintf(chunk, sizeof(chunk),
+                                   "{\"channel\":\"%s\",\"mode\":\"%s\",\"from\":%lu,\"to\":%lu,\"points\":[",
+                                   HISTORY_CHANNELS[channel].name, mode == CHART_MODE_MINMAX ? "minmax" : "lttb",
+                                   (unsigned long)from, (unsigned long)to);
+    bool firstPoint = true;
+    auto emit = [&](uint32_t x, float y) {
+        char point[40];
+        size_t len = (size_t)snprintf(point, sizeof(point), "%s[%lu,%.*f]", firstPoint ? "" : ",",
+                                      (unsigned long)x, (int)HISTORY_CHANNELS[channel].decimals, y);
+        firstPoint = false;
+        if (used + len > sizeof(chunk)) {
+            server->sendContent(chunk, used);
+            used = 0;
+        }
+        memcpy(chunk + used, point, len);
+        used += len;
+    };
+
+    forEachInRange(from, to, [&](const HistoryRecord& record) {
+        if (record.values[channel] != HISTORY_NO_VALUE) {
+            sampler.select(record.epoch, decodeHistoryValue(channel, record.values[channel]), emit);
+        }
+    });
+    size_t points = sampler.finish(emit);
+
+    if (used + 2 > sizeof(chunk)) {
+        server->sendContent(chunk, used);
+        used = 0;
+    }
+    memcpy(chunk + used, "]}", 2);
+    used += 2;
+    server->sendContent(chunk, used);
+    server->sendContent("");
+    return points;
+}
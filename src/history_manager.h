@@ -0,0 +1,115 @@
+#ifndef HISTORY_MANAGER_H
+#define HISTORY_MANAGER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <WebServer.h>
+#include "config.h"
+#include "history_record.h"
+#include "chart_downsampler.h"
+
+// Long-term history on LittleFS.
+// Records are fixed-size and appended in time order to one of two files;
+// when the active file is full the other one is truncated and takes over,
+// so the store always holds between one and two files worth of data. Every
+// record of the older file precedes every record of the newer one: records
+// stamped ahead of a clock that stepped back are dropped, not rotated past.
+class HistoryManager {
+private:
+    bool isInitialized;
+    uint8_t activeFile;
+    size_t activeCount;
+    uint32_t lastRecordEpoch;
+
+    static const char* filePath(uint8_t index);
+    static const char* trimPath(uint8_t index);
+    static size_t countRecords(uint8_t index);
+    static uint32_t firstEpochOf(uint8_t index);
+    static uint32_t lastEpochOf(uint8_t index);
+    void selectActiveFile();
+    void rotate();
+    static void dropRecordsAfter(uint8_t index, uint32_t epoch);
+    static void finishInterruptedTrim(uint8_t index);
+    // The file holding the earlier records
+    uint8_t olderFile() const;
+
+    // Visit records of one file with from <= epoch <= to, oldest first
+    template <typename Fn>
+    size_t forEachInFile(uint8_t index, uint32_t from, uint32_t to, Fn& fn) const;
+
+public:
+    HistoryManager();
+
+    void begin();
+    // Appends a record once per HISTORY_RECORD_INTERVAL seconds of UTC time;
+    // epoch 0 (clock not set) records nothing
+    void update(uint32_t epoch, const ChannelSample& indoor, const ChannelSample& outdoor);
+    bool append(const HistoryRecord& record);
+    void clear();
+
+    // Visit all stored records with from <= epoch <= to, oldest first
+    template <typename Fn>
+    size_t forEachInRange(uint32_t from, uint32_t to, Fn fn) const;
+
+    // Stream a chunked CSV/NDJSON export with constant memory.
+    // `step` keeps at most one record per that many seconds.
+    size_t streamRange(WebServer* server, uint32_t from, uint32_t to,
+                       uint16_t channelMask, uint32_t step, HistoryFormat format) const;
+
+    // Stream one channel downsampled to `width` points as JSON [[epoch,value],...].
+    // from = 0 / to = UINT32_MAX select the whole stored range.
+    size_t streamChart(WebServer* server, HistoryChannel channel, uint32_t from, uint32_t to,
+                       size_t width, ChartMode mode) const;
+
+    bool isReady() const { return isInitialized; }
+    size_t getRecordCount() const;
+    uint32_t getFirstEpoch() const;
+    uint32_t getLastEpoch() const { return lastRecordEpoch; }
+};
+
+template <typename Fn>
+size_t HistoryManager::forEachInFile(uint8_t index, uint32_t from, uint32_t to, Fn& fn) const {
+    File file = LittleFS.open(filePath(index), "r");
+    if (!file) return 0;
+
+    size_t count = file.size() / sizeof(HistoryRecord);
+    size_t first = findFirstRecordAtOrAfter(count, from, [&file](size_t i) {
+        HistoryRecord record;
+        file.seek(i * sizeof(HistoryRecord));
+        file.read((uint8_t*)&record, sizeof(record));
+        return record.epoch;
+    });
+
+    size_t visited = 0;
+    HistoryRecord batch[HISTORY_READ_BATCH];
+    file.seek(first * sizeof(HistoryRecord));
+    for (size_t i = first; i < count; ) {
+        size_t n = min((size_t)HISTORY_READ_BATCH, count - i);
+        size_t bytes = file.read((uint8_t*)batch, n * sizeof(HistoryRecord));
+        n = bytes / sizeof(HistoryRecord);
+        if (n == 0) break;
+        for (size_t j = 0; j < n; j++) {
+            if (batch[j].epoch > to) {
+                file.close();
+                return visited;
+            }
+            fn(batch[j]);
+            visited++;
+        }
+        i += n;
+    }
+    file.close();
+    return visited;
+}
+
+template <typename Fn>
+size_t HistoryManager::forEachInRange(uint32_t from, uint32_t to, Fn fn) const {
+    if (!isInitialized) return 0;
+    uint8_t older = olderFile();
+    size_t visited = forEachInFile(older, from, to, fn);
+    visited += forEachInFile(1 - older, from, to, fn);
+    return visited;
+}
+
+#endif // HISTORY_MANAGER_H
@@ -0,0 +1,170 @@
+#ifndef HISTORY_RECORD_H
+#define HISTORY_RECORD_H
+
+#include <Arduino.h>
+#include "measurement_store.h"
+
+// Channels stored in the long-term history, one scaled int16 per record
+enum HistoryChannel : uint8_t {
+    HISTORY_INDOOR_TEMPERATURE = 0,
+    HISTORY_INDOOR_HUMIDITY,
+    HISTORY_INDOOR_PRESSURE,
+    HISTORY_INDOOR_IAQ,
+    HISTORY_OUTDOOR_TEMPERATURE,
+    HISTORY_OUTDOOR_HUMIDITY,
+    HISTORY_OUTDOOR_PRESSURE,
+    HISTORY_OUTDOOR_BATTERY,
+    HISTORY_CHANNEL_COUNT
+};
+
+#define HISTORY_NO_VALUE INT16_MIN
+#define HISTORY_ALL_CHANNELS ((uint16_t)((1u << HISTORY_CHANNEL_COUNT) - 1))
+
+struct HistoryChannelInfo {
+    const char* name;   // Export and query name, fixed with the files
+    ChannelId channel;  // Measured quantity recorded
+    float scale;        // Stored value = reading * scale
+    uint8_t decimals;   // Digits printed on export
+};
+
+static const HistoryChannelInfo HISTORY_CHANNELS[HISTORY_CHANNEL_COUNT] = {
+    {"indoor.temperature",  CH_INDOOR_TEMPERATURE,         100.0f, 2},
+    {"indoor.humidity",     CH_INDOOR_HUMIDITY,            100.0f, 2},
+    {"indoor.pressure",     CH_INDOOR_PRESSURE,             10.0f, 1},
+    {"indoor.iaq",          CH_INDOOR_IAQ,                   1.0f, 0},
+    {"outdoor.temperature", CH_OUTDOOR_TEMPERATURE,        100.0f, 2},
+    {"outdoor.humidity",    CH_OUTDOOR_HUMIDITY,           100.0f, 2},
+    {"outdoor.pressure",    CH_OUTDOOR_PRESSURE,            10.0f, 1},
+    {"outdoor.battery",     CH_OUTDOOR_BATTERY_PERCENTAGE, 100.0f, 2},
+};
+
+// Fixed-size on-flash record, one per history interval
+struct __attribute__((packed)) HistoryRecord {
+    uint32_t epoch;  // UTC seconds
+    int16_t values[HISTORY_CHANNEL_COUNT];
+};
+
+inline int16_t encodeHistoryValue(HistoryChannel channel, float value, bool valid) {
+    if (!valid) return HISTORY_NO_VALUE;
+    float scaled = value * HISTORY_CHANNELS[channel].scale;
+    if (scaled >= 32767.0f) return 32767;
+    if (scaled <= -32767.0f) return -32767;
+    return (int16_t)lroundf(scaled);
+}
+
+inline float decodeHistoryValue(HistoryChannel channel, int16_t raw) {
+    return raw / HISTORY_CHANNELS[channel].scale;
+}
+
+// Channel index for an exact name, HISTORY_CHANNEL_COUNT if unknown
+inline HistoryChannel historyChannelFromName(const char* name) {
+    for (uint8_t ch = 0; ch < HISTORY_CHANNEL_COUNT; ch++) {
+        if (name && strcmp(HISTORY_CHANNELS[ch].name, name) == 0) return (HistoryChannel)ch;
+    }
+    return HISTORY_CHANNEL_COUNT;
+}
+
+// Bit mask from a comma-separated channel list; group names such as
+// "indoor" select all channels below them. Empty list selects everything.
+inline uint16_t historyChannelMask(const char* list) {
+    if (!list || !*list) return HISTORY_ALL_CHANNELS;
+    uint16_t mask = 0;
+    for (uint8_t ch = 0; ch < HISTORY_CHANNEL_COUNT; ch++) {
+        const char* name = HISTORY_CHANNELS[ch].name;
+        const char* token = list;
+        while (*token) {
+            const char* end = strchr(token, ',');
+            size_t len = end ? (size_t)(end - token) : strlen(token);
+            if (len > 0 && strncmp(name, token, len) == 0 &&
+                (name[len] == '\0' || name[len] == '.')) {
+                mask |= (1u << ch);
+                break;
+            }
+            if (!end) break;
+            token = end + 1;
+        }
+    }
+    return mask;
+}
+
+// Writes a fixed-point decimal without going through printf's float path
+inline size_t appendScaled(char* out, size_t size, int16_t raw, uint8_t decimals, float scale) {
+    if (raw == HISTORY_NO_VALUE) {
+        return (size_t)snprintf(out, size, "null");
+    }
+    long value = raw;
+    bool negative = value < 0;
+    if (negative) value = -value;
+    long divisor = (long)scale;
+    long whole = value / divisor;
+    long frac = value % divisor;
+    if (decimals == 0) {
+        return (size_t)snprintf(out, size, "%s%ld", negative ? "-" : "", whole);
+    }
+    return (size_t)snprintf(out, size, "%s%ld.%0*ld", negative ? "-" : "", whole, (int)decimals, frac);
+}
+
+enum HistoryFormat : uint8_t {
+    HISTORY_FORMAT_CSV = 0,
+    HISTORY_FORMAT_NDJSON
+};
+
+// CSV header line for the selected channels
+inline size_t formatHistoryHeader(char* out, size_t size, uint16_t mask) {
+    size_t len = (size_t)snprintf(out, size, "epoch");
+    for (uint8_t ch = 0; ch < HISTORY_CHANNEL_COUNT && len < size; ch++) {
+        if (mask & (1u << ch)) {
+            len += (size_t)snprintf(out + len, size - len, ",%s", HISTORY_CHANNELS[ch].name);
+        }
+    }
+    if (len < size) len += (size_t)snprintf(out + len, size - len, "\n");
+    return len < size ? len : size - 1;
+}
+
+// One CSV or NDJSON line for a record; returns bytes written (excluding NUL)
+inline size_t formatHistoryRow(char* out, size_t size, const HistoryRecord& record,
+                               uint16_t mask, HistoryFormat format) {
+    size_t len;
+    if (format == HISTORY_FORMAT_NDJSON) {
+        len = (size_t)snprintf(out, size, "{\"epoch\":%lu", (unsigned long)record.epoch);
+    } else {
+        len = (size_t)snprintf(out, size, "%lu", (unsigned long)record.epoch);
+    }
+
+    for (uint8_t ch = 0; ch < HISTORY_CHANNEL_COUNT && len < size; ch++) {
+        if (!(mask & (1u << ch))) continue;
+        const HistoryChannelInfo& info = HISTORY_CHANNELS[ch];
+        if (format == HISTORY_FORMAT_NDJSON) {
+            len += (size_t)snprintf(out + len, size - len, ",\"%s\":", info.name);
+        } else {
+            len += (size_t)snprintf(out + len, size - len, ",");
+        }
+        if (len < size) {
+            len += appendScaled(out + len, size - len, record.values[ch], info.decimals, info.scale);
+        }
+    }
+
+    if (len < size) {
+        len += (size_t)snprintf(out + len, size - len, format == HISTORY_FORMAT_NDJSON ? "}\n" : "\n");
+    }
+    return len < size ? len : size - 1;
+}
+
+// Index of the first record with epoch >= target in a sorted sequence.
+// `epochAt(i)` reads a single record's epoch, so this works over files too.
+template <typename EpochAt>
+size_t findFirstRecordAtOrAfter(size_t count, uint32_t target, EpochAt epochAt) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (epochAt(mid) < target) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+#endif // HISTORY_RECORD_H
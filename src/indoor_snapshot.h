@@ -0,0 +1,100 @@
+#ifndef INDOOR_SNAPSHOT_H
+#define INDOOR_SNAPSHOT_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "outdoor_protocol.h"
+
+// Indoor readings notified to BLE clients, all fields little-endian:
+//   u8 version (1) | u32 sample sequence | i16 temp 0.01 C |
+//   u16 humidity 0.01 % | u16 pressure 0.1 hPa | u16 IAQ | u8 IAQ accuracy
+// Values use the outdoor frames' scale factors and field helpers, the
+// layout is its own and decodeIndoorSnapshot() below reads it.
+
+#define INDOOR_SNAPSHOT_VERSION 1
+#define INDOOR_SNAPSHOT_SIZE 14
+
+struct IndoorSnapshot {
+    uint32_t sequence;
+    float temperature;
+    float humidity;
+    float pressure;
+    uint16_t iaq;
+    uint8_t iaqAccuracy;
+};
+
+// Writes INDOOR_SNAPSHOT_SIZE bytes to out
+inline void encodeIndoorSnapshot(uint8_t* out, const IndoorSnapshot& snapshot) {
+    out[0] = INDOOR_SNAPSHOT_VERSION;
+    putU32(out + 1, snapshot.sequence);
+    putU16(out + 5, (uint16_t)(int16_t)scaleOutdoorValue(snapshot.temperature, 100.0f, INT16_MIN, INT16_MAX));
+    putU16(out + 7, (uint16_t)scaleOutdoorValue(snapshot.humidity, 100.0f, 0, UINT16_MAX));
+    putU16(out + 9, (uint16_t)scaleOutdoorValue(snapshot.pressure, 10.0f, 0, UINT16_MAX));
+    putU16(out + 11, snapshot.iaq);
+    out[13] = snapshot.iaqAccuracy;
+}
+
+inline bool decodeIndoorSnapshot(const uint8_t* data, size_t length, IndoorSnapshot& snapshot) {
+    if (length != INDOOR_SNAPSHOT_SIZE || data[0] != INDOOR_SNAPSHOT_VERSION) return false;
+    snapshot.sequence = getU32(data + 1);
+    snapshot.temperature = (int16_t)getU16(data + 5) / 100.0f;
+    snapshot.humidity = getU16(data + 7) / 100.0f;
+    snapshot.pressure = getU16(data + 9) / 10.0f;
+    snapshot.iaq = getU16(data + 11);
+    snapshot.iaqAccuracy = data[13];
+    return true;
+}
+
+// Smallest change of each value worth telling clients about
+struct IndoorDeadband {
+    float temperature;
+    float humidity;
+    float pressure;
+    float iaq;
+};
+
+// Passes a snapshot on only when a value has moved past its deadband since
+// the last one passed on. Comparing with the last published value rather
+// than the previous sample means slow drifts are still reported once they
+// add up.
+class DeadbandFilter {
+private:
+    IndoorDeadband deadband;
+    IndoorSnapshot published;
+    bool hasPublished;
+    uint32_t passed;
+    uint32_t suppressed;
+
+    static bool moved(float current, float last, float band) {
+        float delta = current - last;
+        return delta >= band || -delta >= band;
+    }
+
+public:
+    explicit DeadbandFilter(const IndoorDeadband& band)
+        : deadband(band), published(), hasPublished(false), passed(0), suppressed(0) {}
+
+    // True when the snapshot should be published; it then becomes the reference
+    bool update(const IndoorSnapshot& snapshot) {
+        bool changed = !hasPublished ||
+                       moved(snapshot.temperature, published.temperature, deadband.temperature) ||
+                       moved(snapshot.humidity, published.humidity, deadband.humidity) ||
+                       moved(snapshot.pressure, published.pressure, deadband.pressure) ||
+                       moved(snapshot.iaq, published.iaq, deadband.iaq) ||
+                       snapshot.iaqAccuracy != published.iaqAccuracy;
+        if (!changed) {
+            suppressed++;
+            return false;
+        }
+        published = snapshot;
+        hasPublished = true;
+        passed++;
+        return true;
+    }
+
+    const IndoorSnapshot& getPublished() const { return published; }
+    uint32_t getPassed() const { return passed; }
+    uint32_t getSuppressed() const { return suppressed; }
+};
+
+#endif // INDOOR_SNAPSHOT_H
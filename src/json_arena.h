@@ -0,0 +1,84 @@
+#ifndef JSON_ARENA_H
+#define JSON_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Bump allocator for ArduinoJson documents backed by a fixed buffer.
+// A request builds its document in the arena and the whole arena is
+// released at once with reset(), so building the API document does not
+// touch the heap; the response String handed to the web server is then
+// the one heap block of the request. Only the most recent block can grow or be returned in place;
+// when the buffer runs out blocks come from the heap instead, counted in
+// getOverflows() so the size can be tuned.
+template <size_t Size>
+class JsonArena : public ArduinoJson::Allocator {
+private:
+    static const size_t ALIGNMENT = sizeof(void*);
+
+    uint8_t buffer[Size] __attribute__((aligned(sizeof(void*))));
+    size_t used;
+    size_t lastOffset;  // Start of the most recent block
+    size_t highWater;
+    uint32_t overflows;
+
+    static size_t align(size_t size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    bool owns(void* ptr) const {
+        return ptr >= (void*)buffer && ptr < (void*)(buffer + Size);
+    }
+
+public:
+    JsonArena() : used(0), lastOffset(0), highWater(0), overflows(0) {}
+
+    void* allocate(size_t size) override {
+        size_t aligned = align(size);
+        if (aligned > Size - used) {
+            overflows++;
+            return malloc(size);
+        }
+        lastOffset = used;
+        used += aligned;
+        if (used > highWater) highWater = used;
+        return buffer + lastOffset;
+    }
+
+    void deallocate(void* ptr) override {
+        if (!ptr) return;
+        if (!owns(ptr)) {
+            free(ptr);
+            return;
+        }
+        if (ptr == buffer + lastOffset) used = lastOffset;  // Only the top block can be given back
+    }
+
+    void* reallocate(void* ptr, size_t newSize) override {
+        if (!ptr) return allocate(newSize);
+        if (!owns(ptr)) return realloc(ptr, newSize);
+
+        size_t offset = (uint8_t*)ptr - buffer;
+        if (offset == lastOffset && align(newSize) <= Size - offset) {
+            used = offset + align(newSize);
+            if (used > highWater) highWater = used;
+            return ptr;
+        }
+        // Not on top or out of room: move it; the old block stays until reset()
+        size_t oldSize = (offset == lastOffset ? used : Size) - offset;
+        void* moved = allocate(newSize);
+        if (moved) memcpy(moved, ptr, oldSize < newSize ? oldSize : newSize);
+        return moved;
+    }
+
+    // Releases every block; documents using the arena must be gone
+    void reset() {
+        used = 0;
+        lastOffset = 0;
+    }
+
+    size_t getUsed() const { return used; }
+    size_t getHighWater() const { return highWater; }
+    uint32_t getOverflows() const { return overflows; }
+    static size_t getCapacity() { return Size; }
+};
+
+#endif // JSON_ARENA_H
@@ -0,0 +1,124 @@
+#ifndef LINK_METRICS_H
+#define LINK_METRICS_H
+
+#include <Arduino.h>
+#include <math.h>
+
+enum LinkFreshness {
+    LINK_FRESH_NONE,   // Nothing received yet
+    LINK_FRESH_OK,
+    LINK_FRESH_LATE,   // Next write overdue by the usual cadence
+    LINK_FRESH_STALE   // Older than the configured threshold
+};
+
+// Arrival statistics of one remote station, updated once per accepted
+// write. Mean and jitter (standard deviation of the inter-arrival time)
+// use Welford's running update, so nothing is stored per write. Once the
+// cadence is known, an interval longer than gapFactor times the mean
+// counts as a gap and is left out of the statistics, so one outage does
+// not hide the normal rhythm. A run of rebaselineGaps gaps in a row is a
+// new rhythm instead, e.g. the station moved to a slower radio profile:
+// the statistics start over from the latest interval and the gaps already
+// counted stay counted.
+class LinkMetrics {
+private:
+    uint32_t arrivals;
+    uint32_t lastArrivalMs;
+    uint32_t intervals;  // Non-gap intervals in the mean
+    float meanMs;
+    float m2;            // Sum of squared deviations from the mean
+    uint32_t minMs;
+    uint32_t maxMs;
+    uint32_t gaps;
+    uint32_t longestGapMs;
+    uint32_t lastGapMs;  // When the latest gap ended
+    uint8_t gapRun;      // Gaps in a row since the last normal interval
+
+public:
+    LinkMetrics() { reset(); }
+
+    void reset() {
+        arrivals = 0;
+        lastArrivalMs = 0;
+        intervals = 0;
+        meanMs = 0;
+        m2 = 0;
+        minMs = 0;
+        maxMs = 0;
+        gaps = 0;
+        longestGapMs = 0;
+        lastGapMs = 0;
+        gapRun = 0;
+    }
+
+    // Drops the cadence learnt so far and starts it again from one interval
+    void rebaseline(uint32_t interval) {
+        intervals = 1;
+        meanMs = interval;
+        m2 = 0;
+        minMs = interval;
+        maxMs = interval;
+        gapRun = 0;
+    }
+
+    // Returns the length of the gap the write ended, 0 for a normal interval
+    uint32_t record(uint32_t nowMs, uint8_t gapFactor, uint8_t warmupIntervals, uint8_t rebaselineGaps) {
+        arrivals++;
+        if (arrivals == 1) {
+            lastArrivalMs = nowMs;
+            return 0;
+        }
+        uint32_t interval = nowMs - lastArrivalMs;
+        lastArrivalMs = nowMs;
+
+        if (intervals >= warmupIntervals && interval > meanMs * gapFactor) {
+            if (++gapRun >= rebaselineGaps) {
+                rebaseline(interval);
+                return 0;
+            }
+            gaps++;
+            lastGapMs = nowMs;
+            if (interval > longestGapMs) longestGapMs = interval;
+            return interval;
+        }
+
+        gapRun = 0;
+        intervals++;
+        float delta = interval - meanMs;
+        meanMs += delta / intervals;
+        m2 += delta * (interval - meanMs);
+        if (intervals == 1 || interval < minMs) minMs = interval;
+        if (interval > maxMs) maxMs = interval;
+        return 0;
+    }
+
+    LinkFreshness freshness(uint32_t nowMs, uint32_t staleMs) const {
+        if (arrivals == 0) return LINK_FRESH_NONE;
+        uint32_t age = nowMs - lastArrivalMs;
+        if (age > staleMs) return LINK_FRESH_STALE;
+        if (intervals > 0 && age > meanMs * 2) return LINK_FRESH_LATE;
+        return LINK_FRESH_OK;
+    }
+
+    uint32_t getAgeMs(uint32_t nowMs) const { return arrivals ? nowMs - lastArrivalMs : 0; }
+    uint32_t getArrivals() const { return arrivals; }
+    uint32_t getMeanMs() const { return (uint32_t)(meanMs + 0.5f); }
+    uint32_t getJitterMs() const { return intervals > 1 ? (uint32_t)(sqrtf(m2 / (intervals - 1)) + 0.5f) : 0; }
+    uint32_t getMinMs() const { return minMs; }
+    uint32_t getMaxMs() const { return maxMs; }
+    uint32_t getGaps() const { return gaps; }
+    uint32_t getLongestGapMs() const { return longestGapMs; }
+    uint32_t getLastGapMs() const { return lastGapMs; }
+};
+
+inline const char* linkFreshnessName(LinkFreshness freshness) {
+    switch (freshness) {
+        case LINK_FRESH_NONE: return "none";
+        case LINK_FRESH_OK: return "fresh";
+        case LINK_FRESH_LATE: return "late";
+        case LINK_FRESH_STALE: return "stale";
+    }
+    return "unknown";
+}
+
+#endif // LINK_METRICS_H
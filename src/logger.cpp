@@ -0,0 +1,26 @@
+#include "logger.h"
+
+// Formats and prints queued records; blocking on the UART only stalls this task
+static void loggerDrainTask(void*) {
+    StationLogRing& ring = logRing();
+    char line[LOGGER_LINE_SIZE];
+    uint32_t reportedDrops = 0;
+    LogRecord record;
+    for (;;) {
+        while (ring.pop(record)) {
+            formatLogRecord(line, sizeof(line), record);
+            Serial.println(line);
+        }
+        uint32_t dropped = ring.getDropped();
+        if (dropped != reportedDrops) {
+            Serial.printf("[log] %u records dropped\n", (unsigned)(dropped - reportedDrops));
+            reportedDrops = dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOGGER_DRAIN_INTERVAL_MS));
+    }
+}
+
+void loggerBegin() {
+    logRing();  // Construct the ring before other tasks can log
+    xTaskCreate(loggerDrainTask, "logger", LOGGER_DRAIN_STACK, nullptr, LOGGER_DRAIN_PRIORITY, nullptr);
+}
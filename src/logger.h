@@ -0,0 +1,253 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Deferred logging for hot paths.
+// A LOGGER_* call stores the format pointer and its raw arguments in a
+// lock-free ring and returns; a low-priority task formats the records and
+// writes them to Serial, so the caller never waits on the UART. Calls
+// below LOGGER_LEVEL compile to nothing. Format strings must be literals
+// and %s arguments must still be valid when the record is drained
+// (literals, static or cached buffers).
+
+#define LOGGER_LEVEL_NONE 0
+#define LOGGER_LEVEL_ERROR 1
+#define LOGGER_LEVEL_WARN 2
+#define LOGGER_LEVEL_INFO 3
+#define LOGGER_LEVEL_DEBUG 4
+
+enum LogArgType : uint8_t { LOG_ARG_INT, LOG_ARG_UINT, LOG_ARG_FLOAT, LOG_ARG_STRING };
+
+struct LogArg {
+    LogArgType type;
+    union {
+        int32_t i;
+        uint32_t u;
+        float f;
+        const char* s;
+    };
+};
+
+inline LogArg toLogArg(int value) { LogArg arg; arg.type = LOG_ARG_INT; arg.i = value; return arg; }
+inline LogArg toLogArg(long value) { LogArg arg; arg.type = LOG_ARG_INT; arg.i = (int32_t)value; return arg; }
+inline LogArg toLogArg(unsigned int value) { LogArg arg; arg.type = LOG_ARG_UINT; arg.u = value; return arg; }
+inline LogArg toLogArg(unsigned long value) { LogArg arg; arg.type = LOG_ARG_UINT; arg.u = (uint32_t)value; return arg; }
+inline LogArg toLogArg(double value) { LogArg arg; arg.type = LOG_ARG_FLOAT; arg.f = (float)value; return arg; }
+inline LogArg toLogArg(const char* value) { LogArg arg; arg.type = LOG_ARG_STRING; arg.s = value; return arg; }
+
+struct LogRecord {
+    uint32_t timestampMs;
+    const char* format;
+    uint8_t level;
+    uint8_t argCount;
+    LogArg args[LOGGER_MAX_ARGS];
+};
+
+// Multi-producer ring with a single consumer. Writers never block; when
+// the drain falls a whole ring behind the oldest records are overwritten
+// and counted as dropped.
+template <uint16_t Size>
+class LogRing {
+private:
+    static_assert((Size & (Size - 1)) == 0, "Log ring size must be a power of two");
+
+    struct Slot {
+        LogRecord record;
+        std::atomic<uint32_t> sequence;  // Index + 1 once the slot is complete, 0 while written
+    };
+
+    Slot slots[Size];
+    std::atomic<uint32_t> head;
+    uint32_t tail;     // Next index to drain, consumer only
+    uint32_t dropped;  // Consumer only
+
+public:
+    LogRing() : head(0), tail(0), dropped(0) {
+        for (uint16_t i = 0; i < Size; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    void push(const LogRecord& record) {
+        uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[index & (Size - 1)];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    // Oldest undrained record; false when empty or the next one is still being written
+    bool pop(LogRecord& out) {
+        uint32_t end = head.load(std::memory_order_acquire);
+        if (end - tail > Size) {
+            dropped += end - tail - Size;
+            tail = end - Size;
+        }
+        while (tail != end) {
+            const Slot& slot = slots[tail & (Size - 1)];
+            uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == 0 || (int32_t)(sequence - (tail + 1)) < 0) return false;
+            if (sequence == tail + 1) {
+                out = slot.record;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == tail + 1) {
+                    tail++;
+                    return true;
+                }
+            }
+            // Overwritten by a newer record while we were behind
+            dropped++;
+            tail++;
+        }
+        return false;
+    }
+
+    uint32_t getWritten() const { return head.load(std::memory_order_relaxed); }
+    uint32_t getDropped() const { return dropped; }
+    static uint16_t getCapacity() { return Size; }
+};
+
+inline char logLevelLetter(uint8_t level) {
+    switch (level) {
+        case LOGGER_LEVEL_ERROR: return 'E';
+        case LOGGER_LEVEL_WARN: return 'W';
+        case LOGGER_LEVEL_INFO: return 'I';
+        case LOGGER_LEVEL_DEBUG: return 'D';
+    }
+    return '?';
+}
+
+// Formats one conversion with the stored argument. Length modifiers in the
+// spec are replaced to match how the argument was stored, so a mismatched
+// format prints a converted value instead of reading garbage.
+inline int formatLogArg(char* out, size_t size, const char* spec, size_t specLength, const LogArg* arg) {
+    char conversion = spec[specLength - 1];
+    char normalized[16];
+    size_t n = 0;
+    for (size_t i = 0; i + 1 < specLength && n < sizeof(normalized) - 3; i++) {
+        char c = spec[i];
+        if (c != 'l' && c != 'h' && c != 'z' && c != 'j' && c != 't' && c != 'L') normalized[n++] = c;
+    }
+    if (!arg) return snprintf(out, size, "<?>");
+
+    switch (conversion) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': {
+            normalized[n++] = 'l';
+            normalized[n++] = conversion;
+            normalized[n] = '\0';
+            if (arg->type == LOG_ARG_STRING) return snprintf(out, size, "<?>");
+            if (arg->type == LOG_ARG_FLOAT) return snprintf(out, size, normalized, (long)arg->f);
+            if (arg->type == LOG_ARG_INT) return snprintf(out, size, normalized, (long)arg->i);
+            return snprintf(out, size, normalized, (unsigned long)arg->u);
+        }
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+            normalized[n++] = conversion;
+            normalized[n] = '\0';
+            if (arg->type == LOG_ARG_STRING) return snprintf(out, size, "<?>");
+            double value = arg->type == LOG_ARG_FLOAT ? (double)arg->f
+                         : arg->type == LOG_ARG_INT ? (double)arg->i : (double)arg->u;
+            return snprintf(out, size, normalized, value);
+        }
+        case 'c':
+            normalized[n++] = 'c';
+            normalized[n] = '\0';
+            return snprintf(out, size, normalized, (int)arg->i);
+        case 's':
+            normalized[n++] = 's';
+            normalized[n] = '\0';
+            return snprintf(out, size, normalized, arg->type == LOG_ARG_STRING && arg->s ? arg->s : "<?>");
+    }
+    return snprintf(out, size, "<?>");
+}
+
+// "[  12345][I] message" into out, always terminated; returns its length
+inline size_t formatLogRecord(char* out, size_t size, const LogRecord& record) {
+    if (size == 0) return 0;
+    int written = snprintf(out, size, "[%7lu][%c] ", (unsigned long)record.timestampMs, logLevelLetter(record.level));
+    size_t len = written < 0 ? 0 : ((size_t)written < size ? (size_t)written : size - 1);
+    uint8_t nextArg = 0;
+
+    for (const char* p = record.format; *p && len + 1 < size; p++) {
+        if (*p != '%') {
+            out[len++] = *p;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[len++] = '%';
+            p++;
+            continue;
+        }
+        const char* spec = p;
+        size_t specLength = 1;
+        while (spec[specLength] && !strchr("diuxXofFeEgGcs", spec[specLength])) specLength++;
+        if (!spec[specLength]) break;  // Truncated spec at the end of the format
+        specLength++;
+        const LogArg* arg = nextArg < record.argCount ? &record.args[nextArg] : nullptr;
+        nextArg++;
+        int n = formatLogArg(out + len, size - len, spec, specLength, arg);
+        if (n > 0) len += (size_t)n < size - len ? (size_t)n : size - len - 1;
+        p += specLength - 1;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+inline void packLogArgs(LogRecord&) {}
+
+template <typename First, typename... Rest>
+inline void packLogArgs(LogRecord& record, First first, Rest... rest) {
+    record.args[record.argCount++] = toLogArg(first);
+    packLogArgs(record, rest...);
+}
+
+template <typename Ring, typename... Args>
+inline void logTo(Ring& ring, uint8_t level, uint32_t timestampMs, const char* format, Args... args) {
+    static_assert(sizeof...(Args) <= LOGGER_MAX_ARGS, "Too many log arguments");
+    LogRecord record;
+    record.timestampMs = timestampMs;
+    record.format = format;
+    record.level = level;
+    record.argCount = 0;
+    packLogArgs(record, args...);
+    ring.push(record);
+}
+
+typedef LogRing<LOGGER_RING_SIZE> StationLogRing;
+
+inline StationLogRing& logRing() {
+    static StationLogRing ring;
+    return ring;
+}
+
+// Starts the task that formats and prints queued records
+void loggerBegin();
+
+#define LOGGER_WRITE(level, ...) logTo(logRing(), level, (uint32_t)millis(), __VA_ARGS__)
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_ERROR
+#define LOGGER_ERROR(...) LOGGER_WRITE(LOGGER_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOGGER_ERROR(...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_WARN
+#define LOGGER_WARN(...) LOGGER_WRITE(LOGGER_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOGGER_WARN(...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_INFO
+#define LOGGER_INFO(...) LOGGER_WRITE(LOGGER_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOGGER_INFO(...) do {} while (0)
+#endif
+
+#if LOGGER_LEVEL >= LOGGER_LEVEL_DEBUG
+#define LOGGER_DEBUG(...) LOGGER_WRITE(LOGGER_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOGGER_DEBUG(...) do {} while (0)
+#endif
+
+#endif // LOGGER_H
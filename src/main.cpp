@@ -1,4 +1,5 @@
 #include <Arduino.h>
+#include <esp_timer.h>
 #include "config.h"
 #ifdef __has_include
     #if __has_include("secrets.h")
@@ -13,6 +14,21 @@
 #include "ble_manager.h"
 // #include "web_server_manager.h" // Removed - using IoTWebUIManager instead
 #include "time_manager.h"
+#include "sample_ring.h"
+#include "history_manager.h"
+#include "config_store.h"
+#include "tick_scheduler.h"
+#include "spsc_queue.h"
+#include "seqlock.h"
+#include "histogram.h"
+#include "diagnostics_manager.h"
+#include "trace.h"
+#include "alloc_tracker.h"
+#include "json_arena.h"
+#include "api_fields.h"
+#include "logger.h"
+#include "measurement_store.h"
+#include "event_bus.h"
 
 // Enhanced web interface
 #include <WebServer.h>
@@ -27,22 +43,72 @@ DisplayManager displayManager;
 BLEManager bleManager;
 // WebServerManager webServerManager; // Removed - using IoTWebUIManager instead
 TimeManager timeManager;
+HistoryManager historyManager;
+ConfigStore configStore;
 
 // Enhanced web interface manager
 IoTWebUIManager* webManager = nullptr;
 
-// Application state
-bool systemReady = false;
-unsigned long lastDisplayUpdate = 0;
-const unsigned long DISPLAY_UPDATE_INTERVAL = 2000; // 2 seconds
+// Schedulers of the two pinned tasks, timed with micros(), run times from the 64-bit esp_timer
+LoopScheduler sensingScheduler([]() -> uint32_t { return micros(); },
+                               []() -> uint64_t { return (uint64_t)esp_timer_get_time(); });
+LoopScheduler networkScheduler([]() -> uint32_t { return micros(); },
+                               []() -> uint64_t { return (uint64_t)esp_timer_get_time(); });
+DiagnosticsManager diagnosticsManager;
+
+// Recent samples for incremental ?since= queries, owned by the network task
+SampleRing<ChannelSample, SAMPLE_RING_SIZE> indoorSamples;
+SampleRing<ChannelSample, SAMPLE_RING_SIZE> outdoorSamples;
+
+// Indoor samples handed from the sensing task, and the newest of each
+// source as the network task last saw them, for history
+SpscQueue<ChannelSample, INDOOR_HANDOFF_QUEUE_SIZE> indoorHandoff;
+ChannelSample latestIndoor;
+ChannelSample latestOutdoor;
+
+// Sensor frame received to finished display update, in microseconds; sensing task only
+LogHistogram<24> sensorToDisplayUs;
+
+// Sensing task statistics as the network task reports them, copied by the
+// sensing task every TASK_STATS_PERIOD_MS
+struct SensingStats {
+    EventBusStats events;
+    LogHistogram<24> sensorToDisplayUs;
+};
+SeqLock<SensingStats> sensingStats;
+
+// Set by display events, cleared by the redraw; sensing task only
+bool displayDirty = false;
+bool displayLatencyPending = false;
+uint32_t displayLatencyStartUs = 0;  // Oldest indoor sample not yet on screen
+
+// API documents are built here instead of on the heap
+JsonArena<JSON_ARENA_SIZE> jsonArena;
 
 // Forward declarations
+void setupScheduler();
+void sensingTask(void* parameter);
+void networkTask(void* parameter);
+void setupEvents();
+void updateDisplay(const StationsView& view);
+void refreshDisplay();
+void publishSensingStats();
+void onIndoorSample(const Event& event);
+void onDisplayEvent(const Event& event);
+void drainSamples();
 String generateSensorDataJSON();
+String generateSamplesSinceJSON(uint32_t since);
 void handleConfigSave(const String& data);
 void setupCustomNavigation();
 String generateHomeContent();
 String generateConfigContent();
 void resetHandler();
+void captivePortalHandler();
+void historyHandler();
+void chartHandler();
+void latencyHandler();
+void traceHandler();
+void heapHandler();
 
 
 void setup()
@@ -51,14 +117,29 @@ void setup()
   delay(100);
   
   Serial.println("WeatherStation Indoor Starting...");
+  loggerBegin();
 
-  // Initialize enhanced web interface manager first so Preferences are available
+  // Load configuration once; everything else reads it from RAM
+  configStore.begin();
+
+  // Initialize enhanced web interface manager
   WebServer* webServer = new WebServer(80);
-  webManager = new IoTWebUIManager(webServer, new Preferences(), "WeatherStation", "weatherconfig");
+  webManager = new IoTWebUIManager(webServer, new Preferences(), "WeatherStation", CONFIG_NAMESPACE);
   webManager->begin();
   
   // Register reset endpoint
   webServer->on(ENDPOINT_RESET, resetHandler);
+  webServer->on(ENDPOINT_HISTORY, historyHandler);
+  webServer->on(ENDPOINT_CHART, chartHandler);
+  webServer->on(ENDPOINT_DEBUG_LATENCY, latencyHandler);
+  webServer->on(ENDPOINT_DEBUG_TRACE, traceHandler);
+  webServer->on(ENDPOINT_DEBUG_HEAP, heapHandler);
+  
+  // Connectivity checks made by phones and laptops joining the portal AP
+  webServer->on("/generate_204", captivePortalHandler);
+  webServer->on("/hotspot-detect.html", captivePortalHandler);
+  webServer->on("/connecttest.txt", captivePortalHandler);
+  webServer->on("/fwlink", captivePortalHandler);
 
 
 
@@ -94,113 +175,494 @@ void setup()
   // Initialize time synchronization
   timeManager.begin();
   
-  // Debug mDNS setup
-  Serial.println("Setting up mDNS...");
-  if (MDNS.begin("weatherstation")) {
-    Serial.println("mDNS responder started");
-    Serial.println("Address: weatherstation.local");
-  } else {
-    Serial.println("Error setting up mDNS responder!");
-  }
+  // mDNS is started by the WiFi manager under the configured hostname once connected
 
-  // Initialize display
+  // Initialize display, then hook consumers up to the managers' events
   displayManager.begin();
+  setupEvents();
 
   // Initialize sensor
   sensorManager.begin();
 
-  // Initialize BLE server
+  // Initialize BLE server with the stored radio profile
+  BleProfile bleProfile = BLE_PROFILE_BALANCED;
+  bleProfileFromName(configStore.get().bleProfile.c_str(), bleProfile);
+  bleManager.setProfile(bleProfile);
   bleManager.begin();
 
-  systemReady = true;
+  // Mount long-term history storage
+  historyManager.begin();
+
+  // Register the scheduled tasks last so their first runs are not already late
+  setupScheduler();
+  xTaskCreatePinnedToCore(sensingTask, "sensing", SENSING_TASK_STACK, nullptr,
+                          SENSING_TASK_PRIORITY, nullptr, SENSING_TASK_CORE);
+  xTaskCreatePinnedToCore(networkTask, "network", NETWORK_TASK_STACK, nullptr,
+                          NETWORK_TASK_PRIORITY, nullptr, NETWORK_TASK_CORE);
+
   Serial.println("WeatherStation Indoor Ready!");
 }
 
+// Everything runs in the pinned tasks, the Arduino loop task is not needed
 void loop()
 {
-  if (!systemReady) return;
-
-  // Update all managers
-  wifiManager.checkConnection();
-  sensorManager.update();
-  bleManager.update();
-  if (webManager) {
-    webManager->handleClient(); // Use enhanced web interface manager
+  vTaskDelete(nullptr);
+}
+
+// ===== SCHEDULED TASKS =====
+
+void setupScheduler() {
+  // Sensing core; registration order is run order within a pass
+  sensingScheduler.addTask("sensor", []() { sensorManager.update(); },
+                           TASK_SENSOR_PERIOD_MS, TASK_SENSOR_DEADLINE_MS, TASK_SENSOR_BUDGET_US);
+  sensingScheduler.addTask("ble", []() { bleManager.update(); },
+                           TASK_BLE_PERIOD_MS, TASK_BLE_DEADLINE_MS, TASK_BLE_BUDGET_US);
+  sensingScheduler.addTask("events", []() { eventBus().dispatch(); },
+                           TASK_EVENTS_PERIOD_MS, TASK_EVENTS_DEADLINE_MS, TASK_EVENTS_BUDGET_US);
+  sensingScheduler.addTask("display", refreshDisplay,
+                           TASK_DISPLAY_PERIOD_MS, TASK_DISPLAY_DEADLINE_MS, TASK_DISPLAY_BUDGET_US);
+  sensingScheduler.addTask("stats", publishSensingStats,
+                           TASK_STATS_PERIOD_MS, TASK_STATS_DEADLINE_MS, TASK_STATS_BUDGET_US);
+  
+  // Network core
+  networkScheduler.addTask("wifi", []() { wifiManager.checkConnection(); },
+                           TASK_WIFI_PERIOD_MS, TASK_WIFI_DEADLINE_MS, TASK_WIFI_BUDGET_US);
+  networkScheduler.addTask("web", []() { if (webManager) webManager->handleClient(); },
+                           TASK_WEB_PERIOD_MS, TASK_WEB_DEADLINE_MS, TASK_WEB_BUDGET_US);
+  networkScheduler.addTask("time", []() { timeManager.update(); },
+                           TASK_TIME_PERIOD_MS, TASK_TIME_DEADLINE_MS, TASK_TIME_BUDGET_US);
+  networkScheduler.addTask("samples", drainSamples,
+                           TASK_SAMPLES_PERIOD_MS, TASK_SAMPLES_DEADLINE_MS, TASK_SAMPLES_BUDGET_US);
+  networkScheduler.addTask("history", []() { historyManager.update(timeManager.getEpoch(), latestIndoor, latestOutdoor); },
+                           TASK_HISTORY_PERIOD_MS, TASK_HISTORY_DEADLINE_MS, TASK_HISTORY_BUDGET_US);
+  networkScheduler.addTask("console", []() { diagnosticsManager.update(); },
+                           TASK_CONSOLE_PERIOD_MS, TASK_CONSOLE_DEADLINE_MS, TASK_CONSOLE_BUDGET_US);
+  networkScheduler.addTask("stats", []() { diagnosticsManager.publish(networkScheduler); },
+                           TASK_STATS_PERIOD_MS, TASK_STATS_DEADLINE_MS, TASK_STATS_BUDGET_US);
+  
+  // One heap tag per network task, in task order (tag 0 is everything outside
+  // them); the sensing task rarely allocates and is counted with other tasks
+  for (uint8_t i = 0; i < networkScheduler.getTaskCount(); i++) {
+    allocTracker.registerTag(networkScheduler.getTask(i).name);
   }
+  networkScheduler.setTaskHook([](uint8_t index, bool starting) {
+    if (starting) {
+      allocTracker.enter(index + 1);
+    } else {
+      allocTracker.leave();
+    }
+  });
+  diagnosticsManager.begin();
+  diagnosticsManager.addScheduler("sensing", &sensingScheduler);
+  diagnosticsManager.addScheduler("network", &networkScheduler);
+}
 
+// Sensing task: what the network task may read of its statistics
+void publishSensingStats() {
+  diagnosticsManager.publish(sensingScheduler);
+  sensingStats.update([](SensingStats& stats) {
+    stats.events = eventBus().getStats();
+    stats.sensorToDisplayUs = sensorToDisplayUs;
+  });
+}
 
-  timeManager.update();
-
-  // Update display with rate limiting
-  unsigned long currentTime = millis();
-  if (currentTime - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL) {
-    SensorData sensorData = sensorManager.getData();
-    OutdoorData outdoorData = bleManager.getData();
-    
-    DisplayData displayData = {
-      .tempIn = sensorData.temperature,
-      .humiIn = sensorData.humidity,
-      .iaq = sensorData.iaq,
-      .iaqAcc = sensorData.iaqAccuracy,
-      .tempOut = outdoorData.temperature,
-      .humiOut = outdoorData.humidity,
-      .press = outdoorData.pressure,
-      .batV = outdoorData.batteryVoltage,
-      .batP = outdoorData.batteryPercentage,
-      .timeString = timeManager.getCurrentTime()
-    };
-    
-    // Debug output
-    Serial.println("Updating display...");
-    Serial.println("Indoor: " + String(displayData.tempIn) + "°C, " + String(displayData.humiIn) + "%");
-    Serial.println("Outdoor: " + String(displayData.tempOut) + "°C, " + String(displayData.humiOut) + "%");
-    Serial.println("Time: " + displayData.timeString);
-    
-    displayManager.update(displayData);
-    lastDisplayUpdate = currentTime;
+// Run whatever is due; when nothing is, block so the idle task can
+// clock-gate the CPU instead of spinning through empty updates
+void sensingTask(void*) {
+  for (;;) {
+    uint32_t idleUs = sensingScheduler.run();
+    if (idleUs >= 1000) {
+      vTaskDelay(pdMS_TO_TICKS(min(idleUs / 1000, (uint32_t)SCHEDULER_MAX_IDLE_MS)));
+    }
   }
 }
 
-// ===== ENHANCED WEB INTERFACE CALLBACKS =====
+// Core 0's idle task feeds the watchdog, so this one sleeps at least a tick every pass
+void networkTask(void*) {
+  allocTrackerBegin();  // Heap tags are the network task's subsystems
+  for (;;) {
+    uint32_t idleUs = networkScheduler.run();
+    vTaskDelay(pdMS_TO_TICKS(constrain(idleUs / 1000, (uint32_t)1, (uint32_t)SCHEDULER_MAX_IDLE_MS)));
+  }
+}
 
-String generateSensorDataJSON() {
-    JsonDocument doc;
-    
-    doc["timestamp"] = millis();
-    doc["status"] = "running";
+// ===== EVENTS =====
+
+// Subscription order is delivery order: samples are handed off before the display redraws.
+// Handlers run on the sensing task.
+void setupEvents() {
+  AppEventBus& bus = eventBus();
+  bus.subscribe(EVENT_MASK(EVENT_INDOOR_SAMPLE), onIndoorSample);
+  bus.subscribe(EVENT_MASK(EVENT_INDOOR_SAMPLE) | EVENT_MASK(EVENT_OUTDOOR_SAMPLE) |
+                EVENT_MASK(EVENT_TIME_MINUTE), onDisplayEvent);
+}
+
+// Only marks the screen; the indoor event is published from inside the sensor
+// poll, which should not wait for a redraw
+void onDisplayEvent(const Event& event) {
+  if (event.type == EVENT_TIME_MINUTE) {
+    // Formatted from the event, the time manager's strings belong to the network task
+    char time[6];
+    uint32_t minuteOfDay = event.minute % 1440;
+    snprintf(time, sizeof(time), "%02u:%02u", (unsigned)(minuteOfDay / 60), (unsigned)(minuteOfDay % 60));
+    displayManager.updateTime(time);
+  }
+  if (event.type == EVENT_INDOOR_SAMPLE && !displayLatencyPending) {
+    displayLatencyStartUs = sensorManager.getReceivedUs();
+    displayLatencyPending = true;
+  }
+  displayDirty = true;
+}
+
+// Display task, every TASK_DISPLAY_PERIOD_MS: one redraw for whatever was
+// marked since, and a look at the station rotation, at most every
+// DISPLAY_MIN_REDRAW_MS. The display diffs at drawn precision, so a pass that
+// changes nothing on screen costs no redraw.
+void refreshDisplay() {
+  static uint32_t lastRefreshMs = 0;
+  uint32_t now = millis();
+  if (now - lastRefreshMs < DISPLAY_MIN_REDRAW_MS) return;
+  StationsView view;
+  bleManager.getStations(view);
+  if (!displayDirty && view.count <= 1) return;
+  lastRefreshMs = now;
+  displayDirty = false;
+  updateDisplay(view);
+  if (displayLatencyPending) {
+    sensorToDisplayUs.record(micros() - displayLatencyStartUs);
+    displayLatencyPending = false;
+  }
+}
+
+void updateDisplay(const StationsView& view) {
+  const MeasurementStore& store = measurements();
+  
+  // Rotate through the outdoor stations, one per DISPLAY_STATION_ROTATE_MS
+  uint8_t stationCount = view.count;
+  uint8_t station = stationCount > 1 ? (millis() / DISPLAY_STATION_ROTATE_MS) % stationCount : 0;
+  
+  DisplayData displayData;
+  for (uint8_t id = 0; id < CHANNEL_COUNT; id++) {
+    displayData.values[id] = store.value((ChannelId)id);
+  }
+  displayData.station = station;
+  displayData.stationCount = stationCount;
+  displayData.outdoorStaleMin = 0;
+  uint32_t outdoorTakenMs = store.get(CH_OUTDOOR_TEMPERATURE).timestampMs;
+  
+  // The outdoor channels follow the primary station, the others come from the station table
+  if (station < view.count && station != view.primary) {
+    const ChannelSample& outdoorData = view.stations[station].data.sample;
+    const ChannelGroupInfo& outdoor = CHANNEL_GROUPS[CHANNEL_GROUP_OUTDOOR];
+    for (uint8_t id = outdoor.first; id < outdoor.end; id++) {
+      displayData.values[id] = outdoorData.values[id];
+    }
+    outdoorTakenMs = outdoorData.timestamp;
+  }
+  
+  // Age in whole minutes once stale, so the screen redraws at most once a minute for it
+  uint32_t now = millis();
+  if (view.freshness(station, now) == LINK_FRESH_STALE) {
+    displayData.outdoorStaleMin = (uint16_t)min((now - outdoorTakenMs) / 60000, (uint32_t)UINT16_MAX);
+  }
+  
+  LOGGER_DEBUG("Updating display - Indoor: %.2f°C, %.2f%%, Outdoor: %.2f°C, %.2f%%",
+               displayData.values[CH_INDOOR_TEMPERATURE], displayData.values[CH_INDOOR_HUMIDITY],
+               displayData.values[CH_OUTDOOR_TEMPERATURE], displayData.values[CH_OUTDOOR_HUMIDITY]);
+  
+  displayManager.update(displayData);
+}
+
+// ===== SAMPLE HISTORY =====
+
+// Sensing task: passes the reading to the network task and notifies BLE clients
+void onIndoorSample(const Event&) {
+    static uint32_t handedOff = 0;
+    const ChannelSample& sensorData = sensorManager.getData();
+    if (sensorManager.hasNewData(handedOff)) {
+        handedOff = sensorData.sequence;
+        indoorHandoff.push(sensorData);
+        
+        const MeasurementStore& store = measurements();
+        IndoorSnapshot snapshot;
+        snapshot.sequence = sensorData.sequence;
+        snapshot.temperature = store.value(CH_INDOOR_TEMPERATURE);
+        snapshot.humidity = store.value(CH_INDOOR_HUMIDITY);
+        snapshot.pressure = store.value(CH_INDOOR_PRESSURE);
+        snapshot.iaq = (uint16_t)constrain(store.value(CH_INDOOR_IAQ), 0.0f, (float)UINT16_MAX);
+        snapshot.iaqAccuracy = (uint8_t)constrain(store.value(CH_INDOOR_IAQ_ACCURACY), 0.0f, 3.0f);
+        bleManager.publishIndoor(snapshot);
+    }
+}
+
+// Network task: samples reach the rings here, on the task that serves them
+void drainSamples() {
+    ChannelSample indoorData;
+    while (indoorHandoff.pop(indoorData)) {
+        indoorSamples.push(indoorData);
+        latestIndoor = indoorData;
+    }
     
-    // Get sensor data from global managers
-    SensorData sensorData = sensorManager.getData();
-    OutdoorData outdoorData = bleManager.getData();
+    // Every sample of the primary station is queued by the BLE task, backfilled ones included
+    ChannelSample outdoorData;
+    while (bleManager.popSample(outdoorData)) {
+        if (outdoorData.sequence > outdoorSamples.latestSequence()) {
+            outdoorSamples.push(outdoorData);
+        }
+        latestOutdoor = outdoorData;
+    }
+}
+
+// ===== API FIELD TABLE =====
+
+// Summary plus raw log2 bucket counts (bucket i covers values below 2^i)
+template <uint8_t N>
+void writeHistogram(JsonObject out, const LogHistogram<N>& histogram) {
+    out["count"] = histogram.getCount();
+    out["p50"] = histogram.percentile(50);
+    out["p99"] = histogram.percentile(99);
+    out["max"] = histogram.getMax();
+    JsonArray buckets = out["buckets"].to<JsonArray>();
+    for (uint8_t i = 0; i < N; i++) {
+        buckets.add(histogram.getBucket(i));
+    }
+}
+
+// Every task of both schedulers, from the copies their own tasks published
+void writeSchedulerStats(JsonArray out) {
+    for (uint8_t s = 0; s < diagnosticsManager.getSchedulerCount(); s++) {
+        const LoopSchedulerView& view = diagnosticsManager.readScheduler(s);
+        for (uint8_t i = 0; i < view.taskCount; i++) {
+            const TickTask& task = view.tasks[i];
+            JsonObject entry = out.add<JsonObject>();
+            entry["name"] = task.name;
+            entry["loop"] = diagnosticsManager.getSchedulerName(s);
+            entry["runs"] = task.stats.runs;
+            entry["overruns"] = task.stats.overruns;
+            entry["missed_deadlines"] = task.stats.missedDeadlines;
+            entry["avg_us"] = task.stats.runs ? (uint32_t)(task.stats.totalUs / task.stats.runs) : 0;
+            entry["max_us"] = task.stats.maxUs;
+            entry["budget_us"] = task.budgetUs;
+        }
+    }
+}
+
+// The channel rows of API_FIELDS, from the measurement store
+size_t writeChannels(JsonDocument& doc, const char* group, const char* fields) {
+    return writeChannelFields(doc, measurements(), group, fields);
+}
+
+// Every outdoor station, the primary one is also under "outdoor"
+void writeStations(JsonArray out) {
+    uint32_t now = millis();
+    StationsView view;
+    bleManager.getStations(view);
+    for (uint8_t i = 0; i < view.count; i++) {
+        const StationView& station = view.stations[i];
+        char address[18];
+        formatStationAddress(address, sizeof(address), station.address);
+        JsonObject entry = out.add<JsonObject>();
+        entry["address"] = address;
+        entry["primary"] = i == view.primary;
+        writeChannelValues(entry, station.data.sample, CHANNEL_GROUP_OUTDOOR);
+        entry["sequence"] = station.data.sample.sequence;
+        entry["writes"] = station.writes;
+        entry["last_seen_s"] = (now - station.lastSeenMs) / 1000;
+        entry["age_s"] = (now - station.data.sample.timestamp) / 1000;
+        
+        JsonObject linkOut = entry["link"].to<JsonObject>();
+        linkOut["state"] = linkFreshnessName(station.freshness(now));
+        linkOut["connected"] = station.connected;
+        linkOut["disconnects"] = station.disconnects;
+        linkOut["arrivals"] = station.metrics.getArrivals();
+        linkOut["interval_ms"] = station.metrics.getMeanMs();
+        linkOut["jitter_ms"] = station.metrics.getJitterMs();
+        linkOut["min_ms"] = station.metrics.getMinMs();
+        linkOut["max_ms"] = station.metrics.getMaxMs();
+        linkOut["gaps"] = station.metrics.getGaps();
+        linkOut["longest_gap_s"] = station.metrics.getLongestGapMs() / 1000;
+    }
+}
+
+// The BLE host task's counters as of its latest callback, one copy per field
+BleStatsView readBleStats() {
+    BleStatsView stats;
+    bleManager.getStats(stats);
+    return stats;
+}
+
+// The sensing task's latest published statistics; network task only, the
+// copy is kept off its stack and valid until the next call
+const SensingStats& readSensingStats() {
+    static SensingStats stats;
+    sensingStats.read(stats);
+    return stats;
+}
+
+// Settings, radio current estimates and measured timings of every profile
+void writeBleProfiles(JsonArray out) {
+    BleStatsView bleStats = readBleStats();
+    for (uint8_t i = 0; i < BLE_PROFILE_COUNT; i++) {
+        const BleProfileSettings& profile = BLE_PROFILES[i];
+        const BleProfileStats& stats = bleStats.profiles[i];
+        JsonObject entry = out.add<JsonObject>();
+        entry["name"] = profile.name;
+        entry["adv_ms_min"] = bleAdvIntervalMs(profile.advMin);
+        entry["adv_ms_max"] = bleAdvIntervalMs(profile.advMax);
+        entry["tx_dbm"] = profile.txPowerDbm;
+        entry["conn_ms_min"] = bleConnIntervalMs(profile.connMin);
+        entry["conn_ms_max"] = bleConnIntervalMs(profile.connMax);
+        entry["latency"] = profile.latency;
+        entry["advertising_ua"] = bleAdvertisingCurrentUa(profile);
+        entry["connected_ua"] = bleConnectedCurrentUa(profile);
+        writeHistogram(entry["setup_ms"].to<JsonObject>(), stats.setupMs);
+        writeHistogram(entry["reconnect_ms"].to<JsonObject>(), stats.reconnectMs);
+    }
+}
+
+// Dotted quad into a caller buffer, IPAddress::toString() allocates a String
+void formatIPAddress(char* out, size_t size, const IPAddress& ip) {
+    snprintf(out, size, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+}
+
+const char* linkStateName(LinkState state) {
+    switch (state) {
+        case LINK_CONNECTED: return "connected";
+        case LINK_BACKOFF: return "backoff";
+        case LINK_CONNECTING: return "connecting";
+    }
+    return "unknown";
+}
+
+// Fields of the /api/status document, in document order; the group rows
+// stand for the channels of CHANNELS, see writeChannels()
+const ApiField API_FIELDS[] = {
+    {"timestamp",                  [](JsonDocument& doc) { doc["timestamp"] = millis(); }},
+    {"status",                     [](JsonDocument& doc) { doc["status"] = "running"; }},
     
     // Indoor sensor data
-    doc["indoor"]["temperature"] = sensorData.temperature;
-    doc["indoor"]["humidity"] = sensorData.humidity;
-    doc["indoor"]["pressure"] = sensorData.pressure;
-    doc["indoor"]["iaq"] = sensorData.iaq;
-    doc["indoor"]["iaq_accuracy"] = sensorData.iaqAccuracy;
-    doc["indoor"]["gas"] = sensorData.gas;
-    doc["indoor"]["altitude"] = sensorData.altitude;
+    {"indoor",                     nullptr},
+    {"indoor.sequence",            [](JsonDocument& doc) { doc["indoor"]["sequence"] = latestIndoor.sequence; }},
     
     // Outdoor sensor data (from BLE)
-    doc["outdoor"]["temperature"] = outdoorData.temperature;
-    doc["outdoor"]["humidity"] = outdoorData.humidity;
-    doc["outdoor"]["pressure"] = outdoorData.pressure;
-    doc["outdoor"]["battery_voltage"] = outdoorData.batteryVoltage;
-    doc["outdoor"]["battery_percentage"] = outdoorData.batteryPercentage;
+    {"outdoor",                    nullptr},
+    {"outdoor.sequence",           [](JsonDocument& doc) { doc["outdoor"]["sequence"] = latestOutdoor.sequence; }},
+    {"outdoor.age_s",              [](JsonDocument& doc) { Measurement m = measurements().get(CH_OUTDOOR_TEMPERATURE); doc["outdoor"]["age_s"] = m.version ? (millis() - m.timestampMs) / 1000 : 0; }},
+    {"outdoor.state",              [](JsonDocument& doc) { StationsView view; bleManager.getStations(view); doc["outdoor"]["state"] = linkFreshnessName(view.freshness(view.primary, millis())); }},
+    {"stations",                   [](JsonDocument& doc) { writeStations(doc["stations"].to<JsonArray>()); }},
+    
+    // Outdoor protocol counters
+    {"ble.frames",                 [](JsonDocument& doc) { doc["ble"]["frames"] = readBleStats().protocol.frames; }},
+    {"ble.legacy_frames",          [](JsonDocument& doc) { doc["ble"]["legacy_frames"] = readBleStats().protocol.legacyFrames; }},
+    {"ble.rejected",               [](JsonDocument& doc) { doc["ble"]["rejected"] = readBleStats().protocol.rejected; }},
+    {"ble.crc_errors",             [](JsonDocument& doc) { doc["ble"]["crc_errors"] = readBleStats().protocol.crcErrors; }},
+    {"ble.duplicates",             [](JsonDocument& doc) { doc["ble"]["duplicates"] = readBleStats().protocol.duplicates; }},
+    {"ble.lost_samples",           [](JsonDocument& doc) { doc["ble"]["lost_samples"] = readBleStats().protocol.lostSamples; }},
+    {"ble.restarts",               [](JsonDocument& doc) { doc["ble"]["restarts"] = readBleStats().protocol.restarts; }},
+    {"ble.backfilled",             [](JsonDocument& doc) { doc["ble"]["backfilled"] = readBleStats().protocol.backfilled; }},
+    {"ble.queue_drops",            [](JsonDocument& doc) { doc["ble"]["queue_drops"] = bleManager.getSampleQueueDrops(); }},
+    {"ble.notifications",          [](JsonDocument& doc) { doc["ble"]["notifications"] = bleManager.getIndoorNotifications(); }},
+    {"ble.notify_suppressed",      [](JsonDocument& doc) { doc["ble"]["notify_suppressed"] = bleManager.getIndoorSuppressed(); }},
+    {"ble.profile",                [](JsonDocument& doc) { doc["ble"]["profile"] = bleProfileSettings(bleManager.getProfile()).name; }},
+    {"ble.profiles",               [](JsonDocument& doc) { writeBleProfiles(doc["ble"]["profiles"].to<JsonArray>()); }},
+    {"ble.mtu",                    [](JsonDocument& doc) { doc["ble"]["mtu"] = readBleStats().mtu; }},
+    {"ble.rx_bytes",               [](JsonDocument& doc) { doc["ble"]["rx_bytes"] = readBleStats().transfer.bytes; }},
+    {"ble.writes",                 [](JsonDocument& doc) { doc["ble"]["writes"] = readBleStats().transfer.writes; }},
+    {"ble.fragments",              [](JsonDocument& doc) { doc["ble"]["fragments"] = readBleStats().transfer.fragments; }},
+    {"ble.throughput_bps",         [](JsonDocument& doc) { doc["ble"]["throughput_bps"] = readBleStats().transfer.lastBytesPerSecond; }},
+    {"ble.batch_ms",               [](JsonDocument& doc) { writeHistogram(doc["ble"]["batch_ms"].to<JsonObject>(), readBleStats().transfer.batchLatencyMs); }},
     
     // Time information
-    doc["time"]["current"] = timeManager.getCurrentTime();
-    doc["time"]["date"] = timeManager.getCurrentDate();
-    doc["time"]["datetime"] = timeManager.getCurrentDateTime();
+    {"time.current",               [](JsonDocument& doc) { doc["time"]["current"] = timeManager.getCurrentTime(); }},
+    {"time.date",                  [](JsonDocument& doc) { doc["time"]["date"] = timeManager.getCurrentDate(); }},
+    {"time.datetime",              [](JsonDocument& doc) { doc["time"]["datetime"] = timeManager.getCurrentDateTime(); }},
+    {"time.quality",               [](JsonDocument& doc) { doc["time"]["quality"] = timeManager.getQualityName(); }},
     
     // WiFi status
-    doc["wifi"]["connected"] = WiFi.status() == WL_CONNECTED;
-    doc["wifi"]["ip"] = WiFi.localIP().toString();
-    doc["wifi"]["rssi"] = WiFi.RSSI();
+    {"wifi.connected",             [](JsonDocument& doc) { doc["wifi"]["connected"] = WiFi.status() == WL_CONNECTED; }},
+    {"wifi.ip",                    [](JsonDocument& doc) { char ip[16]; formatIPAddress(ip, sizeof(ip), WiFi.localIP()); doc["wifi"]["ip"] = ip; }},
+    {"wifi.rssi",                  [](JsonDocument& doc) { doc["wifi"]["rssi"] = WiFi.RSSI(); }},
+    {"wifi.state",                 [](JsonDocument& doc) { doc["wifi"]["state"] = linkStateName(wifiManager.getLinkState()); }},
+    {"wifi.drops",                 [](JsonDocument& doc) { doc["wifi"]["drops"] = wifiManager.getLinkStats().drops; }},
+    {"wifi.reconnect_attempts",    [](JsonDocument& doc) { doc["wifi"]["reconnect_attempts"] = wifiManager.getLinkStats().attempts; }},
+    {"wifi.portal",                [](JsonDocument& doc) { doc["wifi"]["portal"] = wifiManager.isPortalActive(); }},
+    {"wifi.downtime_s",            [](JsonDocument& doc) { doc["wifi"]["downtime_s"] = wifiManager.getDowntimeSeconds(); }},
+    {"wifi.connect_ms.fast",       [](JsonDocument& doc) { writeHistogram(doc["wifi"]["connect_ms"]["fast"].to<JsonObject>(), wifiManager.getFastConnectHistogram()); }},
+    {"wifi.connect_ms.full",       [](JsonDocument& doc) { writeHistogram(doc["wifi"]["connect_ms"]["full"].to<JsonObject>(), wifiManager.getFullConnectHistogram()); }},
+    
+    // Event bus
+    {"events.published",           [](JsonDocument& doc) { JsonObject out = doc["events"]["published"].to<JsonObject>(); const SensingStats& stats = readSensingStats(); for (uint8_t i = 0; i < EVENT_TYPE_COUNT; i++) out[eventTypeName((EventType)i)] = stats.events.published[i]; }},
+    {"events.deliveries",          [](JsonDocument& doc) { doc["events"]["deliveries"] = readSensingStats().events.deliveries; }},
+    {"events.dropped",             [](JsonDocument& doc) { doc["events"]["dropped"] = eventBus().getDropped(); }},
+    
+    // Loop scheduler
+    {"scheduler.tasks",            [](JsonDocument& doc) { writeSchedulerStats(doc["scheduler"]["tasks"].to<JsonArray>()); }},
+    {"scheduler.handoff_drops",    [](JsonDocument& doc) { doc["scheduler"]["handoff_drops"] = indoorHandoff.getRejected(); }},
+    {"display.latency_us",         [](JsonDocument& doc) { writeHistogram(doc["display"]["latency_us"].to<JsonObject>(), readSensingStats().sensorToDisplayUs); }},
+};
+const size_t API_FIELD_COUNT = sizeof(API_FIELDS) / sizeof(API_FIELDS[0]);
+
+// ===== ENHANCED WEB INTERFACE CALLBACKS =====
+
+String generateSensorDataJSON() {
+    TRACE_SCOPE("http.status");
+    // Incremental poll: /api/status?since=<seq>
+    WebServer* server = webManager ? webManager->getServer() : nullptr;
+    if (server && server->hasArg("since")) {
+        return generateSamplesSinceJSON(strtoul(server->arg("since").c_str(), nullptr, 10));
+    }
+    
+    // Field projection: /api/status?fields=indoor.iaq,outdoor.battery_percentage
+    const char* fields = nullptr;
+    String fieldList;
+    if (server && server->hasArg("fields")) {
+        fieldList = server->arg("fields");
+        if (fieldList.length() > 0) fields = fieldList.c_str();
+    }
     
     String jsonString;
-    serializeJson(doc, jsonString);
+    {
+        JsonDocument doc(&jsonArena);
+        writeApiFields(doc, API_FIELDS, API_FIELD_COUNT, fields, writeChannels);
+        // The returned String is the only heap block: sized once, filled once
+        jsonString.reserve(measureJson(doc));
+        serializeJson(doc, jsonString);
+    }
+    jsonArena.reset();
+    return jsonString;
+}
+
+String generateSamplesSinceJSON(uint32_t since) {
+    String jsonString;
+    {
+        JsonDocument doc(&jsonArena);
+    
+        doc["timestamp"] = millis();
+        doc["since"] = since;
+        doc["sequence"] = max(indoorSamples.latestSequence(), outdoorSamples.latestSequence());
+        // Samples newer than `since` were evicted before this poll
+        doc["truncated"] = indoorSamples.hasGapAfter(since) || outdoorSamples.hasGapAfter(since);
+    
+        JsonArray indoor = doc["indoor"].to<JsonArray>();
+        indoorSamples.forEachSince(since, [&indoor](const ChannelSample& sample) {
+            JsonObject item = indoor.add<JsonObject>();
+            item["sequence"] = sample.sequence;
+            item["timestamp"] = sample.timestamp;
+            writeChannelValues(item, sample, CHANNEL_GROUP_INDOOR);
+        });
+    
+        JsonArray outdoor = doc["outdoor"].to<JsonArray>();
+        outdoorSamples.forEachSince(since, [&outdoor](const ChannelSample& sample) {
+            JsonObject item = outdoor.add<JsonObject>();
+            item["sequence"] = sample.sequence;
+            item["timestamp"] = sample.timestamp;
+            writeChannelValues(item, sample, CHANNEL_GROUP_OUTDOOR);
+        });
+    
+        jsonString.reserve(measureJson(doc));
+        serializeJson(doc, jsonString);
+    }
+    jsonArena.reset();
     return jsonString;
 }
 
@@ -213,47 +675,44 @@ void handleConfigSave(const String& data) {
         return;
     }
     
-    // Save timezone
-    if (doc.containsKey("timezone")) {
-        String timezone = doc["timezone"].as<String>();
-        webManager->setConfigValue("timezone", timezone);
-        timeManager.setTimezone(timezone);
-        Serial.println("Saved timezone: " + timezone);
-    }
+    // Collect all changes, then write them to NVS as one batch
+    StationConfig updated = configStore.get();
+    if (doc.containsKey("timezone")) updated.timezone = doc["timezone"].as<String>();
+    if (doc.containsKey("hostname")) updated.hostname = doc["hostname"].as<String>();
+    if (doc.containsKey("ap_ssid")) updated.apSSID = doc["ap_ssid"].as<String>();
+    if (doc.containsKey("ap_password")) updated.apPassword = doc["ap_password"].as<String>();
+    if (doc.containsKey("wifi_ssid")) updated.wifiSSID = doc["wifi_ssid"].as<String>();
+    if (doc.containsKey("wifi_password")) updated.wifiPassword = doc["wifi_password"].as<String>();
+    if (doc.containsKey("ble_profile")) updated.bleProfile = doc["ble_profile"].as<String>();
     
-    // Save WiFi settings
-    if (doc.containsKey("hostname")) {
-        String hostname = doc["hostname"].as<String>();
-        webManager->setConfigValue("hostname", hostname);
-        Serial.println("Saved hostname: " + hostname);
+    BleProfile bleProfile;
+    if (!bleProfileFromName(updated.bleProfile.c_str(), bleProfile)) {
+        Serial.println("Unknown BLE profile, keeping the current one");
+        updated.bleProfile = configStore.get().bleProfile;
     }
     
-    if (doc.containsKey("ap_ssid")) {
-        String apSSID = doc["ap_ssid"].as<String>();
-        webManager->setConfigValue("ap_ssid", apSSID);
-        Serial.println("Saved AP SSID: " + apSSID);
+    bool timezoneChanged = updated.timezone != configStore.get().timezone;
+    bool bleProfileChanged = updated.bleProfile != configStore.get().bleProfile;
+    bool wifiChanged = updated.wifiSSID != configStore.get().wifiSSID ||
+                       updated.wifiPassword != configStore.get().wifiPassword;
+    if (!configStore.save(updated)) {
+        Serial.println("Failed to save configuration");
+        return;
     }
     
-    if (doc.containsKey("ap_password")) {
-        String apPassword = doc["ap_password"].as<String>();
-        webManager->setConfigValue("ap_password", apPassword);
-        Serial.println("Saved AP password: [HIDDEN]");
+    if (timezoneChanged) {
+        timeManager.setTimezone(updated.timezone);
     }
-    
-    // Save home WiFi credentials
-    if (doc.containsKey("wifi_ssid")) {
-        String wifiSSID = doc["wifi_ssid"].as<String>();
-        webManager->setConfigValue("wifi_ssid", wifiSSID);
-        Serial.println("Saved WiFi SSID: " + wifiSSID);
+    if (wifiChanged) {
+        wifiManager.onCredentialsChanged();
     }
-    
-    if (doc.containsKey("wifi_password")) {
-        String wifiPassword = doc["wifi_password"].as<String>();
-        webManager->setConfigValue("wifi_password", wifiPassword);
-        Serial.println("Saved WiFi password: [HIDDEN]");
+    if (bleProfileChanged) {
+        bleManager.setProfile(bleProfile);
     }
     
-    Serial.println("Configuration saved successfully");
+    const NVSStats& nvs = configStore.getStats();
+    Serial.printf("Configuration saved successfully (NVS: %u reads, %u writes, %u commits)\n",
+                  (unsigned)nvs.reads, (unsigned)nvs.writes, (unsigned)nvs.commits);
 }
 
 // ===== CUSTOM NAVIGATION SETUP =====
@@ -267,34 +726,82 @@ void setupCustomNavigation() {
 
 // ===== CUSTOM CONTENT GENERATORS =====
 
+// Trend chart drawn client-side from the downsampled /chart endpoint
+const char CHART_SECTION_HTML[] = R"(
+<div style='display:flex;gap:8px;flex-wrap:wrap'>
+<select id='chart-channel'>
+<option value='indoor.temperature'>Indoor Temperature</option>
+<option value='indoor.humidity'>Indoor Humidity</option>
+<option value='indoor.iaq'>IAQ</option>
+<option value='outdoor.temperature'>Outdoor Temperature</option>
+<option value='outdoor.humidity'>Outdoor Humidity</option>
+<option value='outdoor.pressure'>Pressure</option>
+</select>
+<select id='chart-range'>
+<option value='86400'>24 hours</option>
+<option value='604800'>7 days</option>
+</select>
+</div>
+<svg id='chart' width='100%' height='160' style='margin-top:8px'><polyline fill='none' stroke='currentColor' stroke-width='1.5'/></svg>
+<div id='chart-info' style='font-size:12px'></div>
+<script>
+(function(){
+var svg=document.getElementById('chart'),line=svg.querySelector('polyline'),info=document.getElementById('chart-info');
+function draw(){
+var ch=document.getElementById('chart-channel').value,range=+document.getElementById('chart-range').value;
+var w=Math.max(100,Math.min(480,svg.clientWidth|0)),h=160,from=Math.floor(Date.now()/1000)-range;
+fetch('/chart?channel='+ch+'&width='+w+'&from='+from).then(function(r){return r.json();}).then(function(d){
+var p=d.points;if(!p.length){line.setAttribute('points','');info.textContent='No data';return;}
+var x0=p[0][0],x1=p[p.length-1][0]||x0+1,y0=Infinity,y1=-Infinity;
+p.forEach(function(q){y0=Math.min(y0,q[1]);y1=Math.max(y1,q[1]);});
+if(y1==y0){y1=y0+1;}
+line.setAttribute('points',p.map(function(q){return ((q[0]-x0)/(x1-x0||1)*w).toFixed(1)+','+(h-4-(q[1]-y0)/(y1-y0)*(h-8)).toFixed(1);}).join(' '));
+info.textContent='min '+y0+' / max '+y1+' ('+p.length+' points)';
+}).catch(function(){info.textContent='Chart unavailable';});
+}
+document.getElementById('chart-channel').onchange=draw;
+document.getElementById('chart-range').onchange=draw;
+draw();
+})();
+</script>
+)";
+
 String generateHomeContent() {
+    TRACE_SCOPE("http.home");
     String content = "";
     
-    // Get sensor data
-    SensorData sensorData = sensorManager.getData();
-    OutdoorData outdoorData = bleManager.getData();
-    
-    String names[] = {"Temperature", "Humidity", "Pressure", "IAQ", "Outdoor Temp", "Outdoor Humidity"};
-    float values[] = {
-        sensorData.temperature,
-        sensorData.humidity,
-        sensorData.pressure,
-        (float)sensorData.iaq,
-        outdoorData.temperature,
-        outdoorData.humidity
-    };
-    String units[] = {"°C", "%", "hPa", "", "°C", "%"};
-    content += IoTWebUI::getDataGrid(names, values, units, 6, 1);
+    // Channels flagged for the home page, in table order
+    const MeasurementStore& store = measurements();
+    String names[CHANNEL_COUNT];
+    float values[CHANNEL_COUNT];
+    String units[CHANNEL_COUNT];
+    int shown = 0;
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        if (!(CHANNELS[i].flags & CHANNEL_HOME)) continue;
+        names[shown] = CHANNELS[i].label;
+        values[shown] = store.value((ChannelId)i);
+        units[shown] = CHANNELS[i].unit;
+        shown++;
+    }
+    content += IoTWebUI::getDataGrid(names, values, units, shown, 1);
     
-    String statusLabels[] = {"WiFi Status", "IP Address", "Free Heap", "Uptime", "Outdoor Battery"};
+    char outdoorBattery[16];
+    formatChannel(outdoorBattery, sizeof(outdoorBattery), store, CH_OUTDOOR_BATTERY_PERCENTAGE);
+    
+    const NVSStats& nvs = configStore.getStats();
+    String statusLabels[] = {"WiFi Status", "IP Address", "Free Heap", "Uptime", "Outdoor Battery", "NVS Operations"};
     String statusValues[] = {
         WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected",
         WiFi.localIP().toString(),
-        String(ESP.getFreeHeap()) + " bytes",
+        String(ESP.getFreeHeap()) + " bytes (min " + String(ESP.getMinFreeHeap()) +
+            ", largest block " + String(ESP.getMaxAllocHeap()) + ")",
         String(millis() / 1000) + "s",
-        String(outdoorData.batteryPercentage) + "%"
+        outdoorBattery,
+        String(nvs.reads) + " reads, " + String(nvs.writes) + " writes, " + String(nvs.commits) + " commits"
     };
-    content += IoTWebUI::getKeyValueList(statusLabels, statusValues, 5, "System Status");
+    content += IoTWebUI::getKeyValueList(statusLabels, statusValues, 6, "System Status");
+    
+    content += IoTWebUI::getSection("Trends", CHART_SECTION_HTML);
     
     return content;
 }
@@ -302,25 +809,32 @@ String generateHomeContent() {
 String generateConfigContent() {
     String content = "<form id='config-form'>";
     
-    // Get current values
-    String currentTimezone = webManager->getConfigValue("timezone", "Europe/Riga");
-    String currentHostname = webManager->getConfigValue("hostname", "WeatherStation");
-    String currentAPSSID = webManager->getConfigValue("ap_ssid", "WeatherStation");
-    String currentAPPassword = webManager->getConfigValue("ap_password", "12345678");
-    String currentWiFiSSID = webManager->getConfigValue("wifi_ssid", "");
-    String currentWiFiPassword = webManager->getConfigValue("wifi_password", "");
-    
-
+    // Get current values from the configuration cache
+    const StationConfig& config = configStore.get();
+    const String& currentTimezone = config.timezone;
+    const String& currentHostname = config.hostname;
+    const String& currentAPSSID = config.apSSID;
+    const String& currentAPPassword = config.apPassword;
+    const String& currentWiFiSSID = config.wifiSSID;
+    const String& currentWiFiPassword = config.wifiPassword;
     
     // Time settings section
     String timezoneSelect = "<select id='timezone' name='timezone'>";
-    String timezones[] = {"Europe/Riga", "Europe/London", "Europe/Paris", "Europe/Berlin", 
-                         "Europe/Moscow", "America/New_York", "America/Los_Angeles", 
-                         "Asia/Tokyo", "UTC"};
-    for (const String& tz : timezones) {
-        timezoneSelect += "<option value='" + tz + "'";
-        if (tz == currentTimezone) timezoneSelect += " selected";
-        timezoneSelect += ">" + tz + "</option>";
+    const char* timezones[] = {"Europe/Riga", "Europe/London", "Europe/Paris", "Europe/Berlin", 
+                               "Europe/Moscow", "America/New_York", "America/Los_Angeles", 
+                               "Asia/Tokyo", "UTC"};
+    bool timezoneListed = false;
+    for (const char* tz : timezones) {
+        timezoneSelect += "<option value='" + String(tz) + "'";
+        if (currentTimezone == tz) {
+            timezoneSelect += " selected";
+            timezoneListed = true;
+        }
+        timezoneSelect += ">" + String(tz) + "</option>";
+    }
+    if (!timezoneListed) {
+        // Keep a timezone set outside the list (e.g. the build default) selectable
+        timezoneSelect += "<option value='" + currentTimezone + "' selected>" + currentTimezone + "</option>";
     }
     timezoneSelect += "</select>";
     
@@ -339,6 +853,21 @@ String generateConfigContent() {
     deviceSection += IoTWebUI::getFormGroup("Access Point Password", "", "password", currentAPPassword);
     content += IoTWebUI::getSection("Device Settings", deviceSection);
     
+    // Bluetooth settings section
+    String profileSelect = "<select id='ble_profile' name='ble_profile'>";
+    for (uint8_t i = 0; i < BLE_PROFILE_COUNT; i++) {
+        const BleProfileSettings& profile = BLE_PROFILES[i];
+        profileSelect += "<option value='" + String(profile.name) + "'";
+        if (config.bleProfile == profile.name) {
+            profileSelect += " selected";
+        }
+        profileSelect += ">" + String(profile.label) + " (~" + String(bleAdvertisingCurrentUa(profile) / 1000.0f, 1) + " mA advertising)</option>";
+    }
+    profileSelect += "</select>";
+    content += IoTWebUI::getSection("Bluetooth Settings",
+        IoTWebUI::getFormGroup("Radio Profile", profileSelect, "select")
+    );
+    
     // Action buttons
     content += IoTWebUI::getButton("Save Configuration", "primary");
     content += IoTWebUI::getButton("Back to Home", "secondary", "window.location.href=\"/\"");
@@ -365,10 +894,89 @@ void resetHandler() {
             delay(1000);
             ESP.restart();
         } else {
-            Serial.println("Starting WiFi configuration portal...");
-            webManager->getServer()->send(200, "text/plain", "Starting WiFi config portal. Connect to '" + String(WIFI_AP_SSID) + "' WiFi network, then visit http://" + String(WIFI_HOSTNAME) + ".local or any website.");
-            delay(1000);
-            wifiManager.startConfigPortalIfNeeded();
+            // Non-blocking: the portal runs alongside the station, nothing to wait for
+            const StationConfig& config = configStore.get();
+            webManager->getServer()->send(200, "text/plain", "Starting WiFi config portal. Connect to '" + config.apSSID + "' WiFi network, then visit http://" + config.hostname + ".local or any website.");
+            wifiManager.startConfigPortal();
         }
     }
-}
\ No newline at end of file
+}
+
+// Sends portal clients to the config page, answers normally otherwise
+void captivePortalHandler() {
+    WebServer* server = webManager ? webManager->getServer() : nullptr;
+    if (!server) return;
+    
+    if (wifiManager.isPortalActive()) {
+        server->sendHeader("Location", "http://" + WiFi.softAPIP().toString() + "/", true);
+        server->send(302, "text/plain", "");
+    } else {
+        server->send(204, "text/plain", "");
+    }
+}
+
+// GET /history?from=<epoch>&to=<epoch>&channels=indoor,outdoor.humidity&step=<s>&format=csv|ndjson
+void historyHandler() {
+    TRACE_SCOPE("http.history");
+    WebServer* server = webManager ? webManager->getServer() : nullptr;
+    if (!server) return;
+    
+    if (!historyManager.isReady()) {
+        server->send(503, "text/plain", "History storage not available");
+        return;
+    }
+    
+    uint32_t from = server->hasArg("from") ? strtoul(server->arg("from").c_str(), nullptr, 10) : 0;
+    uint32_t to = server->hasArg("to") ? strtoul(server->arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+    uint32_t step = server->hasArg("step") ? strtoul(server->arg("step").c_str(), nullptr, 10) : 0;
+    uint16_t mask = historyChannelMask(server->hasArg("channels") ? server->arg("channels").c_str() : "");
+    HistoryFormat format = server->arg("format") == "ndjson" ? HISTORY_FORMAT_NDJSON : HISTORY_FORMAT_CSV;
+    
+    if (from > to || mask == 0) {
+        server->send(400, "text/plain", "Invalid range or channel list");
+        return;
+    }
+    
+    size_t rows = historyManager.streamRange(server, from, to, mask, step, format);
+    Serial.printf("History export: %u rows\n", (unsigned)rows);
+}
+
+// GET /chart?channel=indoor.temperature&width=<px>&from=<epoch>&to=<epoch>&mode=lttb|minmax
+void chartHandler() {
+    TRACE_SCOPE("http.chart");
+    WebServer* server = webManager ? webManager->getServer() : nullptr;
+    if (!server) return;
+    
+    if (!historyManager.isReady()) {
+        server->send(503, "text/plain", "History storage not available");
+        return;
+    }
+    
+    HistoryChannel channel = historyChannelFromName(server->arg("channel").c_str());
+    if (channel == HISTORY_CHANNEL_COUNT) {
+        server->send(400, "text/plain", "Unknown channel");
+        return;
+    }
+    
+    uint32_t from = server->hasArg("from") ? strtoul(server->arg("from").c_str(), nullptr, 10) : 0;
+    uint32_t to = server->hasArg("to") ? strtoul(server->arg("to").c_str(), nullptr, 10) : UINT32_MAX;
+    size_t width = server->hasArg("width") ? strtoul(server->arg("width").c_str(), nullptr, 10) : CHART_DEFAULT_WIDTH;
+    ChartMode mode = server->arg("mode") == "minmax" ? CHART_MODE_MINMAX : CHART_MODE_LTTB;
+    
+    historyManager.streamChart(server, channel, from, to, width, mode);
+}
+
+// GET /debug/latency[?reset=1]
+void latencyHandler() {
+    diagnosticsManager.handleLatencyRequest(webManager ? webManager->getServer() : nullptr);
+}
+
+// GET /debug/trace[?clear=1] - Chrome trace JSON of the recent event ring
+void traceHandler() {
+    diagnosticsManager.handleTraceRequest(webManager ? webManager->getServer() : nullptr);
+}
+
+// GET /debug/heap[?reset=1]
+void heapHandler() {
+    diagnosticsManager.handleHeapRequest(webManager ? webManager->getServer() : nullptr);
+}
@@ -0,0 +1,158 @@
+#ifndef MEASUREMENT_STORE_H
+#define MEASUREMENT_STORE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <math.h>
+#include "seqlock.h"
+
+// Latest value of every measured quantity, keyed by channel.
+// Producers write a channel as soon as they have a reading; the display,
+// the API, the home page and BLE read the latest value from here. Samples
+// that outlive the latest value, for the ?since= feed, the history and the
+// outdoor stations, are ChannelSamples indexed by the same ids. A new
+// quantity needs a ChannelId within its group, a CHANNELS row and a
+// producer that fills it; /api/status, ?since=, the station list and the
+// home page follow the table. The screen layout, the history record and
+// the BLE indoor characteristic have fixed layouts and list their channels
+// themselves.
+
+enum ChannelId : uint8_t {
+    CH_INDOOR_TEMPERATURE,
+    CH_INDOOR_HUMIDITY,
+    CH_INDOOR_PRESSURE,
+    CH_INDOOR_IAQ,
+    CH_INDOOR_IAQ_ACCURACY,
+    CH_INDOOR_GAS,
+    CH_INDOOR_ALTITUDE,
+    CH_OUTDOOR_TEMPERATURE,
+    CH_OUTDOOR_HUMIDITY,
+    CH_OUTDOOR_PRESSURE,
+    CH_OUTDOOR_BATTERY_VOLTAGE,
+    CH_OUTDOOR_BATTERY_PERCENTAGE,
+    CHANNEL_COUNT
+};
+
+// Channels of a group are consecutive ids, from the group's first up to the next group's
+enum ChannelGroup : uint8_t {
+    CHANNEL_GROUP_INDOOR,
+    CHANNEL_GROUP_OUTDOOR,
+    CHANNEL_GROUP_COUNT
+};
+
+struct ChannelGroupInfo {
+    const char* name;    // API object
+    ChannelId first;
+    ChannelId end;       // One past the last
+};
+
+static const ChannelGroupInfo CHANNEL_GROUPS[CHANNEL_GROUP_COUNT] = {
+    {"indoor",  CH_INDOOR_TEMPERATURE,  CH_OUTDOOR_TEMPERATURE},
+    {"outdoor", CH_OUTDOOR_TEMPERATURE, CHANNEL_COUNT},
+};
+
+#define CHANNEL_HOME 0x01  // Shown in the home page grid
+#define CHANNEL_NOT_DRAWN -1  // displayDecimals of a channel the screen leaves out
+
+struct ChannelInfo {
+    ChannelGroup group;
+    const char* key;     // Field within the group's object
+    const char* label;   // Home page
+    const char* unit;
+    uint8_t precision;   // Decimals the source resolves
+    int8_t displayDecimals;  // Decimals drawn on the TFT, 0 or 1, CHANNEL_NOT_DRAWN if not on it
+    uint8_t flags;
+};
+
+static const ChannelInfo CHANNELS[CHANNEL_COUNT] = {
+    {CHANNEL_GROUP_INDOOR,  "temperature",        "Temperature",      "°C",  2, 1,                CHANNEL_HOME},
+    {CHANNEL_GROUP_INDOOR,  "humidity",           "Humidity",         "%",   2, 0,                CHANNEL_HOME},
+    {CHANNEL_GROUP_INDOOR,  "pressure",           "Pressure",         "hPa", 2, CHANNEL_NOT_DRAWN, CHANNEL_HOME},
+    {CHANNEL_GROUP_INDOOR,  "iaq",                "IAQ",              "",    0, 0,                CHANNEL_HOME},
+    {CHANNEL_GROUP_INDOOR,  "iaq_accuracy",       "IAQ Accuracy",     "",    0, 0,                0},
+    {CHANNEL_GROUP_INDOOR,  "gas",                "Gas",              "",    0, CHANNEL_NOT_DRAWN, 0},
+    {CHANNEL_GROUP_INDOOR,  "altitude",           "Altitude",         "m",   0, CHANNEL_NOT_DRAWN, 0},
+    {CHANNEL_GROUP_OUTDOOR, "temperature",        "Outdoor Temp",     "°C",  2, 1,                CHANNEL_HOME},
+    {CHANNEL_GROUP_OUTDOOR, "humidity",           "Outdoor Humidity", "%",   2, 0,                CHANNEL_HOME},
+    {CHANNEL_GROUP_OUTDOOR, "pressure",           "Outdoor Pressure", "hPa", 1, 0,                0},
+    {CHANNEL_GROUP_OUTDOOR, "battery_voltage",    "Outdoor Battery",  "V",   3, 1,                0},
+    {CHANNEL_GROUP_OUTDOOR, "battery_percentage", "Outdoor Battery",  "%",   0, 0,                0},
+};
+
+// One reading of a group's channels, values indexed by ChannelId; the
+// other groups' slots are left at 0
+struct ChannelSample {
+    float values[CHANNEL_COUNT];
+    bool isValid;
+    uint32_t timestamp;  // millis() when the reading was taken
+    uint32_t sequence;   // Shared indoor/outdoor sample sequence number
+};
+
+struct Measurement {
+    float value;
+    uint32_t timestampMs;  // When the reading was taken
+    uint32_t version;      // Writes so far, 0 until the first
+};
+
+// Each channel has a single writer task and sits behind its own seqlock,
+// so a reader on either core gets a value with its own timestamp even
+// while the writer is halfway through. Reads are 12-byte copies rather
+// than references into the store: a reference would stay valid only as
+// long as the writer on the other core held off. Channels written
+// together, like the outdoor ones from one batch, are separate reads and
+// may come from neighbouring writes. The store version moves on every write, letting a
+// consumer skip work when nothing changed since it last looked.
+class MeasurementStore {
+private:
+    SeqLock<Measurement> channels[CHANNEL_COUNT];
+    std::atomic<uint32_t> version;
+
+public:
+    MeasurementStore() : channels(), version(0) {}
+
+    void write(ChannelId id, float value, uint32_t timestampMs) {
+        Measurement next;
+        next.value = value;
+        next.timestampMs = timestampMs;
+        next.version = channels[id].getWrites() + 1;  // Only this task writes the channel
+        channels[id].write(next);
+        version.fetch_add(1, std::memory_order_release);
+    }
+
+    // Every channel of the sample's group; one writer per group
+    void writeSample(ChannelGroup group, const ChannelSample& sample) {
+        for (uint8_t id = CHANNEL_GROUPS[group].first; id < CHANNEL_GROUPS[group].end; id++) {
+            write((ChannelId)id, sample.values[id], sample.timestamp);
+        }
+    }
+
+    // A copy, consistent with itself
+    Measurement get(ChannelId id) const {
+        Measurement measurement;
+        channels[id].read(measurement);
+        return measurement;
+    }
+    float value(ChannelId id) const { return get(id).value; }
+    bool has(ChannelId id) const { return channels[id].getWrites() > 0; }
+    uint32_t getVersion() const { return version.load(std::memory_order_acquire); }
+};
+
+// "21.35 °C" into out, "--" before the first reading; returns the length
+inline int formatChannel(char* out, size_t size, const MeasurementStore& store, ChannelId id) {
+    const ChannelInfo& info = CHANNELS[id];
+    if (!store.has(id)) return snprintf(out, size, "--");
+    if (!info.unit[0]) return snprintf(out, size, "%.*f", (int)info.precision, (double)store.value(id));
+    return snprintf(out, size, "%.*f %s", (int)info.precision, (double)store.value(id), info.unit);
+}
+
+// "indoor.temperature" into out, the channel's /api/status field name
+inline void formatChannelPath(char* out, size_t size, ChannelId id) {
+    snprintf(out, size, "%s.%s", CHANNEL_GROUPS[CHANNELS[id].group].name, CHANNELS[id].key);
+}
+
+inline MeasurementStore& measurements() {
+    static MeasurementStore store;
+    return store;
+}
+
+#endif // MEASUREMENT_STORE_H
@@ -0,0 +1,332 @@
+#ifndef OUTDOOR_PROTOCOL_H
+#define OUTDOOR_PROTOCOL_H
+
+#include <Arduino.h>
+#include "config.h"
+#include "histogram.h"
+
+// Payloads written by outdoor stations to the BLE characteristic.
+//
+// Version 1 (legacy): five little-endian floats, 20 bytes, no header:
+//   temperature, humidity, pressure, battery voltage, battery percentage
+//
+// Version 2: a batch of samples, all fields little-endian:
+//   u8 version (2) | u8 count | u32 sequence of the first sample
+//   count x { u16 age s | i16 temp 0.01 C | u16 humidity 0.01 % |
+//             u16 pressure 0.1 hPa | u16 battery mV | u8 battery % }
+//   u16 CRC-16/CCITT-FALSE over everything before it
+// Samples are oldest first with consecutive sequence numbers starting at
+// 1, so a station can resend what it buffered while the link was down.
+// The age is how long before the write each sample was taken.
+//
+// With the negotiated MTU a whole frame goes in one write (or one long
+// write). A peer stuck at the default 23-byte MTU can instead split it
+// into fixed-size fragments, see below.
+
+#define OUTDOOR_PROTOCOL_VERSION 2
+#define OUTDOOR_LEGACY_FRAME_SIZE (sizeof(float) * OUTDOOR_VALUES_COUNT)
+#define OUTDOOR_HEADER_SIZE 6
+#define OUTDOOR_SAMPLE_SIZE 11
+#define OUTDOOR_CRC_SIZE 2
+
+constexpr size_t outdoorFrameSize(uint8_t count) {
+    return OUTDOOR_HEADER_SIZE + (size_t)count * OUTDOOR_SAMPLE_SIZE + OUTDOOR_CRC_SIZE;
+}
+
+#define OUTDOOR_FRAME_MAX_SIZE outdoorFrameSize(OUTDOOR_BATCH_MAX)
+
+struct OutdoorSample {
+    uint16_t ageSeconds;
+    float temperature;
+    float humidity;
+    float pressure;
+    float batteryVoltage;
+    float batteryPercentage;
+};
+
+struct OutdoorBatch {
+    uint8_t version;         // 1 for legacy frames
+    uint8_t count;
+    uint32_t firstSequence;  // Station's own counter, 0 for legacy frames
+    OutdoorSample samples[OUTDOOR_BATCH_MAX];
+};
+
+enum OutdoorFrameStatus {
+    OUTDOOR_FRAME_OK,
+    OUTDOOR_FRAME_BAD_LENGTH,
+    OUTDOOR_FRAME_BAD_VERSION,
+    OUTDOOR_FRAME_BAD_CRC
+};
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), a nibble at a time
+inline uint16_t outdoorCrc16(const uint8_t* data, size_t length) {
+    static const uint16_t table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc = (uint16_t)(crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (uint16_t)(crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+inline void putU16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+}
+
+inline void putU32(uint8_t* out, uint32_t value) {
+    putU16(out, (uint16_t)value);
+    putU16(out + 2, (uint16_t)(value >> 16));
+}
+
+inline uint16_t getU16(const uint8_t* in) { return (uint16_t)(in[0] | (in[1] << 8)); }
+inline uint32_t getU32(const uint8_t* in) { return getU16(in) | ((uint32_t)getU16(in + 2) << 16); }
+
+// Rounds and clamps a value to the range of its scaled field
+inline int32_t scaleOutdoorValue(float value, float scale, int32_t minimum, int32_t maximum) {
+    float scaled = value * scale;
+    int32_t rounded = (int32_t)(scaled < 0 ? scaled - 0.5f : scaled + 0.5f);
+    return rounded < minimum ? minimum : (rounded > maximum ? maximum : rounded);
+}
+
+// Writes a version 2 frame; returns its size, 0 when it does not fit
+inline size_t encodeOutdoorBatch(uint8_t* out, size_t size, uint32_t firstSequence,
+                                 const OutdoorSample* samples, uint8_t count) {
+    size_t frameSize = outdoorFrameSize(count);
+    if (count == 0 || count > OUTDOOR_BATCH_MAX || frameSize > size) return 0;
+
+    out[0] = OUTDOOR_PROTOCOL_VERSION;
+    out[1] = count;
+    putU32(out + 2, firstSequence);
+    uint8_t* p = out + OUTDOOR_HEADER_SIZE;
+    for (uint8_t i = 0; i < count; i++, p += OUTDOOR_SAMPLE_SIZE) {
+        const OutdoorSample& sample = samples[i];
+        putU16(p, sample.ageSeconds);
+        putU16(p + 2, (uint16_t)(int16_t)scaleOutdoorValue(sample.temperature, 100.0f, INT16_MIN, INT16_MAX));
+        putU16(p + 4, (uint16_t)scaleOutdoorValue(sample.humidity, 100.0f, 0, UINT16_MAX));
+        putU16(p + 6, (uint16_t)scaleOutdoorValue(sample.pressure, 10.0f, 0, UINT16_MAX));
+        putU16(p + 8, (uint16_t)scaleOutdoorValue(sample.batteryVoltage, 1000.0f, 0, UINT16_MAX));
+        p[10] = (uint8_t)scaleOutdoorValue(sample.batteryPercentage, 1.0f, 0, 100);
+    }
+    putU16(p, outdoorCrc16(out, p - out));
+    return frameSize;
+}
+
+// Accepts both the legacy and the version 2 layout
+inline OutdoorFrameStatus decodeOutdoorFrame(const uint8_t* data, size_t length, OutdoorBatch& batch) {
+    if (length == OUTDOOR_LEGACY_FRAME_SIZE) {
+        float values[OUTDOOR_VALUES_COUNT];
+        memcpy(values, data, sizeof(values));
+        batch.version = 1;
+        batch.count = 1;
+        batch.firstSequence = 0;
+        OutdoorSample& sample = batch.samples[0];
+        sample.ageSeconds = 0;
+        sample.temperature = values[0];
+        sample.humidity = values[1];
+        sample.pressure = values[2];
+        sample.batteryVoltage = values[3];
+        sample.batteryPercentage = values[4];
+        return OUTDOOR_FRAME_OK;
+    }
+
+    if (length < outdoorFrameSize(1)) return OUTDOOR_FRAME_BAD_LENGTH;
+    if (data[0] != OUTDOOR_PROTOCOL_VERSION) return OUTDOOR_FRAME_BAD_VERSION;
+    uint8_t count = data[1];
+    if (count == 0 || count > OUTDOOR_BATCH_MAX || length != outdoorFrameSize(count)) {
+        return OUTDOOR_FRAME_BAD_LENGTH;
+    }
+    if (outdoorCrc16(data, length - OUTDOOR_CRC_SIZE) != getU16(data + length - OUTDOOR_CRC_SIZE)) {
+        return OUTDOOR_FRAME_BAD_CRC;
+    }
+
+    batch.version = data[0];
+    batch.count = count;
+    batch.firstSequence = getU32(data + 2);
+    const uint8_t* p = data + OUTDOOR_HEADER_SIZE;
+    for (uint8_t i = 0; i < count; i++, p += OUTDOOR_SAMPLE_SIZE) {
+        OutdoorSample& sample = batch.samples[i];
+        sample.ageSeconds = getU16(p);
+        sample.temperature = (int16_t)getU16(p + 2) / 100.0f;
+        sample.humidity = getU16(p + 4) / 100.0f;
+        sample.pressure = getU16(p + 6) / 10.0f;
+        sample.batteryVoltage = getU16(p + 8) / 1000.0f;
+        sample.batteryPercentage = p[10];
+    }
+    return OUTDOOR_FRAME_OK;
+}
+
+inline const char* outdoorFrameStatusName(OutdoorFrameStatus status) {
+    switch (status) {
+        case OUTDOOR_FRAME_OK: return "ok";
+        case OUTDOOR_FRAME_BAD_LENGTH: return "bad length";
+        case OUTDOOR_FRAME_BAD_VERSION: return "bad version";
+        case OUTDOOR_FRAME_BAD_CRC: return "bad CRC";
+    }
+    return "unknown";
+}
+
+#define OUTDOOR_SEQUENCE_FIRST 1  // A station's counter after boot
+
+enum OutdoorSequenceClass {
+    OUTDOOR_SEQUENCE_NEW,        // Next in order, possibly after lost ones
+    OUTDOOR_SEQUENCE_DUPLICATE,  // Already received, e.g. a resent batch
+    OUTDOOR_SEQUENCE_RESTART     // The station rebooted and counts from the start again
+};
+
+// Places a station's sample sequence `remote` against the last one accepted
+// (0 before any). Counters wrap through the signed difference. A counter back
+// at its first value means a reboot, however close the old count was; so
+// does one more than restartWindow behind. `lost` is set to the sequence
+// numbers skipped before a new sample.
+inline OutdoorSequenceClass classifyOutdoorSequence(uint32_t last, uint32_t remote,
+                                                    uint32_t restartWindow, uint32_t& lost) {
+    lost = 0;
+    if (last == 0) return OUTDOOR_SEQUENCE_NEW;
+    if (remote == OUTDOOR_SEQUENCE_FIRST && last != OUTDOOR_SEQUENCE_FIRST) return OUTDOOR_SEQUENCE_RESTART;
+    int32_t delta = (int32_t)(remote - last);
+    if (delta > 0) {
+        lost = (uint32_t)delta - 1;
+        return OUTDOOR_SEQUENCE_NEW;
+    }
+    return (uint32_t)0 - (uint32_t)delta > restartWindow ? OUTDOOR_SEQUENCE_RESTART : OUTDOOR_SEQUENCE_DUPLICATE;
+}
+
+// Fragments of a frame, each OUTDOOR_FRAGMENT_SIZE bytes so it fits the
+// 20-byte payload of a default ATT write:
+//   u8 marker (0xF2) | u8 index, bit 7 set on the last | 17 frame bytes
+// The last fragment is zero padded; the frame header gives the real length.
+// A fragment is as long as a one-sample frame and is told apart by its
+// first byte.
+#define OUTDOOR_FRAGMENT_MARKER 0xF2
+#define OUTDOOR_FRAGMENT_LAST 0x80
+#define OUTDOOR_FRAGMENT_SIZE 19
+#define OUTDOOR_FRAGMENT_HEADER_SIZE 2
+#define OUTDOOR_FRAGMENT_PAYLOAD (OUTDOOR_FRAGMENT_SIZE - OUTDOOR_FRAGMENT_HEADER_SIZE)
+#define OUTDOOR_FRAGMENT_MAX_COUNT ((OUTDOOR_FRAME_MAX_SIZE + OUTDOOR_FRAGMENT_PAYLOAD - 1) / OUTDOOR_FRAGMENT_PAYLOAD)
+
+inline bool isOutdoorFragment(const uint8_t* data, size_t length) {
+    return length == OUTDOOR_FRAGMENT_SIZE && data[0] == OUTDOOR_FRAGMENT_MARKER;
+}
+
+// Splits a frame into consecutive fragments in out; returns how many, 0 when they do not fit
+inline uint8_t fragmentOutdoorFrame(uint8_t* out, size_t size, const uint8_t* frame, size_t length) {
+    size_t count = (length + OUTDOOR_FRAGMENT_PAYLOAD - 1) / OUTDOOR_FRAGMENT_PAYLOAD;
+    if (count == 0 || count > OUTDOOR_FRAGMENT_LAST || count * OUTDOOR_FRAGMENT_SIZE > size) return 0;
+
+    for (size_t i = 0; i < count; i++) {
+        uint8_t* fragment = out + i * OUTDOOR_FRAGMENT_SIZE;
+        size_t offset = i * OUTDOOR_FRAGMENT_PAYLOAD;
+        size_t chunk = length - offset < OUTDOOR_FRAGMENT_PAYLOAD ? length - offset : OUTDOOR_FRAGMENT_PAYLOAD;
+        fragment[0] = OUTDOOR_FRAGMENT_MARKER;
+        fragment[1] = (uint8_t)i | (i + 1 == count ? OUTDOOR_FRAGMENT_LAST : 0);
+        memcpy(fragment + OUTDOOR_FRAGMENT_HEADER_SIZE, frame + offset, chunk);
+        memset(fragment + OUTDOOR_FRAGMENT_HEADER_SIZE + chunk, 0, OUTDOOR_FRAGMENT_PAYLOAD - chunk);
+    }
+    return (uint8_t)count;
+}
+
+enum OutdoorReassemblyStatus {
+    OUTDOOR_REASSEMBLY_PENDING,
+    OUTDOOR_REASSEMBLY_COMPLETE,
+    OUTDOOR_REASSEMBLY_OUT_OF_ORDER,
+    OUTDOOR_REASSEMBLY_OVERFLOW
+};
+
+// Collects the fragments written by one peer. Writes on a connection
+// arrive in order, so a gap means a fragment was lost and the partial
+// frame is dropped. A first fragment always starts over, e.g. after the
+// peer reconnected halfway through a frame.
+class OutdoorReassembler {
+private:
+    uint8_t buffer[OUTDOOR_FRAGMENT_MAX_COUNT * OUTDOOR_FRAGMENT_PAYLOAD];
+    size_t length;
+    uint8_t nextIndex;
+    uint32_t startedMs;
+    uint32_t elapsedMs;
+
+public:
+    OutdoorReassembler() : length(0), nextIndex(0), startedMs(0), elapsedMs(0) {}
+
+    OutdoorReassemblyStatus add(const uint8_t* fragment, uint32_t nowMs) {
+        uint8_t index = fragment[1] & ~OUTDOOR_FRAGMENT_LAST;
+        if (index == 0) {
+            length = 0;
+            nextIndex = 0;
+            startedMs = nowMs;
+        }
+        if (index != nextIndex) {
+            reset();
+            return OUTDOOR_REASSEMBLY_OUT_OF_ORDER;
+        }
+        if (length + OUTDOOR_FRAGMENT_PAYLOAD > sizeof(buffer)) {
+            reset();
+            return OUTDOOR_REASSEMBLY_OVERFLOW;
+        }
+        memcpy(buffer + length, fragment + OUTDOOR_FRAGMENT_HEADER_SIZE, OUTDOOR_FRAGMENT_PAYLOAD);
+        length += OUTDOOR_FRAGMENT_PAYLOAD;
+        nextIndex++;
+        if (!(fragment[1] & OUTDOOR_FRAGMENT_LAST)) return OUTDOOR_REASSEMBLY_PENDING;
+
+        nextIndex = 0;
+        elapsedMs = nowMs - startedMs;
+        // Drop the padding; anything else is left for the decoder to reject
+        if (buffer[0] == OUTDOOR_PROTOCOL_VERSION && outdoorFrameSize(buffer[1]) <= length) {
+            length = outdoorFrameSize(buffer[1]);
+        }
+        return OUTDOOR_REASSEMBLY_COMPLETE;
+    }
+
+    void reset() {
+        length = 0;
+        nextIndex = 0;
+    }
+
+    // The frame, valid after add() returned OUTDOOR_REASSEMBLY_COMPLETE
+    const uint8_t* data() const { return buffer; }
+    size_t size() const { return length; }
+    // From the first to the last fragment of the completed frame
+    uint32_t getElapsedMs() const { return elapsedMs; }
+    bool isPending() const { return nextIndex > 0; }
+};
+
+inline const char* outdoorReassemblyStatusName(OutdoorReassemblyStatus status) {
+    switch (status) {
+        case OUTDOOR_REASSEMBLY_PENDING: return "pending";
+        case OUTDOOR_REASSEMBLY_COMPLETE: return "complete";
+        case OUTDOOR_REASSEMBLY_OUT_OF_ORDER: return "out of order";
+        case OUTDOOR_REASSEMBLY_OVERFLOW: return "overflow";
+    }
+    return "unknown";
+}
+
+// Receive-side transfer figures. A batch's latency runs from its first
+// write to the one completing it, so it is 0 for a batch that fit one
+// write; throughput is taken over the batches that needed several.
+struct OutdoorTransferMeter {
+    uint32_t bytes;        // Every write, headers and padding included
+    uint32_t writes;
+    uint32_t batches;      // Complete frames
+    uint32_t fragments;
+    uint32_t lastBytesPerSecond;
+    LogHistogram<16> batchLatencyMs;
+
+    OutdoorTransferMeter() : bytes(0), writes(0), batches(0), fragments(0), lastBytesPerSecond(0) {}
+
+    void recordWrite(size_t length, bool fragment) {
+        bytes += length;
+        writes++;
+        if (fragment) fragments++;
+    }
+
+    void recordBatch(size_t frameLength, uint32_t elapsedMs) {
+        batches++;
+        batchLatencyMs.record(elapsedMs);
+        if (elapsedMs > 0) lastBytesPerSecond = (uint32_t)(frameLength * 1000 / elapsedMs);
+    }
+};
+
+#endif // OUTDOOR_PROTOCOL_H
@@ -0,0 +1,133 @@
+#ifndef RECONNECT_STATE_MACHINE_H
+#define RECONNECT_STATE_MACHINE_H
+
+#include <Arduino.h>
+
+enum LinkState : uint8_t {
+    LINK_CONNECTED = 0,
+    LINK_BACKOFF,      // Down, waiting before the next attempt
+    LINK_CONNECTING    // Attempt in progress
+};
+
+enum LinkAction : uint8_t {
+    LINK_ACTION_NONE = 0,
+    LINK_ACTION_LOST,           // Link just dropped
+    LINK_ACTION_BEGIN_CONNECT,  // Caller should start a (non-blocking) connect
+    LINK_ACTION_ATTEMPT_FAILED, // Attempt timed out, backing off
+    LINK_ACTION_RESTORED        // Link is back up
+};
+
+struct LinkStats {
+    uint32_t drops;            // Times the link went down
+    uint32_t attempts;         // Reconnect attempts started
+    uint32_t failedAttempts;   // Attempts that timed out
+    uint32_t totalDowntimeMs;  // Completed outages
+    uint32_t lastBackoffMs;
+};
+
+// Non-blocking reconnect controller with jittered exponential backoff.
+// step() is called from the loop with the current time and link status and
+// only returns what to do next; it never waits, so each call costs
+// microseconds. Time and link status are inputs, so it can be driven by a
+// simulated clock in tests.
+class ReconnectStateMachine {
+private:
+    LinkState state;
+    LinkStats stats;
+    uint32_t downSince;
+    uint32_t attemptStarted;
+    uint32_t nextAttemptAt;
+    uint8_t consecutiveFailures;
+    uint32_t rng;
+
+    uint32_t connectTimeoutMs;
+    uint32_t backoffBaseMs;
+    uint32_t backoffMaxMs;
+
+    uint32_t nextRandom() {
+        // xorshift32, enough for spreading retries across a fleet
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return rng;
+    }
+
+public:
+    ReconnectStateMachine(uint32_t timeoutMs, uint32_t baseMs, uint32_t maxMs)
+        : state(LINK_CONNECTED), downSince(0), attemptStarted(0), nextAttemptAt(0),
+          consecutiveFailures(0), rng(0x9E3779B9u),
+          connectTimeoutMs(timeoutMs), backoffBaseMs(baseMs), backoffMaxMs(maxMs) {
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    void seed(uint32_t value) { rng = value ? value : 0x9E3779B9u; }
+
+    // Backoff before attempt n+1 after n consecutive failures: the exponential
+    // delay is capped, then "equal jitter" keeps it in [delay/2, delay)
+    uint32_t backoffFor(uint8_t failures) {
+        uint32_t delay = backoffBaseMs;
+        for (uint8_t i = 1; i < failures && delay < backoffMaxMs; i++) {
+            delay *= 2;
+        }
+        if (delay > backoffMaxMs) delay = backoffMaxMs;
+        uint32_t half = delay / 2;
+        return half + (half > 0 ? nextRandom() % half : 0);
+    }
+
+    LinkAction step(uint32_t nowMs, bool linkUp) {
+        switch (state) {
+            case LINK_CONNECTED:
+                if (linkUp) return LINK_ACTION_NONE;
+                state = LINK_BACKOFF;
+                stats.drops++;
+                downSince = nowMs;
+                nextAttemptAt = nowMs;  // First retry immediately
+                consecutiveFailures = 0;
+                return LINK_ACTION_LOST;
+
+            case LINK_BACKOFF:
+                if (linkUp) return restore(nowMs);
+                if ((int32_t)(nowMs - nextAttemptAt) < 0) return LINK_ACTION_NONE;
+                state = LINK_CONNECTING;
+                attemptStarted = nowMs;
+                stats.attempts++;
+                return LINK_ACTION_BEGIN_CONNECT;
+
+            case LINK_CONNECTING:
+                if (linkUp) return restore(nowMs);
+                if (nowMs - attemptStarted < connectTimeoutMs) return LINK_ACTION_NONE;
+                stats.failedAttempts++;
+                if (consecutiveFailures < 255) consecutiveFailures++;
+                stats.lastBackoffMs = backoffFor(consecutiveFailures);
+                nextAttemptAt = nowMs + stats.lastBackoffMs;
+                state = LINK_BACKOFF;
+                return LINK_ACTION_ATTEMPT_FAILED;
+        }
+        return LINK_ACTION_NONE;
+    }
+
+    // Skip the remaining backoff, e.g. after new credentials were entered
+    void retryNow(uint32_t nowMs) {
+        consecutiveFailures = 0;
+        if (state == LINK_BACKOFF) nextAttemptAt = nowMs;
+    }
+
+    LinkState getState() const { return state; }
+    const LinkStats& getStats() const { return stats; }
+    uint8_t getConsecutiveFailures() const { return consecutiveFailures; }
+
+    // Downtime including an outage still in progress
+    uint32_t getDowntimeMs(uint32_t nowMs) const {
+        return stats.totalDowntimeMs + (state == LINK_CONNECTED ? 0 : nowMs - downSince);
+    }
+
+private:
+    LinkAction restore(uint32_t nowMs) {
+        stats.totalDowntimeMs += nowMs - downSince;
+        state = LINK_CONNECTED;
+        consecutiveFailures = 0;
+        return LINK_ACTION_RESTORED;
+    }
+};
+
+#endif // RECONNECT_STATE_MACHINE_H
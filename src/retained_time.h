@@ -0,0 +1,49 @@
+#ifndef RETAINED_TIME_H
+#define RETAINED_TIME_H
+
+#include <Arduino.h>
+#include <stddef.h>
+
+#define RETAINED_TIME_MAGIC 0x54494D31  // "TIM1"
+#define RETAINED_TIME_MIN_EPOCH 1600000000UL  // Anything earlier was never synced
+
+// Last known UTC time and timezone, kept in RTC memory that survives a
+// soft reset (but not a power cycle). The checksum rejects the random
+// contents RTC memory has after power-on.
+struct RetainedTime {
+    uint32_t magic;
+    uint32_t epoch;      // UTC seconds, refreshed every second while the clock is valid
+    char location[40];   // Timezone name the POSIX rule belongs to
+    char posix[48];      // Resolved POSIX TZ rule, avoids a lookup after reset
+    uint32_t checksum;
+};
+
+// FNV-1a over everything before the checksum
+inline uint32_t retainedTimeChecksum(const RetainedTime& retained) {
+    const uint8_t* bytes = (const uint8_t*)&retained;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(RetainedTime, checksum); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+inline void sealRetainedTime(RetainedTime& retained) {
+    retained.magic = RETAINED_TIME_MAGIC;
+    retained.checksum = retainedTimeChecksum(retained);
+}
+
+inline bool isRetainedTimeValid(const RetainedTime& retained) {
+    return retained.magic == RETAINED_TIME_MAGIC &&
+           retained.checksum == retainedTimeChecksum(retained) &&
+           retained.epoch >= RETAINED_TIME_MIN_EPOCH &&
+           memchr(retained.location, '\0', sizeof(retained.location)) != nullptr &&
+           memchr(retained.posix, '\0', sizeof(retained.posix)) != nullptr;
+}
+
+// Time after a reset: the retained second plus the time spent booting
+inline uint32_t estimateEpochAfterReset(const RetainedTime& retained, uint32_t millisSinceBoot) {
+    return retained.epoch + millisSinceBoot / 1000;
+}
+
+#endif // RETAINED_TIME_H
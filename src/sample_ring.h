@@ -0,0 +1,78 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Shared sequence counter for indoor and outdoor samples.
+// Every accepted sample gets the next number, so pollers can detect gaps
+// and ask only for what they have not seen yet.
+inline uint32_t nextSampleSequence() {
+    static std::atomic<uint32_t> sequence(0);
+    return ++sequence;
+}
+
+// Bounded in-memory ring of the most recent samples.
+// T must expose a uint32_t `sequence` member.
+template <typename T, size_t Capacity>
+class SampleRing {
+private:
+    T samples[Capacity];
+    size_t head;   // Next slot to write
+    size_t count;
+    uint32_t evictedSequence;  // Newest sequence dropped from the ring
+
+public:
+    SampleRing() : head(0), count(0), evictedSequence(0) {}
+
+    void push(const T& sample) {
+        if (count == Capacity) evictedSequence = samples[head].sequence;
+        samples[head] = sample;
+        head = (head + 1) % Capacity;
+        if (count < Capacity) count++;
+    }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return Capacity; }
+    bool isEmpty() const { return count == 0; }
+
+    // Sequence of the oldest sample still held, 0 when empty
+    uint32_t oldestSequence() const {
+        if (count == 0) return 0;
+        return samples[(head + Capacity - count) % Capacity].sequence;
+    }
+
+    // Sequence of the newest sample, 0 when empty
+    uint32_t latestSequence() const {
+        if (count == 0) return 0;
+        return samples[(head + Capacity - 1) % Capacity].sequence;
+    }
+
+    // True when samples newer than `since` have already been evicted
+    bool hasGapAfter(uint32_t since) const {
+        return evictedSequence > since;
+    }
+
+    // Visit samples with sequence > since, oldest first
+    template <typename Fn>
+    size_t forEachSince(uint32_t since, Fn fn) const {
+        size_t visited = 0;
+        size_t start = (head + Capacity - count) % Capacity;
+        for (size_t i = 0; i < count; i++) {
+            const T& sample = samples[(start + i) % Capacity];
+            if (sample.sequence > since) {
+                fn(sample);
+                visited++;
+            }
+        }
+        return visited;
+    }
+
+    void clear() {
+        head = 0;
+        count = 0;
+        evictedSequence = 0;
+    }
+};
+
+#endif // SAMPLE_RING_H
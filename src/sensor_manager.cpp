@@ -1,12 +1,19 @@
 #include "sensor_manager.h"
+#include "sample_ring.h"
+#include "trace.h"
+#include "logger.h"
+#include "measurement_store.h"
+#include "event_bus.h"
 
 SensorManager::SensorManager() 
-    : gySerial(1), gyCounter(0), gySign(0) {
+    : gySerial(1), gyCounter(0), gySign(0), receivedUs(0), lastPollUs(0), lastRxUs(0) {
     resetData();
 }
 
 void SensorManager::begin() {
     gySerial.begin(GY_BAUD_RATE, SERIAL_8N1, GY_RXD_PIN, GY_TXD_PIN);
+    // Fires once the line has been idle for a few symbols, i.e. at the end of a frame
+    gySerial.onReceive([this]() { lastRxUs.store(micros(), std::memory_order_relaxed); }, true);
     delay(4000);
     initializeSensor();
 }
@@ -29,11 +36,17 @@ void SensorManager::initializeSensor() {
 }
 
 void SensorManager::update() {
+    // A frame completed in this poll arrived after the previous one started.
+    // Its receive time is when the UART reported the line idle; if that
+    // report is missing or older, the previous poll's start is the bound.
+    uint32_t previousPollUs = lastPollUs;
+    lastPollUs = micros();
+    
     while (gySerial.available()) {
         gyRe_buf[gyCounter] = (unsigned char)gySerial.read();
 
         if (gyCounter == 0 && gyRe_buf[0] != 0x5A) {
-            Serial.println("Invalid sensor data header");
+            LOGGER_WARN("Invalid sensor data header");
             return;
         }
         if (gyCounter == 1 && gyRe_buf[1] != 0x5A) {
@@ -52,6 +65,9 @@ void SensorManager::update() {
         gySign = 0;
         if (gyRe_buf[0] == 0x5A && gyRe_buf[1] == 0x5A) {
             if (validateChecksum()) {
+                TRACE_INSTANT("uart.frame");
+                uint32_t rxUs = lastRxUs.load(std::memory_order_relaxed);
+                receivedUs = (int32_t)(rxUs - previousPollUs) >= 0 ? rxUs : previousPollUs;
                 parseSensorValues();
             }
         }
@@ -69,56 +85,56 @@ bool SensorManager::validateChecksum() {
 void SensorManager::parseSensorValues() {
     // Parse temperature
     gyTemp2 = (gyRe_buf[4] << 8) | gyRe_buf[5];
-    currentData.temperature = (float)gyTemp2 / 100;
+    currentData.values[CH_INDOOR_TEMPERATURE] = (float)gyTemp2 / 100;
     
     // Parse humidity
     gyTemp1 = (gyRe_buf[6] << 8) | gyRe_buf[7];
-    currentData.humidity = (float)gyTemp1 / 100;
+    currentData.values[CH_INDOOR_HUMIDITY] = (float)gyTemp1 / 100;
     
     // Parse pressure (24-bit value in Pa, convert to hPa)
     uint32_t pressurePa = ((uint32_t)gyRe_buf[8] << 16) | 
                           ((uint16_t)gyRe_buf[9] << 8) | 
                           gyRe_buf[10];
-    currentData.pressure = (float)pressurePa / 100.0;  // Convert Pa to hPa
-    currentData.altitudePressure = currentData.pressure + (ALT_CORRECTION / 100.0);
+    currentData.values[CH_INDOOR_PRESSURE] = (float)pressurePa / 100.0;  // Convert Pa to hPa
     
     // Parse IAQ
-    currentData.iaqAccuracy = (gyRe_buf[11] & 0xf0) >> 4;
-    currentData.iaq = ((gyRe_buf[11] & 0x0F) << 8) | gyRe_buf[12];
+    currentData.values[CH_INDOOR_IAQ_ACCURACY] = (gyRe_buf[11] & 0xf0) >> 4;
+    currentData.values[CH_INDOOR_IAQ] = ((gyRe_buf[11] & 0x0F) << 8) | gyRe_buf[12];
     
     // Parse gas
-    currentData.gas = ((uint32_t)gyRe_buf[13] << 24) | 
-                     ((uint32_t)gyRe_buf[14] << 16) | 
-                     ((uint16_t)gyRe_buf[15] << 8) | 
-                     gyRe_buf[16];
+    currentData.values[CH_INDOOR_GAS] = ((uint32_t)gyRe_buf[13] << 24) | 
+                                        ((uint32_t)gyRe_buf[14] << 16) | 
+                                        ((uint16_t)gyRe_buf[15] << 8) | 
+                                        gyRe_buf[16];
     
     // Parse altitude
-    currentData.altitude = (gyRe_buf[17] << 8) | gyRe_buf[18];
+    currentData.values[CH_INDOOR_ALTITUDE] = (gyRe_buf[17] << 8) | gyRe_buf[18];
     
     // Validate data
-    currentData.isValid = isTemperatureValid(currentData.temperature) &&
-                         isHumidityValid(currentData.humidity) &&
-                         isPressureValid(currentData.pressure) &&
-                         isIAQValid(currentData.iaq);
+    currentData.isValid = isTemperatureValid(currentData.values[CH_INDOOR_TEMPERATURE]) &&
+                         isHumidityValid(currentData.values[CH_INDOOR_HUMIDITY]) &&
+                         isPressureValid(currentData.values[CH_INDOOR_PRESSURE]) &&
+                         isIAQValid(currentData.values[CH_INDOOR_IAQ]);
     
     currentData.timestamp = millis();
     
     if (currentData.isValid) {
-        Serial.printf("Sensor data updated - Temp: %.1f°C, Humidity: %.1f%%, Pressure: %.1f hPa, IAQ: %d\n", 
-                     currentData.temperature, currentData.humidity, currentData.pressure, currentData.iaq);
+        currentData.sequence = nextSampleSequence();
+        measurements().writeSample(CHANNEL_GROUP_INDOOR, currentData);
+        eventBus().publish(makeEvent(EVENT_INDOOR_SAMPLE, 0, currentData.sequence, currentData.timestamp));
+        LOGGER_DEBUG("Sensor data updated - Temp: %.1f°C, Humidity: %.1f%%, Pressure: %.1f hPa, IAQ: %d",
+                     currentData.values[CH_INDOOR_TEMPERATURE], currentData.values[CH_INDOOR_HUMIDITY],
+                     currentData.values[CH_INDOOR_PRESSURE], (int)currentData.values[CH_INDOOR_IAQ]);
     } else {
-        Serial.println("Invalid sensor data detected");
+        LOGGER_WARN("Invalid sensor data detected");
     }
 }
 
-bool SensorManager::hasNewData() const {
-    return currentData.isValid && currentData.timestamp > 0;
-}
-
 void SensorManager::resetData() {
-    currentData = {0};
+    currentData = ChannelSample();
     currentData.isValid = false;
     currentData.timestamp = 0;
+    currentData.sequence = 0;
 }
 
 bool SensorManager::isTemperatureValid(float temp) const {
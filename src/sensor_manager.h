@@ -3,20 +3,9 @@
 
 #include <Arduino.h>
 #include <HardwareSerial.h>
+#include <atomic>
 #include "config.h"
-
-struct SensorData {
-    float temperature;
-    float humidity;
-    float pressure;  // Changed from int to float for better precision
-    float altitudePressure;
-    int iaq;
-    int iaqAccuracy;
-    int gas;
-    int altitude;
-    bool isValid;
-    unsigned long timestamp;
-};
+#include "measurement_store.h"
 
 class SensorManager {
 private:
@@ -26,7 +15,10 @@ private:
     unsigned char gyRe_buf[30];
     unsigned char gyCounter;
     unsigned char gySign;
-    SensorData currentData;
+    ChannelSample currentData;  // Indoor channels of the newest frame
+    uint32_t receivedUs;  // micros() when that frame was received, see update()
+    uint32_t lastPollUs;
+    std::atomic<uint32_t> lastRxUs;  // Set from the UART event task when the line goes idle
     
     void processSensorData();
     bool validateChecksum();
@@ -38,8 +30,10 @@ public:
     
     void begin();
     void update();
-    SensorData getData() const { return currentData; }
-    bool hasNewData() const;
+    const ChannelSample& getData() const { return currentData; }
+    uint32_t getReceivedUs() const { return receivedUs; }
+    // A valid reading newer than the given sample sequence
+    bool hasNewData(uint32_t seenSequence) const { return currentData.isValid && currentData.sequence > seenSequence; }
     void resetData();
     
     // Data validation
@@ -0,0 +1,55 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+// A value with one writer task and readers on any task or core. The writer
+// never waits: it makes the sequence odd, copies the value in and makes it
+// even again. A reader copies the value out and retries if the sequence was
+// odd or moved meanwhile, so it always gets one whole write. T must be
+// trivially copyable. A reader that keeps losing the race sleeps a tick
+// between tries, in case it preempted the writer on the writer's own core.
+template <typename T>
+class SeqLock {
+private:
+    std::atomic<uint32_t> sequence;
+    T value;
+
+public:
+    SeqLock() : sequence(0), value() {}
+
+    // Only ever from the one writer task
+    void write(const T& next) {
+        update([&next](T& value) { memcpy(&value, &next, sizeof(T)); });
+    }
+
+    // Only ever from the one writer task: fill(value) changes the value in
+    // place, so a large value needs no copy built beforehand
+    template <typename Fill>
+    void update(Fill fill) {
+        uint32_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fill(value);
+        sequence.store(start + 2, std::memory_order_release);
+    }
+
+    void read(T& out) const {
+        for (uint8_t attempt = 1;; attempt++) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if (!(before & 1)) {
+                memcpy(&out, &value, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) return;
+            }
+            if (attempt % 8 == 0) delay(1);
+        }
+    }
+
+    // Writes published so far
+    uint32_t getWrites() const { return sequence.load(std::memory_order_acquire) / 2; }
+};
+
+#endif // SEQLOCK_H
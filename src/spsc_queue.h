@@ -0,0 +1,49 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Bounded queue between exactly one producer task and one consumer task.
+// Neither side blocks or locks: a full queue rejects the push and counts
+// it, an empty one fails the pop.
+template <typename T, uint16_t Size>
+class SpscQueue {
+private:
+    static_assert((Size & (Size - 1)) == 0, "Queue size must be a power of two");
+
+    T items[Size];
+    std::atomic<uint32_t> head;  // Written by the producer
+    std::atomic<uint32_t> tail;  // Written by the consumer
+    std::atomic<uint32_t> rejected;
+
+public:
+    SpscQueue() : head(0), tail(0), rejected(0) {}
+
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= Size) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (Size - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        out = items[t & (Size - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+    uint32_t getRejected() const { return rejected.load(std::memory_order_relaxed); }
+    static uint16_t capacity() { return Size; }
+};
+
+#endif // SPSC_QUEUE_H
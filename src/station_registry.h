@@ -0,0 +1,127 @@
+#ifndef STATION_REGISTRY_H
+#define STATION_REGISTRY_H
+
+#include <Arduino.h>
+
+#define STATION_ADDRESS_SIZE 6
+
+// Smallest power of two with room for twice the stations, keeps probes short
+constexpr uint8_t stationIndexSize(uint8_t capacity, uint8_t size = 1) {
+    return size >= capacity * 2 ? size : stationIndexSize(capacity, size * 2);
+}
+
+template <typename Data>
+struct RegisteredStation {
+    uint8_t address[STATION_ADDRESS_SIZE];  // BLE identity address of the peer
+    Data data;
+    uint32_t firstSeenMs;
+    uint32_t lastSeenMs;
+    uint32_t writes;
+};
+
+// Fixed-capacity table of remote stations keyed by BLE address.
+// A station keeps its slot until evicted; slots say nothing about which
+// station is which, callers hold on to addresses. An open-addressing index maps an address to its
+// slot in constant time for the write callback. When the table is full,
+// a station silent for longer than the stale time gives up its slot.
+template <typename Data, uint8_t Capacity>
+class StationRegistry {
+private:
+    static const uint8_t INDEX_SIZE = stationIndexSize(Capacity);
+
+    RegisteredStation<Data> stations[Capacity];
+    uint8_t index[INDEX_SIZE];  // Slot + 1, 0 when free
+    uint8_t count;
+
+    static uint8_t hashAddress(const uint8_t* address) {
+        uint32_t hash = 2166136261u;
+        for (uint8_t i = 0; i < STATION_ADDRESS_SIZE; i++) {
+            hash = (hash ^ address[i]) * 16777619u;
+        }
+        return (uint8_t)(hash & (INDEX_SIZE - 1));
+    }
+
+    void insertIndex(const uint8_t* address, uint8_t slot) {
+        uint8_t pos = hashAddress(address);
+        while (index[pos]) pos = (pos + 1) & (INDEX_SIZE - 1);
+        index[pos] = slot + 1;
+    }
+
+    // Only after an eviction, which needs the index without the old address
+    void rebuildIndex() {
+        memset(index, 0, sizeof(index));
+        for (uint8_t i = 0; i < count; i++) insertIndex(stations[i].address, i);
+    }
+
+    void resetStation(uint8_t slot, const uint8_t* address, uint32_t nowMs) {
+        RegisteredStation<Data>& station = stations[slot];
+        memcpy(station.address, address, STATION_ADDRESS_SIZE);
+        station.data = Data();
+        station.firstSeenMs = nowMs;
+        station.lastSeenMs = nowMs;
+        station.writes = 0;
+    }
+
+public:
+    StationRegistry() : count(0) { memset(index, 0, sizeof(index)); }
+
+    // Slot of a known address, -1 when unknown
+    int8_t find(const uint8_t* address) const {
+        uint8_t pos = hashAddress(address);
+        while (index[pos]) {
+            uint8_t slot = index[pos] - 1;
+            if (memcmp(stations[slot].address, address, STATION_ADDRESS_SIZE) == 0) return slot;
+            pos = (pos + 1) & (INDEX_SIZE - 1);
+        }
+        return -1;
+    }
+
+    // Slot for the address, registering it when new. Returns -1 when the
+    // table is full and every station was seen within staleMs.
+    int8_t lookupOrAdd(const uint8_t* address, uint32_t nowMs, uint32_t staleMs) {
+        int8_t slot = find(address);
+        if (slot >= 0) return slot;
+
+        if (count < Capacity) {
+            slot = count;
+            resetStation(slot, address, nowMs);
+            insertIndex(address, slot);
+            count++;
+            return slot;
+        }
+
+        uint8_t stalest = 0;
+        for (uint8_t i = 1; i < count; i++) {
+            if ((int32_t)(stations[i].lastSeenMs - stations[stalest].lastSeenMs) < 0) stalest = i;
+        }
+        if (nowMs - stations[stalest].lastSeenMs < staleMs) return -1;
+        resetStation(stalest, address, nowMs);
+        rebuildIndex();
+        return stalest;
+    }
+
+    // Marks a write from the station in the slot
+    void touch(uint8_t slot, uint32_t nowMs) {
+        stations[slot].lastSeenMs = nowMs;
+        stations[slot].writes++;
+    }
+
+    uint8_t size() const { return count; }
+    static uint8_t capacity() { return Capacity; }
+    RegisteredStation<Data>& get(uint8_t slot) { return stations[slot]; }
+    const RegisteredStation<Data>& get(uint8_t slot) const { return stations[slot]; }
+
+    void clear() {
+        count = 0;
+        memset(index, 0, sizeof(index));
+    }
+};
+
+// "aa:bb:cc:dd:ee:ff" into out, which needs 18 bytes. NimBLE stores
+// addresses least significant byte first.
+inline void formatStationAddress(char* out, size_t size, const uint8_t* address) {
+    snprintf(out, size, "%02x:%02x:%02x:%02x:%02x:%02x",
+             address[5], address[4], address[3], address[2], address[1], address[0]);
+}
+
+#endif // STATION_REGISTRY_H
@@ -0,0 +1,176 @@
+#ifndef TICK_SCHEDULER_H
+#define TICK_SCHEDULER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "histogram.h"
+#include "trace.h"
+
+typedef void (*TickTaskFunction)();
+typedef uint32_t (*TickClock)();  // Microseconds, wraps like micros()
+typedef uint64_t (*TickDurationClock)();  // Microseconds that never wrap, e.g. esp_timer_get_time()
+typedef void (*TickTaskHook)(uint8_t index, bool starting);  // Around every task run
+
+struct TickTaskStats {
+    uint32_t runs;
+    uint32_t overruns;        // Runs that took longer than the budget
+    uint32_t missedDeadlines; // Runs that started later than period + deadline
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint64_t totalUs;
+};
+
+struct TickTask {
+    const char* name;
+    TickTaskFunction run;
+    uint32_t periodUs;
+    uint32_t deadlineUs;  // Allowed start lateness after becoming due
+    uint32_t budgetUs;    // Expected worst-case run time
+    uint32_t nextDueUs;
+    TickTaskStats stats;
+    LogHistogram<32> runUs;  // Run time distribution in microseconds
+};
+
+// Copy of a scheduler's tasks and statistics, for reading on another task
+template <uint8_t MaxTasks>
+struct TickSchedulerView {
+    uint8_t taskCount;
+    TickTask tasks[MaxTasks];
+    LogHistogram<32> passUs;
+};
+
+// Cooperative run-to-completion scheduler for the main loop.
+// Tasks run in registration order when due; nothing preempts them, so the
+// budget is a measurement target rather than a limit. run() reports how
+// long nothing is due so the caller can yield the CPU instead of spinning.
+// Run times also go into log histograms, which cost a timer read and an
+// increment per sample and so stay enabled in production. They are taken
+// from a 64-bit clock: a blocking handler that runs for seconds is still
+// measured correctly, where the 32-bit cycle counter wraps every ~18 s.
+template <uint8_t MaxTasks>
+class TickScheduler {
+private:
+    TickTask tasks[MaxTasks];
+    uint8_t taskCount;
+    TickClock clock;
+    TickDurationClock durationClock;
+    TickTaskHook taskHook;
+    LogHistogram<32> passUs;  // Busy passes of the whole loop
+    std::atomic<bool> resetRequested;
+
+    uint64_t durationNow() const { return durationClock ? durationClock() : clock(); }
+
+    // Microseconds since `start`, saturating; without a 64-bit clock the
+    // difference is taken modulo 2^32 like micros()
+    uint32_t durationSince(uint64_t start) const {
+        if (!durationClock) return (uint32_t)clock() - (uint32_t)start;
+        uint64_t elapsed = durationClock() - start;
+        return elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    }
+
+public:
+    // Without a duration clock, run times come from the scheduling clock
+    explicit TickScheduler(TickClock clockSource, TickDurationClock durationSource = nullptr)
+        : taskCount(0), clock(clockSource), durationClock(durationSource), taskHook(nullptr),
+          resetRequested(false) {
+    }
+
+    // Lets other instrumentation attribute work to the running task
+    void setTaskHook(TickTaskHook hook) { taskHook = hook; }
+
+    // Periods and deadlines in milliseconds, budget in microseconds.
+    // Returns the task index, or -1 when the table is full.
+    int8_t addTask(const char* name, TickTaskFunction fn, uint32_t periodMs,
+                   uint32_t deadlineMs, uint32_t budgetUs) {
+        if (taskCount >= MaxTasks) return -1;
+        TickTask& task = tasks[taskCount];
+        task.name = name;
+        task.run = fn;
+        task.periodUs = periodMs * 1000;
+        task.deadlineUs = deadlineMs * 1000;
+        task.budgetUs = budgetUs;
+        task.nextDueUs = clock();  // First run on the next pass
+        task.stats = TickTaskStats();
+        task.runUs.reset();
+        return taskCount++;
+    }
+
+    // Runs every due task once; returns microseconds until the next one is due
+    uint32_t run() {
+        if (resetRequested.load(std::memory_order_relaxed) && resetRequested.exchange(false)) {
+            resetStats();
+        }
+        uint64_t passStart = durationNow();
+        bool busy = false;
+        for (uint8_t i = 0; i < taskCount; i++) {
+            TickTask& task = tasks[i];
+            uint32_t start = clock();
+            int32_t late = (int32_t)(start - task.nextDueUs);
+            if (late < 0) continue;
+
+            if ((uint32_t)late > task.deadlineUs) task.stats.missedDeadlines++;
+            uint64_t runStart = durationNow();
+            TRACE_BEGIN(task.name);
+            if (taskHook) taskHook(i, true);
+            task.run();
+            if (taskHook) taskHook(i, false);
+            TRACE_END(task.name);
+            uint32_t elapsed = durationSince(runStart);
+            task.runUs.record(elapsed);
+            busy = true;
+
+            task.stats.runs++;
+            task.stats.lastUs = elapsed;
+            task.stats.totalUs += elapsed;
+            if (elapsed > task.stats.maxUs) task.stats.maxUs = elapsed;
+            if (elapsed > task.budgetUs) task.stats.overruns++;
+
+            // Keep the phase; after a stall of a whole period skip the
+            // missed runs instead of bursting to catch up
+            task.nextDueUs += task.periodUs;
+            uint32_t now = clock();
+            if ((int32_t)(now - task.nextDueUs) >= 0) {
+                task.nextDueUs = now + task.periodUs;
+            }
+        }
+        if (busy) passUs.record(durationSince(passStart));
+        return idleTime();
+    }
+
+    // Microseconds until the earliest task is due, 0 if one is due now
+    uint32_t idleTime() const {
+        if (taskCount == 0) return 0;
+        uint32_t now = clock();
+        int32_t earliest = INT32_MAX;
+        for (uint8_t i = 0; i < taskCount; i++) {
+            int32_t wait = (int32_t)(tasks[i].nextDueUs - now);
+            if (wait < earliest) earliest = wait;
+        }
+        return earliest > 0 ? (uint32_t)earliest : 0;
+    }
+
+    uint8_t getTaskCount() const { return taskCount; }
+    const TickTask& getTask(uint8_t index) const { return tasks[index]; }
+    const LogHistogram<32>& getPassHistogram() const { return passUs; }
+
+    // From the task that calls run()
+    void snapshot(TickSchedulerView<MaxTasks>& out) const {
+        out.taskCount = taskCount;
+        memcpy(out.tasks, tasks, sizeof(tasks));
+        out.passUs = passUs;
+    }
+
+    // From any task; the statistics are cleared at the start of the next pass
+    void requestReset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+    // From the task that calls run()
+    void resetStats() {
+        for (uint8_t i = 0; i < taskCount; i++) {
+            tasks[i].stats = TickTaskStats();
+            tasks[i].runUs.reset();
+        }
+        passUs.reset();
+    }
+};
+
+#endif // TICK_SCHEDULER_H
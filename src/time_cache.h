@@ -0,0 +1,66 @@
+#ifndef TIME_CACHE_H
+#define TIME_CACHE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+#define TIME_CHANGED_MINUTE 0x01
+#define TIME_CHANGED_DAY    0x02
+
+// Formatted local time kept in fixed buffers.
+// refresh() only reformats the fields whose value changed, so reading the
+// strings between minute (or day) boundaries costs nothing and never allocates.
+struct TimeCache {
+    char time[6];       // "HH:MM"
+    char date[11];      // "YYYY-MM-DD"
+    char dateTime[20];  // "YYYY-MM-DDTHH:MM:SS", as documented for /api/status
+    int32_t minute;     // Local minutes since epoch of `time`, -1 when stale
+    int32_t day;        // Local days since epoch of `date`, -1 when stale
+    time_t second;      // Local second of `dateTime`
+
+    TimeCache() { invalidate(); }
+
+    void invalidate() {
+        strcpy(time, "00:00");
+        strcpy(date, "1970-01-01");
+        strcpy(dateTime, "1970-01-01T00:00:00");
+        minute = -1;
+        day = -1;
+        second = -1;
+    }
+
+    // `local` is local time in seconds; returns TIME_CHANGED_* flags
+    uint8_t refresh(time_t local) {
+        int32_t nowMinute = (int32_t)(local / 60);
+        int32_t nowDay = (int32_t)(local / 86400);
+        uint8_t changed = 0;
+        if (nowMinute == minute && nowDay == day) return 0;
+
+        struct tm parts;
+        gmtime_r(&local, &parts);
+        if (nowMinute != minute) {
+            snprintf(time, sizeof(time), "%02d:%02d", parts.tm_hour, parts.tm_min);
+            minute = nowMinute;
+            changed |= TIME_CHANGED_MINUTE;
+        }
+        if (nowDay != day) {
+            snprintf(date, sizeof(date), "%04d-%02d-%02d",
+                     parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday);
+            day = nowDay;
+            changed |= TIME_CHANGED_DAY;
+        }
+        return changed;
+    }
+
+    // Seconds change every call, so the full timestamp is only formatted on demand
+    const char* formatDateTime(time_t local) {
+        refresh(local);
+        if (local != second) {
+            snprintf(dateTime, sizeof(dateTime), "%sT%s:%02d", date, time, (int)(local % 60));
+            second = local;
+        }
+        return dateTime;
+    }
+};
+
+#endif // TIME_CACHE_H
@@ -1,15 +1,45 @@
 #include "time_manager.h"
 // #include "web_server_manager.h" // Removed - using IoTWebUIManager instead
 #include "IoTWebUIManager.h"
+#include "config_store.h"
+#include "event_bus.h"
+#include <esp_sntp.h>
+#include <sys/time.h>
 
-TimeManager::TimeManager() : isInitialized(false), isSynced(false) {
+// Survives soft resets; validated by checksum before use
+RTC_NOINIT_ATTR static RetainedTime retainedTime;
+
+// Set from the lwIP task when SNTP has adjusted the system clock
+static volatile bool ntpSyncPending = false;
+
+static void onNtpSync(struct timeval* tv) {
+    ntpSyncPending = true;
+}
+
+TimeManager::TimeManager()
+    : isInitialized(false), quality(TIME_QUALITY_UNSYNCED), timezoneResolved(false),
+      retainedSecond(0), notifiedMinute(-1), lookupState(TZ_LOOKUP_IDLE), lookupRetryAt(0) {
+    wantedLocation[0] = '\0';
+    lookupLocation[0] = '\0';
+    lookupPosix[0] = '\0';
 }
 
 void TimeManager::begin() {
-    waitForTimeSync();
+    // ezTime only keeps the clock; the ESP-IDF SNTP client syncs it in the
+    // background and reports through onNtpSync()
+    setInterval(0);
+    sntp_set_time_sync_notification_cb(onNtpSync);
+    configTime(0, 0, TIME_NTP_SERVER);
+    
     loadTimezoneFromConfig();
+    if (restoreRetainedTime()) {
+        quality = TIME_QUALITY_ESTIMATED;
+        Serial.println("Time restored from RTC memory (estimated until NTP sync)");
+    } else {
+        memset(&retainedTime, 0, sizeof(retainedTime));
+        Serial.println("No retained time, clock unsynced until NTP responds");
+    }
     isInitialized = true;
-    isSynced = true;
     
     Serial.println("Time manager initialized");
     Serial.println("UTC: " + UTC.dateTime());
@@ -17,29 +47,149 @@ void TimeManager::begin() {
 }
 
 void TimeManager::update() {
-    // ezTime handles updates automatically
-    // This method can be used for periodic time checks if needed
+    if (ntpSyncPending) {
+        ntpSyncPending = false;
+        applyNtpSync();
+    }
+    if (lookupState.load() >= TZ_LOOKUP_DONE) {
+        finishTimezoneLookup();
+    }
+    // The location lookup needs the network, so it waits for the first sync
+    if (!timezoneResolved && quality == TIME_QUALITY_SYNCED && lookupState.load() == TZ_LOOKUP_IDLE &&
+        (int32_t)(millis() - lookupRetryAt) >= 0) {
+        startTimezoneLookup();
+    }
+    if (!isReady()) return;
+    
+    retainTime();
+    
+    // One comparison per loop; strings are only formatted on a new minute/day
+    cache.refresh(DateTime.now());
+    if (cache.minute != notifiedMinute) {
+        notifiedMinute = cache.minute;
+        eventBus().post(EVENT_PRODUCER_NETWORK, makeMinuteEvent((uint32_t)cache.minute, millis()));
+    }
 }
 
-void TimeManager::waitForTimeSync() {
-    Serial.println("Waiting for time sync...");
-    waitForSync();
-    Serial.println("Time synchronized successfully");
+bool TimeManager::restoreRetainedTime() {
+    if (!isRetainedTimeValid(retainedTime)) return false;
+    
+    UTC.setTime(estimateEpochAfterReset(retainedTime, millis()));
+    if (applyRetainedTimezone()) {
+        Serial.println("Timezone restored from RTC memory: " + String(retainedTime.location));
+    }
+    return true;
 }
 
-String TimeManager::getCurrentTime() {
-    if (!isReady()) return "00:00";
-    return DateTime.dateTime("H:i");
+// Reuses the resolved rule if it belongs to the wanted location
+bool TimeManager::applyRetainedTimezone() {
+    if (!isRetainedTimeValid(retainedTime) || !retainedTime.posix[0] ||
+        strcmp(retainedTime.location, wantedLocation) != 0) {
+        return false;
+    }
+    DateTime.setPosix(retainedTime.posix);
+    timezoneResolved = true;
+    return true;
+}
+
+void TimeManager::applyNtpSync() {
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    UTC.setTime(now.tv_sec, now.tv_usec / 1000);
+    
+    bool firstSync = quality != TIME_QUALITY_SYNCED;
+    quality = TIME_QUALITY_SYNCED;
+    if (firstSync) {
+        Serial.println("Time synchronized via NTP: " + UTC.dateTime());
+        eventBus().post(EVENT_PRODUCER_NETWORK, makeEvent(EVENT_TIME_SYNC, 0, 0, millis()));
+    }
+    cache.invalidate();
+    notifiedMinute = -1;
+}
+
+void TimeManager::startTimezoneLookup() {
+    strlcpy(lookupLocation, wantedLocation, sizeof(lookupLocation));
+    lookupPosix[0] = '\0';
+    lookupState.store(TZ_LOOKUP_RUNNING);
+    if (xTaskCreatePinnedToCore(timezoneLookupTask, "tzlookup", TIMEZONE_LOOKUP_STACK, this,
+                                1, nullptr, NETWORK_TASK_CORE) != pdPASS) {
+        lookupState.store(TZ_LOOKUP_FAILED);
+    }
 }
 
-String TimeManager::getCurrentDate() {
-    if (!isReady()) return "1970-01-01";
-    return DateTime.dateTime("Y-m-d");
+void TimeManager::timezoneLookupTask(void* arg) {
+    TimeManager* self = (TimeManager*)arg;
+    // A private Timezone, so the clock in use is never touched from this task
+    Timezone zone;
+    bool found = zone.setLocation(self->lookupLocation);
+    if (found) {
+        strlcpy(self->lookupPosix, zone.getPosix().c_str(), sizeof(self->lookupPosix));
+    }
+    self->lookupState.store(found && self->lookupPosix[0] ? TZ_LOOKUP_DONE : TZ_LOOKUP_FAILED);
+    vTaskDelete(nullptr);
+}
+
+void TimeManager::finishTimezoneLookup() {
+    bool found = lookupState.load() == TZ_LOOKUP_DONE;
+    lookupState.store(TZ_LOOKUP_IDLE);
+    if (strcmp(lookupLocation, wantedLocation) != 0) {
+        return;  // Location changed meanwhile, the next update() looks the new one up
+    }
+    if (!found) {
+        lookupRetryAt = millis() + TIMEZONE_LOOKUP_RETRY_MS;
+        Serial.printf("Timezone lookup failed, retrying in %u s: %s\n",
+                      (unsigned)(TIMEZONE_LOOKUP_RETRY_MS / 1000), lookupLocation);
+        return;
+    }
+    applyTimezone(lookupLocation, lookupPosix);
+    Serial.printf("Timezone resolved: %s (%s)\n", lookupLocation, lookupPosix);
+}
+
+void TimeManager::applyTimezone(const char* location, const char* posix) {
+    DateTime.setPosix(posix);
+    timezoneResolved = true;
+    retainTimezone(location);
+    cache.invalidate();  // Next update() reformats and notifies the display
+    notifiedMinute = -1;
+}
+
+void TimeManager::retainTime() {
+    uint32_t epoch = (uint32_t)UTC.now();
+    if (epoch == retainedSecond) return;
+    retainedSecond = epoch;
+    
+    // RTC RAM write, no flash wear
+    retainedTime.epoch = epoch;
+    sealRetainedTime(retainedTime);
+}
+
+void TimeManager::retainTimezone(const char* location) {
+    strlcpy(retainedTime.location, location, sizeof(retainedTime.location));
+    strlcpy(retainedTime.posix, DateTime.getPosix().c_str(), sizeof(retainedTime.posix));
+    sealRetainedTime(retainedTime);
 }
 
-String TimeManager::getCurrentDateTime() {
-    if (!isReady()) return "1970-01-01 00:00:00";
-    return DateTime.dateTime();
+const char* TimeManager::getQualityName() const {
+    switch (quality) {
+        case TIME_QUALITY_SYNCED: return "synced";
+        case TIME_QUALITY_ESTIMATED: return "estimated";
+        default: return "unsynced";
+    }
+}
+
+const char* TimeManager::getCurrentTime() {
+    if (isReady()) cache.refresh(DateTime.now());
+    return cache.time;
+}
+
+const char* TimeManager::getCurrentDate() {
+    if (isReady()) cache.refresh(DateTime.now());
+    return cache.date;
+}
+
+const char* TimeManager::getCurrentDateTime() {
+    if (!isReady()) return cache.dateTime;
+    return cache.formatDateTime(DateTime.now());
 }
 
 String TimeManager::getFormattedTime(const String& format) {
@@ -47,24 +197,33 @@ String TimeManager::getFormattedTime(const String& format) {
     return DateTime.dateTime(format);
 }
 
+uint32_t TimeManager::getEpoch() {
+    if (!isReady()) return 0;
+    return (uint32_t)UTC.now();
+}
+
 void TimeManager::setTimezone(const String& timezone) {
-    DateTime.setLocation(timezone);
-    Serial.println("Timezone set to: " + timezone);
+    strlcpy(wantedLocation, timezone.c_str(), sizeof(wantedLocation));
+    if (applyRetainedTimezone()) {
+        cache.invalidate();
+        notifiedMinute = -1;
+        Serial.println("Timezone set to: " + timezone);
+        return;
+    }
+    // Keep the current rule until the lookup for the new location finishes
+    timezoneResolved = false;
+    lookupRetryAt = millis();
+    Serial.println("Timezone set to: " + timezone + " (looking up the rule)");
 }
 
 String TimeManager::getTimezone() const {
-    return TIMEZONE_LOCATION; // ezTime doesn't have getLocation method
+    return wantedLocation;
 }
 
 void TimeManager::loadTimezoneFromConfig() {
-    // Access the global web interface manager to get config values
-    extern IoTWebUIManager* webManager;
-    if (webManager) {
-        String timezone = webManager->getConfigValue("timezone", TIMEZONE_LOCATION);
-        DateTime.setLocation(timezone);
-        Serial.println("Loaded timezone from config: " + timezone);
-    } else {
-        DateTime.setLocation(TIMEZONE_LOCATION);
-        Serial.println("Using default timezone: " + String(TIMEZONE_LOCATION));
-    }
+    // Read the timezone from the in-memory configuration cache
+    extern ConfigStore configStore;
+    strlcpy(wantedLocation, configStore.get().timezone.c_str(), sizeof(wantedLocation));
+    timezoneResolved = false;
+    lookupRetryAt = millis();
 }
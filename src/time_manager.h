@@ -2,8 +2,27 @@
 #define TIME_MANAGER_H
 
 #include <Arduino.h>
+#include <atomic>
 #include <ezTime.h>
 #include "config.h"
+#include "time_cache.h"
+#include "retained_time.h"
+
+// How far the clock can be trusted; exposed so consumers can discount
+// timestamps taken before the first NTP sync
+enum TimeQuality : uint8_t {
+    TIME_QUALITY_UNSYNCED = 0,  // No time source yet, clock reads 1970
+    TIME_QUALITY_ESTIMATED,     // Restored from RTC memory after a reset
+    TIME_QUALITY_SYNCED         // Set by NTP
+};
+
+// Progress of the background location lookup
+enum TimezoneLookupState : uint8_t {
+    TZ_LOOKUP_IDLE = 0,
+    TZ_LOOKUP_RUNNING,  // Worker task owns lookupLocation/lookupPosix
+    TZ_LOOKUP_DONE,     // lookupPosix holds the rule
+    TZ_LOOKUP_FAILED
+};
 
 // Forward declaration
 class WebServerManager;
@@ -12,29 +31,54 @@ class TimeManager {
 private:
     Timezone DateTime;
     bool isInitialized;
-    bool isSynced;
+    TimeQuality quality;
+    bool timezoneResolved;   // POSIX rule for the configured location is loaded
+    uint32_t retainedSecond;
+    TimeCache cache;
+    int32_t notifiedMinute;  // Getters may refresh the cache first, so track what was announced
+    
+    // ezTime's setLocation() blocks on a network query for up to seconds, so it
+    // runs in a short-lived task and update() applies the POSIX rule it found
+    char wantedLocation[40];
+    char lookupLocation[40];
+    char lookupPosix[48];
+    std::atomic<uint8_t> lookupState;
+    uint32_t lookupRetryAt;
     
-    void waitForTimeSync();
+    bool restoreRetainedTime();
+    bool applyRetainedTimezone();
+    void applyNtpSync();
+    void startTimezoneLookup();
+    void finishTimezoneLookup();
+    static void timezoneLookupTask(void* arg);
+    void applyTimezone(const char* location, const char* posix);
+    void retainTime();
+    void retainTimezone(const char* location);
     
 public:
     TimeManager();
     
-    void begin();
-    void update();
+    void begin();   // Starts background NTP, never waits for it
+    void update();  // Applies NTP results, refreshes cached strings, publishes minute changes
     
-    // Time access
-    String getCurrentTime();
-    String getCurrentDate();
-    String getCurrentDateTime();
+    // Time access, formatted once per minute/day into fixed buffers
+    const char* getCurrentTime();
+    const char* getCurrentDate();
+    const char* getCurrentDateTime();
     String getFormattedTime(const String& format);
+    uint32_t getEpoch();  // UTC seconds, 0 while unsynced
     
     // Status
-    bool isReady() const { return isInitialized && isSynced; }
-    bool isTimeSynced() const { return isSynced; }
+    bool isReady() const { return isInitialized && quality != TIME_QUALITY_UNSYNCED; }
+    bool isTimeSynced() const { return quality == TIME_QUALITY_SYNCED; }
+    TimeQuality getQuality() const { return quality; }
+    const char* getQualityName() const;
     
-    // Timezone
+    // Timezone; takes effect at once if the rule is retained, otherwise after
+    // a background lookup once NTP has synced
     void setTimezone(const String& timezone);
     String getTimezone() const;
+    bool isTimezoneResolved() const { return timezoneResolved; }
     
     // Configuration
     void loadTimezoneFromConfig();
@@ -0,0 +1,140 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "config.h"
+
+// Timestamped event tracing for stall analysis.
+// Events go into a fixed ring that any task or callback can write without
+// locks; the oldest events are overwritten. A dump renders the ring as
+// Chrome trace JSON (chrome://tracing, ui.perfetto.dev). With TRACE_ENABLED
+// at 0 the TRACE_* macros expand to nothing and no ring is allocated.
+
+struct TraceEvent {
+    uint32_t timestampUs;
+    const char* name;  // Must be a string literal or otherwise static
+    char phase;        // 'B' begin, 'E' end, 'i' instant
+    uint8_t tid;       // CPU core, keeps begin/end pairs of a core together
+};
+
+template <uint16_t Size>
+class TraceRing {
+private:
+    static_assert((Size & (Size - 1)) == 0, "Trace ring size must be a power of two");
+
+    struct Slot {
+        TraceEvent event;
+        std::atomic<uint32_t> sequence;  // Index + 1 once the slot is complete, 0 while written
+    };
+
+    Slot slots[Size];
+    std::atomic<uint32_t> head;
+
+public:
+    TraceRing() : head(0) {
+        for (uint16_t i = 0; i < Size; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+
+    void record(const char* name, char phase, uint8_t tid, uint32_t timestampUs) {
+        uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[index & (Size - 1)];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.event.timestampUs = timestampUs;
+        slot.event.name = name;
+        slot.event.phase = phase;
+        slot.event.tid = tid;
+        slot.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    // Visit the retained events oldest first. Slots that are being
+    // overwritten while the dump runs are skipped rather than torn.
+    template <typename Fn>
+    uint32_t forEach(Fn fn) const {
+        uint32_t end = head.load(std::memory_order_acquire);
+        uint32_t start = end > Size ? end - Size : 0;
+        uint32_t visited = 0;
+        for (uint32_t index = start; index < end; index++) {
+            const Slot& slot = slots[index & (Size - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != index + 1) continue;
+            TraceEvent copy = slot.event;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) != index + 1) continue;
+            fn(copy);
+            visited++;
+        }
+        return visited;
+    }
+
+    uint32_t getRecorded() const { return head.load(std::memory_order_relaxed); }
+    uint32_t getDropped() const {
+        uint32_t recorded = getRecorded();
+        return recorded > Size ? recorded - Size : 0;
+    }
+    static uint16_t getCapacity() { return Size; }
+
+    void clear() {
+        for (uint16_t i = 0; i < Size; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+        head.store(0, std::memory_order_release);
+    }
+};
+
+// One Chrome trace event object, with a leading comma unless it is the first
+inline size_t formatTraceEvent(char* out, size_t size, const TraceEvent& event, bool first) {
+    int len;
+    if (event.phase == 'i') {
+        len = snprintf(out, size, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lu,\"pid\":1,\"tid\":%u}",
+                       first ? "" : ",", event.name, (unsigned long)event.timestampUs, (unsigned)event.tid);
+    } else {
+        len = snprintf(out, size, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lu,\"pid\":1,\"tid\":%u}",
+                       first ? "" : ",", event.name, event.phase, (unsigned long)event.timestampUs,
+                       (unsigned)event.tid);
+    }
+    if (len < 0) return 0;
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
+
+#define TRACE_JSON_HEADER "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["
+#define TRACE_JSON_FOOTER "]}"
+
+#if TRACE_ENABLED
+
+typedef TraceRing<TRACE_RING_SIZE> StationTraceRing;
+
+inline StationTraceRing& traceRing() {
+    static StationTraceRing ring;
+    return ring;
+}
+
+inline void traceRecord(const char* name, char phase) {
+    traceRing().record(name, phase, (uint8_t)xPortGetCoreID(), (uint32_t)micros());
+}
+
+// Begin/end pair bound to a C++ scope
+class TraceScope {
+private:
+    const char* name;
+
+public:
+    explicit TraceScope(const char* scopeName) : name(scopeName) { traceRecord(name, 'B'); }
+    ~TraceScope() { traceRecord(name, 'E'); }
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_BEGIN(name) traceRecord(name, 'B')
+#define TRACE_END(name) traceRecord(name, 'E')
+#define TRACE_INSTANT(name) traceRecord(name, 'i')
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+
+#define TRACE_BEGIN(name) do {} while (0)
+#define TRACE_END(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_SCOPE(name) do {} while (0)
+
+#endif // TRACE_ENABLED
+
+#endif // TRACE_H
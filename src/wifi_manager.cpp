@@ -1,110 +1,224 @@
 #include "wifi_manager.h"
 // #include "web_server_manager.h" // Removed - using IoTWebUIManager instead
 #include "IoTWebUIManager.h"
+#include "config_store.h"
 
 WeatherStationWiFiManager::WeatherStationWiFiManager() 
-    : isConnected(false) {
+    : isConnected(false),
+      reconnect(WIFI_RECONNECT_TIMEOUT_MS, WIFI_BACKOFF_BASE_MS, WIFI_BACKOFF_MAX_MS),
+      fastCacheLoaded(false), fastAttempt(false), skipFastConnect(false), connectStartedAt(0),
+      portalActive(false), portalStartedAt(0), credentialsChanged(false), mdnsStarted(false) {
+    memset(&fastCache, 0, sizeof(fastCache));
     setupWiFiManager();
 }
 
 void WeatherStationWiFiManager::setupWiFiManager() {
+    // The portal itself is served by the station's web UI (see startConfigPortal)
     wifiManager.setDebugOutput(true);
-    wifiManager.setConfigPortalTimeout(WIFI_CONFIG_TIMEOUT);
-    wifiManager.setCaptivePortalEnable(true);
     wifiManager.setHostname(WIFI_HOSTNAME);
-    
-    // Set callback for when entering config mode
-    wifiManager.setAPCallback([this](WiFiManager *myWiFiManager) {
-        this->onConfigMode();
-    });
+    reconnect.seed(esp_random());
 }
 
 bool WeatherStationWiFiManager::connectToWiFi() {
     Serial.println("Attempting to connect to WiFi...");
     
-    // Get stored WiFi credentials
-    extern IoTWebUIManager* webManager;
-    String wifiSSID = "";
-    String wifiPassword = "";
-    String hostname = WIFI_HOSTNAME;
-    String apSSID = WIFI_AP_SSID;
-    String apPassword = WIFI_AP_PASSWORD;
-    
-    if (webManager) {
-        wifiSSID = webManager->getConfigValue("wifi_ssid", "");
-        wifiPassword = webManager->getConfigValue("wifi_password", "");
-        hostname = webManager->getConfigValue("hostname", WIFI_HOSTNAME);
-        apSSID = webManager->getConfigValue("ap_ssid", WIFI_AP_SSID);
-        apPassword = webManager->getConfigValue("ap_password", WIFI_AP_PASSWORD);
-    }
+    // Get stored WiFi credentials from the configuration cache
+    extern ConfigStore configStore;
+    const StationConfig& config = configStore.get();
+    const String& wifiSSID = config.wifiSSID;
+    const String& wifiPassword = config.wifiPassword;
     
-    // Try to connect using stored credentials first
     if (wifiSSID.length() > 0 && wifiPassword.length() > 0) {
         Serial.println("Attempting to connect to stored WiFi: " + wifiSSID);
-        WiFi.begin(wifiSSID.c_str(), wifiPassword.c_str());
-        
-        // Wait for connection with timeout
-        int attempts = 0;
-        while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-            delay(500);
-            Serial.print(".");
-            attempts++;
-        }
         
-        if (WiFi.status() == WL_CONNECTED) {
-            Serial.println("\nWiFi connected successfully using stored credentials!");
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
-            
-            // Setup mDNS
-            if (!MDNS.begin(hostname.c_str())) {
-                Serial.println("Error setting up mDNS responder. Continuing without mDNS.");
-            } else {
-                Serial.println("mDNS responder started");
-                Serial.printf("Address: %s.local\n", hostname.c_str());
-                MDNS.addService("http", "tcp", WEB_SERVER_PORT);
-            }
-            
-            isConnected = true;
-            return true;
-        } else {
-            Serial.println("\nFailed to connect using stored credentials, trying WiFiManager...");
+        // Cached BSSID/channel first, then a full scan if that does not associate
+        bool fast = beginStationConnect(true);
+        waitForStation(fast ? WIFI_FAST_CONNECT_TIMEOUT_MS : WIFI_RECONNECT_TIMEOUT_MS);
+        if (fast && WiFi.status() != WL_CONNECTED) {
+            Serial.println("Fast connect failed, falling back to full scan");
+            skipFastConnect = true;
+            WiFi.disconnect(false);
+            beginStationConnect(false);
+            waitForStation(WIFI_RECONNECT_TIMEOUT_MS);
         }
+    } else {
+        // No credentials in the config, try the ones kept by the WiFi driver
+        Serial.println("No stored WiFi credentials, trying last network...");
+        beginStationConnect(false);
+        waitForStation(WIFI_RECONNECT_TIMEOUT_MS);
     }
     
-    // Fall back to WiFiManager if no stored credentials or connection failed
-    if (wifiManager.autoConnect(apSSID.c_str(), apPassword.c_str())) {
-        Serial.println("WiFi connected successfully via WiFiManager!");
+    if (WiFi.status() == WL_CONNECTED) {
+        recordConnectTime();
+        Serial.println("\nWiFi connected successfully!");
         Serial.print("IP address: ");
         Serial.println(WiFi.localIP());
-        
-        // Setup mDNS
-        if (!MDNS.begin(hostname.c_str())) {
-            Serial.println("Error setting up mDNS responder. Continuing without mDNS.");
-        } else {
-            Serial.println("mDNS responder started");
-            Serial.printf("Address: %s.local\n", hostname.c_str());
-            MDNS.addService("http", "tcp", WEB_SERVER_PORT);
-        }
-        
+        setupMDNS();
         isConnected = true;
         return true;
-    } else {
-        Serial.println("Failed to connect to WiFi");
-        isConnected = false;
-        return false;
     }
+    
+    // The caller opens the config portal; reconnects continue in the background
+    Serial.println("\nFailed to connect to WiFi");
+    isConnected = false;
+    return false;
+}
+
+void WeatherStationWiFiManager::setupMDNS() {
+    if (mdnsStarted) return;
+    
+    extern ConfigStore configStore;
+    const String& hostname = configStore.get().hostname;
+    if (!MDNS.begin(hostname.c_str())) {
+        Serial.println("Error setting up mDNS responder. Continuing without mDNS.");
+        return;
+    }
+    Serial.println("mDNS responder started");
+    Serial.printf("Address: %s.local\n", hostname.c_str());
+    MDNS.addService("http", "tcp", WEB_SERVER_PORT);
+    mdnsStarted = true;
 }
 
 void WeatherStationWiFiManager::checkConnection() {
-    if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("WiFi connection lost, attempting to reconnect...");
-        isConnected = false;
-        if (!connectToWiFi()) {
-            Serial.println("Reconnection failed, starting config portal");
-            startConfigPortalIfNeeded();
+    if (portalActive) {
+        servicePortal();
+    }
+    
+    // Scanning moves the radio off the AP channel and drops portal clients,
+    // so hold off reconnecting while someone is using the portal
+    bool portalInUse = portalActive && WiFi.softAPgetStationNum() > 0;
+    if (portalInUse && !credentialsChanged && reconnect.getState() != LINK_CONNECTED) {
+        return;
+    }
+    
+    bool attempting = reconnect.getState() == LINK_CONNECTING;
+    switch (reconnect.step(millis(), WiFi.status() == WL_CONNECTED)) {
+        case LINK_ACTION_LOST:
+            Serial.println("WiFi connection lost, reconnecting in background...");
+            isConnected = false;
+            break;
+        case LINK_ACTION_BEGIN_CONNECT:
+            credentialsChanged = false;
+            beginReconnect();
+            break;
+        case LINK_ACTION_ATTEMPT_FAILED:
+            if (fastAttempt) {
+                skipFastConnect = true;  // Cached AP/lease did not work, rescan next time
+            }
+            Serial.printf("WiFi reconnect attempt %u failed, next try in %u ms\n",
+                          (unsigned)reconnect.getStats().attempts, (unsigned)reconnect.getStats().lastBackoffMs);
+            if (!portalActive && reconnect.getConsecutiveFailures() >= WIFI_PORTAL_AFTER_FAILURES) {
+                startConfigPortal();
+            }
+            break;
+        case LINK_ACTION_RESTORED:
+            isConnected = true;
+            if (attempting) {
+                recordConnectTime();
+            } else {
+                // The driver reassociated during backoff; connectStartedAt belongs
+                // to an earlier failed attempt, so there is no timing to record
+                rememberLink();
+            }
+            Serial.print("WiFi reconnected, IP address: ");
+            Serial.println(WiFi.localIP());
+            setupMDNS();
+            break;
+        default:
+            break;
+    }
+}
+
+void WeatherStationWiFiManager::beginReconnect() {
+    // Start the association and return; progress is polled by checkConnection()
+    WiFi.disconnect(false);
+    beginStationConnect(true);
+}
+
+bool WeatherStationWiFiManager::beginStationConnect(bool allowFast) {
+    extern ConfigStore configStore;
+    const StationConfig& config = configStore.get();
+    
+    if (!fastCacheLoaded) {
+        loadFastConnectCache();
+    }
+    
+    fastAttempt = allowFast && !skipFastConnect && fastCache.magic == WIFI_FAST_CACHE_MAGIC &&
+                  config.wifiSSID.length() > 0;
+    connectStartedAt = millis();
+    
+    if (fastAttempt) {
+        // Known AP and channel: no scan; known lease: no DHCP round trip
+        if (WIFI_REUSE_IP_LEASE && fastCache.ip != 0) {
+            WiFi.config(IPAddress(fastCache.ip), IPAddress(fastCache.gateway),
+                        IPAddress(fastCache.subnet), IPAddress(fastCache.dns));
         }
+        WiFi.begin(config.wifiSSID.c_str(), config.wifiPassword.c_str(), fastCache.channel, fastCache.bssid);
+        return true;
+    }
+    
+    // Full scan with DHCP
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    if (config.wifiSSID.length() > 0 && config.wifiPassword.length() > 0) {
+        WiFi.begin(config.wifiSSID.c_str(), config.wifiPassword.c_str());
+    } else {
+        WiFi.begin();  // Credentials saved by the config portal
+    }
+    return false;
+}
+
+void WeatherStationWiFiManager::waitForStation(unsigned long timeoutMs) {
+    while (WiFi.status() != WL_CONNECTED && millis() - connectStartedAt < timeoutMs) {
+        delay(50);
+    }
+}
+
+void WeatherStationWiFiManager::recordConnectTime() {
+    uint32_t elapsed = millis() - connectStartedAt;
+    if (fastAttempt) {
+        fastConnectMs.record(elapsed);
+    } else {
+        fullConnectMs.record(elapsed);
+    }
+    Serial.printf("WiFi connected in %u ms (%s)\n", (unsigned)elapsed, fastAttempt ? "fast" : "full scan");
+    rememberLink();
+}
+
+void WeatherStationWiFiManager::rememberLink() {
+    skipFastConnect = false;
+    saveFastConnectCache();
+}
+
+void WeatherStationWiFiManager::loadFastConnectCache() {
+    Preferences prefs;
+    fastCacheLoaded = true;
+    if (!prefs.begin(WIFI_FAST_CACHE_NAMESPACE, true)) return;
+    if (prefs.getBytes("link", &fastCache, sizeof(fastCache)) != sizeof(fastCache)) {
+        memset(&fastCache, 0, sizeof(fastCache));
+    }
+    prefs.end();
+}
+
+void WeatherStationWiFiManager::saveFastConnectCache() {
+    WiFiFastConnectCache latest;
+    memset(&latest, 0, sizeof(latest));
+    latest.magic = WIFI_FAST_CACHE_MAGIC;
+    memcpy(latest.bssid, WiFi.BSSID(), sizeof(latest.bssid));
+    latest.channel = WiFi.channel();
+    latest.ip = (uint32_t)WiFi.localIP();
+    latest.gateway = (uint32_t)WiFi.gatewayIP();
+    latest.subnet = (uint32_t)WiFi.subnetMask();
+    latest.dns = (uint32_t)WiFi.dnsIP(0);
+    
+    // Only touch flash when the association actually changed
+    if (memcmp(&latest, &fastCache, sizeof(latest)) == 0) return;
+    
+    Preferences prefs;
+    if (prefs.begin(WIFI_FAST_CACHE_NAMESPACE, false)) {
+        prefs.putBytes("link", &latest, sizeof(latest));
+        prefs.end();
     }
+    fastCache = latest;
 }
 
 void WeatherStationWiFiManager::resetSettings() {
@@ -119,13 +233,69 @@ void WeatherStationWiFiManager::startConfigPortalIfNeeded() {
 }
 
 void WeatherStationWiFiManager::startConfigPortal() {
+    if (portalActive) return;
+    
+    extern ConfigStore configStore;
+    const StationConfig& config = configStore.get();
+    
     Serial.println("Starting WiFi configuration portal...");
-    Serial.println("Connect to WiFi network: " + String(WIFI_AP_SSID));
-    Serial.println("Password: " + String(WIFI_AP_PASSWORD));
-    Serial.println("Then navigate to: http://" + String(WIFI_HOSTNAME) + ".local");
+    Serial.println("Connect to WiFi network: " + config.apSSID);
+    Serial.println("Password: " + config.apPassword);
+    Serial.println("Then navigate to: http://" + config.hostname + ".local");
     Serial.println("Or simply open any website - you'll be redirected automatically!");
     
-    wifiManager.startConfigPortal(WIFI_AP_SSID, WIFI_AP_PASSWORD);
+    // AP+STA keeps the station interface (and its reconnects) running; the
+    // regular web UI answers on the AP address, DNS points every name at it
+    WiFi.mode(WIFI_AP_STA);
+    if (!WiFi.softAP(config.apSSID.c_str(), config.apPassword.c_str())) {
+        Serial.println("Failed to start config portal AP");
+        WiFi.mode(WIFI_STA);
+        return;
+    }
+    dnsServer.setErrorReplyCode(DNSReplyCode::NoError);
+    dnsServer.start(WIFI_PORTAL_DNS_PORT, "*", WiFi.softAPIP());
+    
+    portalActive = true;
+    portalStartedAt = millis();
+    onConfigMode();
+}
+
+void WeatherStationWiFiManager::servicePortal() {
+    // One pending DNS query per call, never waits
+    dnsServer.processNextRequest();
+    
+    // Close once the station is online and the portal has been up for the
+    // configured time; without a link it stays open
+    if (isConnected && WiFi.softAPgetStationNum() == 0 &&
+        millis() - portalStartedAt >= WIFI_CONFIG_TIMEOUT * 1000UL) {
+        stopConfigPortal();
+    }
+}
+
+void WeatherStationWiFiManager::stopConfigPortal() {
+    if (!portalActive) return;
+    
+    dnsServer.stop();
+    WiFi.softAPdisconnect(true);
+    WiFi.mode(WIFI_STA);
+    portalActive = false;
+    Serial.println("WiFi configuration portal closed");
+}
+
+void WeatherStationWiFiManager::onCredentialsChanged() {
+    extern ConfigStore configStore;
+    const String& wifiSSID = configStore.get().wifiSSID;
+    
+    // Cached BSSID/lease belongs to the old network
+    skipFastConnect = true;
+    credentialsChanged = true;
+    
+    if (isConnected && WiFi.SSID() != wifiSSID) {
+        Serial.println("WiFi network changed, switching to " + wifiSSID);
+        WiFi.disconnect(false);  // Picked up as a drop, reconnects with the new credentials
+    } else if (!isConnected) {
+        reconnect.retryNow(millis());
+    }
 }
 
 void WeatherStationWiFiManager::onConfigMode() {
@@ -135,22 +305,14 @@ void WeatherStationWiFiManager::onConfigMode() {
 }
 
 void WeatherStationWiFiManager::loadConfigFromStorage() {
-    // Access the global web interface manager to get config values
-    extern IoTWebUIManager* webManager;
-    
-    String hostname = WIFI_HOSTNAME;
-    String apSSID = WIFI_AP_SSID;
-    String apPassword = WIFI_AP_PASSWORD;
-    String wifiSSID = "";
-    String wifiPassword = "";
-    
-    if (webManager) {
-        hostname = webManager->getConfigValue("hostname", WIFI_HOSTNAME);
-        apSSID = webManager->getConfigValue("ap_ssid", WIFI_AP_SSID);
-        apPassword = webManager->getConfigValue("ap_password", WIFI_AP_PASSWORD);
-        wifiSSID = webManager->getConfigValue("wifi_ssid", "");
-        wifiPassword = webManager->getConfigValue("wifi_password", "");
-    }
+    // Read config values from the in-memory cache
+    extern ConfigStore configStore;
+    const StationConfig& config = configStore.get();
+    const String& hostname = config.hostname;
+    const String& apSSID = config.apSSID;
+    const String& apPassword = config.apPassword;
+    const String& wifiSSID = config.wifiSSID;
+    const String& wifiPassword = config.wifiPassword;
     
     // Apply the configuration
     wifiManager.setHostname(hostname.c_str());
@@ -5,7 +5,11 @@
 #include <WiFiManager.h>
 #include <ESPmDNS.h>
 #include <WebServer.h>
+#include <Preferences.h>
+#include <DNSServer.h>
 #include "config.h"
+#include "reconnect_state_machine.h"
+#include "histogram.h"
 
 // Forward declaration
 class WebServerManager;
@@ -16,26 +20,74 @@ class WebServerManager;
     #endif
 #endif
 
+// Last successful association, used to skip the scan (and DHCP) on connect
+struct WiFiFastConnectCache {
+    uint32_t magic;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
 class WeatherStationWiFiManager {
 private:
     WiFiManager wifiManager;
     bool isConnected;
+    ReconnectStateMachine reconnect;
+    
+    // Fast reconnect state
+    WiFiFastConnectCache fastCache;
+    bool fastCacheLoaded;
+    bool fastAttempt;          // Current attempt uses the cache
+    bool skipFastConnect;      // Cache failed, next attempt does a full scan
+    unsigned long connectStartedAt;
+    LogHistogram<20> fastConnectMs;
+    LogHistogram<20> fullConnectMs;
+    
+    // Config portal: soft AP next to the station interface, serviced from
+    // checkConnection() so sensing continues while it is open
+    DNSServer dnsServer;
+    bool portalActive;
+    unsigned long portalStartedAt;
+    bool credentialsChanged;   // Retry with new credentials even while the portal is in use
+    bool mdnsStarted;
     
     void setupWiFiManager();
-    void startConfigPortal();
+    void setupMDNS();
+    void servicePortal();
+    void stopConfigPortal();
+    void beginReconnect();
+    bool beginStationConnect(bool allowFast);
+    void waitForStation(unsigned long timeoutMs);  // Boot path only
+    void recordConnectTime();
+    void rememberLink();  // Cache the working AP for the next fast connect
+    void loadFastConnectCache();
+    void saveFastConnectCache();
     
 public:
     WeatherStationWiFiManager();
     
     bool connectToWiFi();
     bool isWiFiConnected() const { return isConnected; }
-    void checkConnection();
+    void checkConnection();  // Non-blocking, call every loop iteration
     void resetSettings();
     void startConfigPortalIfNeeded();
+    void startConfigPortal();  // Non-blocking, opens the AP and returns
+    bool isPortalActive() const { return portalActive; }
+    void onCredentialsChanged();
     
     // Callback for when entering config mode
     void onConfigMode();
     
+    // Reconnect statistics
+    LinkState getLinkState() const { return reconnect.getState(); }
+    const LinkStats& getLinkStats() const { return reconnect.getStats(); }
+    uint32_t getDowntimeSeconds() const { return reconnect.getDowntimeMs(millis()) / 1000; }
+    const LogHistogram<20>& getFastConnectHistogram() const { return fastConnectMs; }
+    const LogHistogram<20>& getFullConnectHistogram() const { return fullConnectMs; }
+    
     // Configuration
     void loadConfigFromStorage();
     void applyConfiguration();
@@ -1,6 +1,32 @@
 #include <unity.h>
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include "../src/sample_ring.h"
+#include "../src/history_record.h"
+#include "../src/chart_downsampler.h"
+#include "../src/reconnect_state_machine.h"
+#include "../src/histogram.h"
+#include "../src/time_cache.h"
+#include "../src/retained_time.h"
+#include "../src/tick_scheduler.h"
+#include "../src/trace.h"
+#include "../src/alloc_tracker.h"
+#include "../src/json_arena.h"
+#include "../src/api_fields.h"
+#include "../src/logger.h"
+#include "../src/station_registry.h"
+#include "../src/outdoor_protocol.h"
+#include "../src/spsc_queue.h"
+#include "../src/seqlock.h"
+#include "../src/indoor_snapshot.h"
+#include "../src/link_metrics.h"
+#include "../src/ble_profile.h"
+#include "../src/measurement_store.h"
+#include "../src/event_bus.h"
+#include "../src/display_data.h"
+// test_build_src is off, so these are built from their sources here
+#include "../src/config_store.cpp"
+#include "../src/history_manager.cpp"
 
 // Test configuration
 #define TEST_TIMEOUT_MS 5000
@@ -275,6 +301,147 @@ void test_large_json_handling() {
     TEST_ASSERT_TRUE(jsonString.indexOf("\"readings\"") >= 0);
 }
 
+// A field table shaped like the /api/status one, run through the same
+// projection and serialization steps as generateSensorDataJSON()
+static void writeTestDateTime(JsonDocument& doc) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "2024-01-01 %02lu:%02lu:%02lu",
+             (millis() / 3600000) % 24, (millis() / 60000) % 60, (millis() / 1000) % 60);
+    doc["time"]["datetime"] = buffer;
+}
+
+static const ApiField TEST_API_FIELDS[] = {
+    {"timestamp",                [](JsonDocument& doc) { doc["timestamp"] = millis(); }},
+    {"status",                   [](JsonDocument& doc) { doc["status"] = "running"; }},
+    {"indoor.temperature",       [](JsonDocument& doc) { doc["indoor"]["temperature"] = TEST_VALID_TEMPERATURE; }},
+    {"indoor.humidity",          [](JsonDocument& doc) { doc["indoor"]["humidity"] = TEST_VALID_HUMIDITY; }},
+    {"indoor.pressure",          [](JsonDocument& doc) { doc["indoor"]["pressure"] = TEST_VALID_PRESSURE; }},
+    {"indoor.iaq",               [](JsonDocument& doc) { doc["indoor"]["iaq"] = TEST_VALID_IAQ; }},
+    {"indoor.iaq_accuracy",      [](JsonDocument& doc) { doc["indoor"]["iaq_accuracy"] = 3; }},
+    {"indoor.sequence",          [](JsonDocument& doc) { doc["indoor"]["sequence"] = 1234; }},
+    {"outdoor.temperature",      [](JsonDocument& doc) { doc["outdoor"]["temperature"] = TEST_VALID_TEMPERATURE - 10; }},
+    {"outdoor.humidity",         [](JsonDocument& doc) { doc["outdoor"]["humidity"] = TEST_VALID_HUMIDITY; }},
+    {"outdoor.battery_voltage",  [](JsonDocument& doc) { doc["outdoor"]["battery_voltage"] = TEST_VALID_BATTERY_VOLTAGE; }},
+    {"outdoor.battery_percentage", [](JsonDocument& doc) { doc["outdoor"]["battery_percentage"] = TEST_VALID_BATTERY_PERCENTAGE; }},
+    {"outdoor.state",            [](JsonDocument& doc) { doc["outdoor"]["state"] = "fresh"; }},
+    {"ble.frames",               [](JsonDocument& doc) { doc["ble"]["frames"] = 4321; }},
+    {"ble.duplicates",           [](JsonDocument& doc) { doc["ble"]["duplicates"] = 2; }},
+    {"time.datetime",            writeTestDateTime},
+    {"time.quality",             [](JsonDocument& doc) { doc["time"]["quality"] = "ntp"; }},
+    {"wifi.connected",           [](JsonDocument& doc) { doc["wifi"]["connected"] = true; }},
+    {"wifi.ip",                  [](JsonDocument& doc) { doc["wifi"]["ip"] = "192.168.1.42"; }},
+    {"wifi.rssi",                [](JsonDocument& doc) { doc["wifi"]["rssi"] = -61; }},
+};
+static const size_t TEST_API_FIELD_COUNT = sizeof(TEST_API_FIELDS) / sizeof(TEST_API_FIELDS[0]);
+static JsonArena<4096> projectionArena;
+
+static size_t serializeTestFields(String& out, const char* fields) {
+    out = String();
+    {
+        JsonDocument doc(&projectionArena);
+        writeApiFields(doc, TEST_API_FIELDS, TEST_API_FIELD_COUNT, fields);
+        out.reserve(measureJson(doc));
+        serializeJson(doc, out);
+    }
+    projectionArena.reset();
+    return out.length();
+}
+
+void test_field_selection() {
+    // Exact names and group prefixes
+    TEST_ASSERT_TRUE(isFieldSelected("indoor.iaq", "indoor.iaq"));
+    TEST_ASSERT_TRUE(isFieldSelected("indoor.iaq", "outdoor,indoor"));
+    TEST_ASSERT_TRUE(isFieldSelected("wifi.connect_ms.fast", "wifi.connect_ms"));
+    // A name prefix is not a group prefix
+    TEST_ASSERT_FALSE(isFieldSelected("indoor.iaq_accuracy", "indoor.iaq"));
+    TEST_ASSERT_FALSE(isFieldSelected("indoor", "indoor.iaq"));
+    // Empty lists and entries
+    TEST_ASSERT_FALSE(isFieldSelected("indoor.iaq", ""));
+    TEST_ASSERT_FALSE(isFieldSelected("indoor.iaq", ",,"));
+    TEST_ASSERT_TRUE(isFieldSelected("indoor.iaq", ",indoor.iaq,"));
+    // Unknown entries are ignored, blanks around entries too
+    TEST_ASSERT_FALSE(isFieldSelected("indoor.iaq", "bogus,indoor.nothing"));
+    TEST_ASSERT_TRUE(isFieldSelected("indoor.iaq", "bogus, indoor.iaq "));
+    
+    // Repeated entries write the field once, unknown ones write nothing
+    String json;
+    JsonDocument doc;
+    TEST_ASSERT_EQUAL(1, writeApiFields(doc, TEST_API_FIELDS, TEST_API_FIELD_COUNT, "status,status,status"));
+    doc.clear();
+    TEST_ASSERT_EQUAL(0, writeApiFields(doc, TEST_API_FIELDS, TEST_API_FIELD_COUNT, "nonsense"));
+    serializeTestFields(json, "nonsense");
+    TEST_ASSERT_EQUAL_STRING("{}", json.c_str());
+    // A null or empty list selects everything
+    doc.clear();
+    TEST_ASSERT_EQUAL(TEST_API_FIELD_COUNT, writeApiFields(doc, TEST_API_FIELDS, TEST_API_FIELD_COUNT, nullptr));
+    doc.clear();
+    TEST_ASSERT_EQUAL(TEST_API_FIELD_COUNT, writeApiFields(doc, TEST_API_FIELDS, TEST_API_FIELD_COUNT, ""));
+    // Groups keep their nesting
+    serializeTestFields(json, "indoor.iaq,outdoor.battery_percentage");
+    TEST_ASSERT_EQUAL_STRING("{\"indoor\":{\"iaq\":25},\"outdoor\":{\"battery_percentage\":85}}", json.c_str());
+}
+
+// Channel rows resolved from the measurement store, as /api/status does
+static MeasurementStore groupStore;
+
+static size_t writeTestChannels(JsonDocument& doc, const char* group, const char* fields) {
+    return writeChannelFields(doc, groupStore, group, fields);
+}
+
+static const ApiField TEST_GROUP_FIELDS[] = {
+    {"status",          [](JsonDocument& doc) { doc["status"] = "running"; }},
+    {"indoor",          nullptr},
+    {"indoor.sequence", [](JsonDocument& doc) { doc["indoor"]["sequence"] = 7; }},
+    {"outdoor",         nullptr},
+};
+
+void test_field_group_rows() {
+    // Test group rows expand to the channel table in place and are projected like other rows
+    groupStore.write(CH_INDOOR_TEMPERATURE, 21.5f, 0);
+    groupStore.write(CH_INDOOR_IAQ, 25, 0);
+    groupStore.write(CH_OUTDOOR_HUMIDITY, 64.25f, 0);
+    const size_t count = sizeof(TEST_GROUP_FIELDS) / sizeof(TEST_GROUP_FIELDS[0]);
+    
+    JsonDocument doc;
+    TEST_ASSERT_EQUAL(2 + CHANNEL_COUNT, writeApiFields(doc, TEST_GROUP_FIELDS, count, nullptr, writeTestChannels));
+    String json;
+    serializeJson(doc, json);
+    TEST_ASSERT_TRUE(json.startsWith("{\"status\":\"running\",\"indoor\":{\"temperature\":21.5,"));
+    TEST_ASSERT_TRUE(json.indexOf("\"altitude\":0,\"sequence\":7},\"outdoor\":{") > 0);
+    
+    doc.clear();
+    TEST_ASSERT_EQUAL(2, writeApiFields(doc, TEST_GROUP_FIELDS, count, "indoor.iaq,outdoor.humidity", writeTestChannels));
+    json = String();
+    serializeJson(doc, json);
+    TEST_ASSERT_EQUAL_STRING("{\"indoor\":{\"iaq\":25},\"outdoor\":{\"humidity\":64.25}}", json.c_str());
+    
+    // Without a group writer the group rows write nothing
+    doc.clear();
+    TEST_ASSERT_EQUAL(2, writeApiFields(doc, TEST_GROUP_FIELDS, count, nullptr));
+}
+
+void test_field_projection_benchmark() {
+    // Full document against a two-field projection through the real projection path
+    const int iterations = 200;
+    String json;
+    
+    unsigned long start = micros();
+    size_t fullLength = 0;
+    for (int i = 0; i < iterations; i++) fullLength = serializeTestFields(json, nullptr);
+    unsigned long fullTime = micros() - start;
+    
+    start = micros();
+    size_t projectedLength = 0;
+    for (int i = 0; i < iterations; i++) projectedLength = serializeTestFields(json, "indoor.iaq,outdoor.battery_percentage");
+    unsigned long projectedTime = micros() - start;
+    
+    Serial.printf("Field projection: full %lu us/request (%u bytes), projected %lu us/request (%u bytes)\n",
+                  fullTime / iterations, (unsigned)fullLength, projectedTime / iterations, (unsigned)projectedLength);
+    TEST_ASSERT_TRUE(projectedLength < fullLength);
+    TEST_ASSERT_TRUE(projectedTime < fullTime);
+    TEST_ASSERT_EQUAL(0, projectionArena.getOverflows());
+}
+
 // ===== ERROR HANDLING TESTS =====
 
 void test_error_conditions() {
@@ -337,6 +504,1874 @@ void test_configuration_handling() {
     TEST_ASSERT_EQUAL_STRING("testpass", config["wifi_password"]);
 }
 
+// ===== SAMPLE HISTORY TESTS =====
+
+struct TestSample {
+    uint32_t sequence;
+    float value;
+};
+
+void test_sample_sequence_monotonic() {
+    // Test that sample sequence numbers always increase
+    uint32_t first = nextSampleSequence();
+    uint32_t second = nextSampleSequence();
+    TEST_ASSERT_TRUE(second > first);
+}
+
+void test_sample_ring_since() {
+    // Test that only samples newer than `since` are returned
+    SampleRing<TestSample, 4> ring;
+    for (uint32_t seq = 1; seq <= 3; seq++) {
+        ring.push({seq, seq * 1.5f});
+    }
+    
+    uint32_t lastSeen = 0;
+    size_t visited = ring.forEachSince(1, [&lastSeen](const TestSample& sample) {
+        TEST_ASSERT_TRUE(sample.sequence > lastSeen);
+        lastSeen = sample.sequence;
+    });
+    
+    TEST_ASSERT_EQUAL(2, visited);
+    TEST_ASSERT_EQUAL(3, lastSeen);
+    TEST_ASSERT_FALSE(ring.hasGapAfter(0));
+}
+
+void test_sample_ring_eviction() {
+    // Test that evicted samples are reported as a gap
+    SampleRing<TestSample, 4> ring;
+    for (uint32_t seq = 1; seq <= 10; seq++) {
+        ring.push({seq * 2, 0.0f});  // Interleaved sequences, as with two sources
+    }
+    
+    TEST_ASSERT_EQUAL(4, ring.size());
+    TEST_ASSERT_EQUAL(14, ring.oldestSequence());
+    TEST_ASSERT_EQUAL(20, ring.latestSequence());
+    TEST_ASSERT_TRUE(ring.hasGapAfter(5));
+    TEST_ASSERT_FALSE(ring.hasGapAfter(12));
+    TEST_ASSERT_EQUAL(0, ring.forEachSince(20, [](const TestSample&) {}));
+}
+
+// ===== HISTORY EXPORT TESTS =====
+
+static HistoryRecord makeTestRecord(uint32_t epoch) {
+    HistoryRecord record;
+    record.epoch = epoch;
+    record.values[HISTORY_INDOOR_TEMPERATURE] = encodeHistoryValue(HISTORY_INDOOR_TEMPERATURE, TEST_VALID_TEMPERATURE, true);
+    record.values[HISTORY_INDOOR_HUMIDITY] = encodeHistoryValue(HISTORY_INDOOR_HUMIDITY, TEST_VALID_HUMIDITY, true);
+    record.values[HISTORY_INDOOR_PRESSURE] = encodeHistoryValue(HISTORY_INDOOR_PRESSURE, TEST_VALID_PRESSURE, true);
+    record.values[HISTORY_INDOOR_IAQ] = encodeHistoryValue(HISTORY_INDOOR_IAQ, TEST_VALID_IAQ, true);
+    record.values[HISTORY_OUTDOOR_TEMPERATURE] = encodeHistoryValue(HISTORY_OUTDOOR_TEMPERATURE, -5.25f, true);
+    record.values[HISTORY_OUTDOOR_HUMIDITY] = encodeHistoryValue(HISTORY_OUTDOOR_HUMIDITY, 0, false);
+    record.values[HISTORY_OUTDOOR_PRESSURE] = encodeHistoryValue(HISTORY_OUTDOOR_PRESSURE, 1012.8f, true);
+    record.values[HISTORY_OUTDOOR_BATTERY] = encodeHistoryValue(HISTORY_OUTDOOR_BATTERY, TEST_VALID_BATTERY_PERCENTAGE, true);
+    return record;
+}
+
+void test_history_row_format() {
+    // Test CSV and NDJSON rows for a selected channel subset
+    HistoryRecord record = makeTestRecord(1700000000);
+    uint16_t mask = historyChannelMask("indoor.temperature,outdoor");
+    char line[320];
+    
+    formatHistoryRow(line, sizeof(line), record, mask, HISTORY_FORMAT_CSV);
+    TEST_ASSERT_EQUAL_STRING("1700000000,22.50,-5.25,null,1012.8,85.00\n", line);
+    
+    formatHistoryRow(line, sizeof(line), record, historyChannelMask("indoor.iaq"), HISTORY_FORMAT_NDJSON);
+    TEST_ASSERT_EQUAL_STRING("{\"epoch\":1700000000,\"indoor.iaq\":25}\n", line);
+    
+    TEST_ASSERT_EQUAL(HISTORY_ALL_CHANNELS, historyChannelMask(""));
+    TEST_ASSERT_EQUAL(0, historyChannelMask("unknown"));
+}
+
+void test_history_range_search() {
+    // Test locating the first record of a range in sorted storage
+    uint32_t epochs[] = {100, 160, 220, 280, 340};
+    auto epochAt = [&epochs](size_t i) { return epochs[i]; };
+    
+    TEST_ASSERT_EQUAL(0, findFirstRecordAtOrAfter(5, 0, epochAt));
+    TEST_ASSERT_EQUAL(2, findFirstRecordAtOrAfter(5, 200, epochAt));
+    TEST_ASSERT_EQUAL(3, findFirstRecordAtOrAfter(5, 280, epochAt));
+    TEST_ASSERT_EQUAL(5, findFirstRecordAtOrAfter(5, 400, epochAt));
+}
+
+void test_history_export_throughput() {
+    // Format a large synthetic dataset with a fixed line buffer
+    const uint32_t samples = 200000;
+    char line[320];
+    size_t totalBytes = 0;
+    
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < samples; i++) {
+        HistoryRecord record = makeTestRecord(1700000000 + i * 60);
+        totalBytes += formatHistoryRow(line, sizeof(line), record, HISTORY_ALL_CHANNELS, HISTORY_FORMAT_CSV);
+    }
+    unsigned long elapsed = micros() - start;
+    
+    Serial.printf("History export: %lu samples, %u bytes in %lu ms (%lu samples/s)\n",
+                  (unsigned long)samples, (unsigned)totalBytes, elapsed / 1000,
+                  (unsigned long)(samples * 1000000ULL / (elapsed ? elapsed : 1)));
+    TEST_ASSERT_TRUE(totalBytes > samples * 20);
+}
+
+void test_history_clock_step_back_survives_reboot() {
+    // Test records stamped ahead of a clock that stepped back are dropped, and a reboot keeps what followed
+    HistoryManager history;
+    history.begin();
+    TEST_ASSERT_TRUE(history.isReady());
+    history.clear();
+    
+    ChannelSample indoor = ChannelSample();
+    indoor.values[CH_INDOOR_TEMPERATURE] = TEST_VALID_TEMPERATURE;
+    indoor.values[CH_INDOOR_HUMIDITY] = TEST_VALID_HUMIDITY;
+    indoor.values[CH_INDOOR_PRESSURE] = TEST_VALID_PRESSURE;
+    indoor.values[CH_INDOOR_IAQ] = TEST_VALID_IAQ;
+    indoor.isValid = true;
+    ChannelSample outdoor = ChannelSample();
+    
+    const uint32_t now = 1700000000;
+    const uint32_t ahead = now + 86400;  // Stamped by a clock running a day fast
+    history.update(now - 120, indoor, outdoor);
+    history.update(ahead, indoor, outdoor);
+    history.update(ahead + 60, indoor, outdoor);
+    // NTP steps the clock back
+    history.update(now, indoor, outdoor);
+    history.update(now + 60, indoor, outdoor);
+    TEST_ASSERT_EQUAL(3, history.getRecordCount());
+    TEST_ASSERT_EQUAL(now + 60, history.getLastEpoch());
+    
+    HistoryManager rebooted;
+    rebooted.begin();
+    TEST_ASSERT_EQUAL(now + 60, rebooted.getLastEpoch());
+    rebooted.update(now + 120, indoor, outdoor);
+    TEST_ASSERT_EQUAL(4, rebooted.getRecordCount());
+    TEST_ASSERT_EQUAL(now - 120, rebooted.getFirstEpoch());
+    
+    const uint32_t expected[] = {now - 120, now, now + 60, now + 120};
+    size_t seen = 0;
+    bool ordered = true;
+    bool encoded = true;
+    rebooted.forEachInRange(0, UINT32_MAX, [&](const HistoryRecord& record) {
+        if (seen >= 4 || record.epoch != expected[seen]) ordered = false;
+        if (record.values[HISTORY_INDOOR_IAQ] != TEST_VALID_IAQ ||
+            record.values[HISTORY_OUTDOOR_TEMPERATURE] != HISTORY_NO_VALUE) encoded = false;
+        seen++;
+    });
+    TEST_ASSERT_EQUAL(4, seen);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_TRUE(encoded);
+    rebooted.clear();
+}
+
+// ===== CHART DOWNSAMPLING TESTS =====
+
+static ChartDownsampler<480> testSampler;  // Bucket state kept off the test task stack
+
+static float testSeriesValue(uint32_t i) {
+    // Slow wave with a single spike that downsampling must preserve
+    return sinf(i / 500.0f) * 10.0f + (i == 50000 ? 40.0f : 0.0f);
+}
+
+void test_lttb_preserves_shape() {
+    // Test LTTB on 100k points: endpoints, ordering, spike and point budget
+    const uint32_t count = 100000;
+    const uint32_t x0 = 1700000000;
+    uint32_t firstX = 0, lastX = 0, previousX = 0;
+    float peak = -1000.0f;
+    bool ordered = true;
+    size_t emitted = 0;
+    auto collect = [&](uint32_t x, float y) {
+        if (emitted == 0) firstX = x;
+        if (emitted > 0 && x <= previousX) ordered = false;
+        previousX = lastX = x;
+        peak = max(peak, y);
+        emitted++;
+    };
+    
+    unsigned long start = micros();
+    testSampler.begin(x0, x0 + (count - 1) * 60, 240, CHART_MODE_LTTB);
+    for (uint32_t i = 0; i < count; i++) testSampler.accumulate(x0 + i * 60, testSeriesValue(i));
+    testSampler.prepareSelect();
+    for (uint32_t i = 0; i < count; i++) testSampler.select(x0 + i * 60, testSeriesValue(i), collect);
+    testSampler.finish(collect);
+    unsigned long elapsed = micros() - start;
+    
+    Serial.printf("LTTB: %lu points -> %u in %lu us\n", (unsigned long)count, (unsigned)emitted, elapsed);
+    TEST_ASSERT_TRUE(emitted <= 242);
+    TEST_ASSERT_EQUAL(x0, firstX);
+    TEST_ASSERT_EQUAL(x0 + (count - 1) * 60, lastX);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_TRUE(peak > 30.0f);
+}
+
+void test_minmax_downsampling() {
+    // Test min/max keeps both extremes of every bucket
+    const uint32_t count = 100000;
+    size_t emitted = 0;
+    float low = 1000.0f, high = -1000.0f;
+    auto collect = [&](uint32_t, float y) {
+        low = min(low, y);
+        high = max(high, y);
+        emitted++;
+    };
+    
+    unsigned long start = micros();
+    testSampler.begin(0, count - 1, 240, CHART_MODE_MINMAX);
+    for (uint32_t i = 0; i < count; i++) testSampler.select(i, testSeriesValue(i), collect);
+    testSampler.finish(collect);
+    unsigned long elapsed = micros() - start;
+    
+    Serial.printf("Min/max: %lu points -> %u in %lu us\n", (unsigned long)count, (unsigned)emitted, elapsed);
+    TEST_ASSERT_TRUE(emitted <= 480);
+    TEST_ASSERT_TRUE(high > 30.0f);
+    TEST_ASSERT_TRUE(low < -9.0f);
+}
+
+// ===== WIFI RECONNECT TESTS =====
+
+void test_reconnect_backoff_growth() {
+    // Test that retry delays grow exponentially, stay jittered and capped
+    ReconnectStateMachine machine(10000, 1000, 60000);
+    machine.seed(12345);
+    
+    for (uint8_t failures = 1; failures <= 10; failures++) {
+        uint32_t expected = min((uint32_t)(1000UL << (failures - 1)), (uint32_t)60000);
+        uint32_t delay = machine.backoffFor(failures);
+        TEST_ASSERT_TRUE(delay >= expected / 2);
+        TEST_ASSERT_TRUE(delay < expected);
+    }
+}
+
+void test_reconnect_flapping_link() {
+    // Simulate a flapping link with a 1 ms virtual clock
+    ReconnectStateMachine machine(10000, 1000, 60000);
+    uint32_t now = 0;
+    uint32_t connectRequests = 0;
+    uint32_t maxStepMicros = 0;
+    
+    for (int cycle = 0; cycle < 5; cycle++) {
+        // 30 s up, then 45 s down during which attempts time out
+        for (uint32_t t = 0; t < 30000; t += 10, now += 10) {
+            machine.step(now, true);
+        }
+        for (uint32_t t = 0; t < 45000; t += 10, now += 10) {
+            unsigned long start = micros();
+            if (machine.step(now, false) == LINK_ACTION_BEGIN_CONNECT) connectRequests++;
+            maxStepMicros = max(maxStepMicros, (uint32_t)(micros() - start));
+        }
+        TEST_ASSERT_TRUE(machine.getState() != LINK_CONNECTED);
+    }
+    machine.step(now, true);
+    
+    const LinkStats& stats = machine.getStats();
+    Serial.printf("Flapping WiFi: %u drops, %u attempts, %u ms down, max step %u us\n",
+                  (unsigned)stats.drops, (unsigned)stats.attempts,
+                  (unsigned)stats.totalDowntimeMs, (unsigned)maxStepMicros);
+    TEST_ASSERT_EQUAL(LINK_CONNECTED, machine.getState());
+    TEST_ASSERT_EQUAL(5, stats.drops);
+    TEST_ASSERT_EQUAL(connectRequests, stats.attempts);
+    TEST_ASSERT_TRUE(stats.attempts >= 5 * 3);  // Several timed-out attempts per outage
+    TEST_ASSERT_EQUAL(5 * 45000, stats.totalDowntimeMs);
+    TEST_ASSERT_EQUAL(0, machine.getDowntimeMs(now) - stats.totalDowntimeMs);
+}
+
+void test_reconnect_retry_now() {
+    // Test new credentials skip the remaining backoff
+    ReconnectStateMachine machine(10000, 1000, 60000);
+    uint32_t now = 0;
+    machine.step(now, false);  // Lost
+    for (int attempt = 0; attempt < 6; attempt++) {
+        while (machine.step(now, false) != LINK_ACTION_BEGIN_CONNECT) now += 10;
+        now += 10000;
+        TEST_ASSERT_EQUAL(LINK_ACTION_ATTEMPT_FAILED, machine.step(now, false));
+    }
+    TEST_ASSERT_TRUE(machine.getStats().lastBackoffMs >= 16000);
+    
+    machine.retryNow(now);
+    TEST_ASSERT_EQUAL(0, machine.getConsecutiveFailures());
+    TEST_ASSERT_EQUAL(LINK_ACTION_BEGIN_CONNECT, machine.step(now, false));
+}
+
+void test_log_histogram_percentiles() {
+    // Test log2 bucketing and percentile bounds
+    LogHistogram<20> histogram;
+    TEST_ASSERT_EQUAL(0, histogram.percentile(50));
+    
+    for (uint32_t i = 0; i < 90; i++) histogram.record(300);   // Bucket [256, 512)
+    for (uint32_t i = 0; i < 10; i++) histogram.record(5000);  // Bucket [4096, 8192)
+    
+    TEST_ASSERT_EQUAL(100, histogram.getCount());
+    TEST_ASSERT_EQUAL(5000, histogram.getMax());
+    TEST_ASSERT_EQUAL(511, histogram.percentile(50));
+    TEST_ASSERT_EQUAL(511, histogram.percentile(90));
+    TEST_ASSERT_EQUAL(5000, histogram.percentile(99));  // Clamped to the max seen
+    TEST_ASSERT_EQUAL(9, LogHistogram<20>::bucketOf(300));
+    TEST_ASSERT_EQUAL(19, LogHistogram<20>::bucketOf(UINT32_MAX));
+    
+    // Values past the last bucket report the max, not the bucket's lower bound
+    LogHistogram<8> narrow;
+    for (uint32_t i = 0; i < 10; i++) narrow.record(100000);
+    TEST_ASSERT_EQUAL(100000, narrow.percentile(50));
+    TEST_ASSERT_EQUAL(100000, narrow.percentile(99));
+    TEST_ASSERT_EQUAL(UINT32_MAX, LogHistogram<8>::bucketUpperBound(7));
+    TEST_ASSERT_EQUAL(63, LogHistogram<8>::bucketUpperBound(6));
+}
+
+// ===== TIME FORMATTING TESTS =====
+
+void test_time_cache_boundaries() {
+    // Test strings are only reformatted on minute and day boundaries
+    TimeCache cache;
+    TEST_ASSERT_EQUAL_STRING("00:00", cache.time);
+    
+    time_t local = 1700000000;  // 2023-11-14 22:13:20
+    TEST_ASSERT_EQUAL(TIME_CHANGED_MINUTE | TIME_CHANGED_DAY, cache.refresh(local));
+    TEST_ASSERT_EQUAL_STRING("22:13", cache.time);
+    TEST_ASSERT_EQUAL_STRING("2023-11-14", cache.date);
+    
+    TEST_ASSERT_EQUAL(0, cache.refresh(local + 39));
+    TEST_ASSERT_EQUAL(TIME_CHANGED_MINUTE, cache.refresh(local + 40));
+    TEST_ASSERT_EQUAL_STRING("22:14", cache.time);
+    
+    time_t midnight = 1700006400;  // 2023-11-15 00:00:00
+    TEST_ASSERT_EQUAL(TIME_CHANGED_MINUTE | TIME_CHANGED_DAY, cache.refresh(midnight));
+    TEST_ASSERT_EQUAL_STRING("00:00", cache.time);
+    TEST_ASSERT_EQUAL_STRING("2023-11-15", cache.date);
+    TEST_ASSERT_EQUAL_STRING("2023-11-15T00:00:07", cache.formatDateTime(midnight + 7));
+}
+
+void test_time_cache_read_cost() {
+    // Test reads within a minute stay cheap and allocation free
+    TimeCache cache;
+    time_t local = 1700000000;
+    cache.refresh(local);
+    uint32_t heapBefore = ESP.getFreeHeap();
+    unsigned long start = micros();
+    uint32_t changes = 0;
+    for (int i = 0; i < 10000; i++) {
+        changes += cache.refresh(local + (i % 40)) != 0;
+    }
+    unsigned long elapsed = micros() - start;
+    
+    Serial.printf("10000 cached time reads: %lu us\n", elapsed);
+    TEST_ASSERT_EQUAL(0, changes);
+    TEST_ASSERT_EQUAL(heapBefore, ESP.getFreeHeap());
+}
+
+void test_retained_time_validation() {
+    // Test retained time survives intact and rejects power-on garbage
+    RetainedTime retained;
+    memset(&retained, 0xA5, sizeof(retained));
+    TEST_ASSERT_FALSE(isRetainedTimeValid(retained));
+    
+    memset(&retained, 0, sizeof(retained));
+    retained.epoch = 1700000000;
+    strcpy(retained.location, "Asia/Jerusalem");
+    strcpy(retained.posix, "IST-2IDT,M3.4.4/26,M10.5.0");
+    sealRetainedTime(retained);
+    TEST_ASSERT_TRUE(isRetainedTimeValid(retained));
+    TEST_ASSERT_EQUAL(1700000012, estimateEpochAfterReset(retained, 12500));
+    
+    retained.epoch++;  // Changed without resealing
+    TEST_ASSERT_FALSE(isRetainedTimeValid(retained));
+    
+    retained.epoch = 1000;  // Never-synced clock
+    sealRetainedTime(retained);
+    TEST_ASSERT_FALSE(isRetainedTimeValid(retained));
+}
+
+// ===== SCHEDULER TESTS =====
+
+static uint32_t fakeMicros = 0;
+static uint32_t fastRuns = 0;
+static uint32_t slowRuns = 0;
+
+static uint32_t fakeClock() { return fakeMicros; }
+static void fastTask() { fastRuns++; fakeMicros += 100; }
+static void slowTask() { slowRuns++; fakeMicros += 30000; }  // Over its 20 ms budget
+
+void test_scheduler_periods_and_idle() {
+    // Test tasks run at their period and idle time points at the next one
+    fakeMicros = 0;
+    fastRuns = 0;
+    slowRuns = 0;
+    TickScheduler<4> scheduler(fakeClock);
+    TEST_ASSERT_EQUAL(0, scheduler.addTask("fast", fastTask, 10, 5, 1000));
+    TEST_ASSERT_EQUAL(1, scheduler.addTask("slow", slowTask, 1000, 100, 20000));
+    
+    uint32_t idlePasses = 0;
+    while (fakeMicros < 10000000) {
+        uint32_t idle = scheduler.run();
+        if (idle > 0) {
+            idlePasses++;
+            fakeMicros += idle;  // Sleep exactly until the next task is due
+        }
+    }
+    
+    const TickTask& fast = scheduler.getTask(0);
+    const TickTask& slow = scheduler.getTask(1);
+    Serial.printf("Scheduler: fast %u runs (%u missed), slow %u runs (%u overruns), %u idle passes\n",
+                  (unsigned)fast.stats.runs, (unsigned)fast.stats.missedDeadlines,
+                  (unsigned)slow.stats.runs, (unsigned)slow.stats.overruns, (unsigned)idlePasses);
+    TEST_ASSERT_INT_WITHIN(5, 1000 - 10 * 3, fastRuns);  // Each 30 ms slow run skips 3 fast periods
+    TEST_ASSERT_INT_WITHIN(1, 10, slowRuns);
+    TEST_ASSERT_EQUAL(slowRuns, slow.stats.overruns);
+    TEST_ASSERT_EQUAL(30000, slow.stats.maxUs);
+    TEST_ASSERT_TRUE(fast.stats.missedDeadlines >= 9);  // Delayed behind each slow run
+    TEST_ASSERT_TRUE(idlePasses > 900);  // The loop sleeps instead of spinning
+}
+
+void test_scheduler_stall_recovery() {
+    // Test a long stall does not trigger a burst of catch-up runs
+    fakeMicros = 0;
+    fastRuns = 0;
+    TickScheduler<2> scheduler(fakeClock);
+    scheduler.addTask("fast", fastTask, 10, 5, 1000);
+    scheduler.run();
+    fakeMicros += 500000;  // 50 periods pass without a run
+    scheduler.run();
+    scheduler.run();
+    TEST_ASSERT_EQUAL(2, fastRuns);
+    TEST_ASSERT_TRUE(scheduler.idleTime() > 9000);
+}
+
+static uint64_t fakeTimerMicros = 0;  // Stands in for esp_timer_get_time()
+static uint64_t fakeTimer() { return fakeTimerMicros; }
+static void timedFastTask() { fastRuns++; fakeMicros += 100; fakeTimerMicros += 100; }
+static void timedSlowTask() { slowRuns++; fakeMicros += 30000; fakeTimerMicros += 30000; }
+static void blockingTask() { fakeMicros += 20000000; fakeTimerMicros += 20000000; }  // 20 s
+
+void test_scheduler_latency_histograms() {
+    // Test per-task and whole-loop run time histograms from the 64-bit timer
+    fakeMicros = 0;
+    fakeTimerMicros = 0;
+    fastRuns = 0;
+    slowRuns = 0;
+    TickScheduler<4> scheduler(fakeClock, fakeTimer);
+    scheduler.addTask("fast", timedFastTask, 10, 5, 1000);
+    scheduler.addTask("slow", timedSlowTask, 1000, 100, 20000);
+    while (fakeMicros < 5000000) {
+        uint32_t idle = scheduler.run();
+        fakeMicros += idle;
+        fakeTimerMicros += idle;
+    }
+    
+    const LogHistogram<32>& fast = scheduler.getTask(0).runUs;
+    const LogHistogram<32>& slow = scheduler.getTask(1).runUs;
+    const LogHistogram<32>& pass = scheduler.getPassHistogram();
+    TEST_ASSERT_EQUAL(fastRuns, fast.getCount());
+    TEST_ASSERT_EQUAL(100, fast.getMax());
+    TEST_ASSERT_EQUAL(100, fast.percentile(99));  // Clamped to the exact max
+    TEST_ASSERT_EQUAL(30000, slow.percentile(50));
+    TEST_ASSERT_TRUE(pass.getMax() >= 30000 + 100);
+    TEST_ASSERT_TRUE(pass.percentile(50) < 1000);  // Most passes only run the fast task
+    
+    // Cost of a single histogram sample
+    LogHistogram<32> histogram;
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < 100000; i++) histogram.record(i * 37);
+    unsigned long elapsed = micros() - start;
+    Serial.printf("100000 histogram samples: %lu us\n", elapsed);
+    TEST_ASSERT_TRUE(elapsed < 100000);  // Well under 1 us each
+    
+    scheduler.resetStats();
+    TEST_ASSERT_EQUAL(0, scheduler.getPassHistogram().getCount());
+}
+
+void test_scheduler_long_handler_duration() {
+    // Test a handler running longer than a 32-bit cycle counter period (~17.9 s
+    // at 240 MHz) is measured with its real duration
+    fakeMicros = 0;
+    fakeTimerMicros = (uint64_t)UINT32_MAX - 1000;  // About to pass 2^32 us
+    TickScheduler<2> scheduler(fakeClock, fakeTimer);
+    scheduler.addTask("blocking", blockingTask, 1000, 100, 20000);
+    scheduler.run();
+    
+    const TickTask& task = scheduler.getTask(0);
+    TEST_ASSERT_EQUAL(20000000, task.runUs.getMax());
+    TEST_ASSERT_EQUAL(20000000, task.stats.maxUs);
+    TEST_ASSERT_EQUAL(1, task.stats.overruns);
+    TEST_ASSERT_EQUAL(20000000, scheduler.getPassHistogram().getMax());
+}
+
+void test_scheduler_reset_by_own_pass() {
+    // Test a reset requested from another task waits for the scheduler's next pass, and views are whole copies
+    fakeMicros = 0;
+    fastRuns = 0;
+    TickScheduler<2> scheduler(fakeClock);
+    scheduler.addTask("fast", fastTask, 10, 5, 1000);
+    scheduler.run();
+    fakeMicros += 10000;
+    scheduler.run();
+    
+    TickSchedulerView<2> view;
+    scheduler.snapshot(view);
+    TEST_ASSERT_EQUAL(1, view.taskCount);
+    TEST_ASSERT_EQUAL(2, view.tasks[0].stats.runs);
+    TEST_ASSERT_EQUAL(2, view.passUs.getCount());
+    
+    scheduler.requestReset();
+    TEST_ASSERT_EQUAL(2, scheduler.getTask(0).stats.runs);  // Untouched until the scheduler's own task runs it
+    fakeMicros += 10000;
+    scheduler.run();
+    TEST_ASSERT_EQUAL(1, scheduler.getTask(0).stats.runs);
+    TEST_ASSERT_EQUAL(1, scheduler.getPassHistogram().getCount());
+    TEST_ASSERT_EQUAL(2, view.tasks[0].stats.runs);  // The copy keeps what it saw
+}
+
+// ===== TRACE TESTS =====
+
+static TraceRing<16> testTraceRing;
+
+void test_trace_ring_wraps_in_order() {
+    // Test the ring keeps the newest events, oldest first
+    testTraceRing.clear();
+    static const char* const NAMES[] = {"a", "b", "c"};
+    for (uint32_t i = 0; i < 40; i++) {
+        testTraceRing.record(NAMES[i % 3], 'i', 1, 1000 + i);
+    }
+    
+    uint32_t expected = 1000 + 40 - 16;
+    uint32_t visited = testTraceRing.forEach([&](const TraceEvent& event) {
+        TEST_ASSERT_EQUAL(expected, event.timestampUs);
+        TEST_ASSERT_EQUAL_STRING(NAMES[(expected - 1000) % 3], event.name);
+        expected++;
+    });
+    TEST_ASSERT_EQUAL(16, visited);
+    TEST_ASSERT_EQUAL(40 - 16, testTraceRing.getDropped());
+}
+
+void test_trace_chrome_format() {
+    // Test events render as Chrome trace JSON
+    TraceEvent begin = {1234, "sensor", 'B', 1};
+    TraceEvent instant = {1300, "uart.frame", 'i', 0};
+    char json[256];
+    size_t len = snprintf(json, sizeof(json), "%s", TRACE_JSON_HEADER);
+    len += formatTraceEvent(json + len, sizeof(json) - len, begin, true);
+    len += formatTraceEvent(json + len, sizeof(json) - len, instant, false);
+    snprintf(json + len, sizeof(json) - len, "%s", TRACE_JSON_FOOTER);
+    
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, json));
+    TEST_ASSERT_EQUAL(2, doc["traceEvents"].size());
+    TEST_ASSERT_EQUAL_STRING("B", doc["traceEvents"][0]["ph"]);
+    TEST_ASSERT_EQUAL(1234, doc["traceEvents"][0]["ts"].as<uint32_t>());
+    TEST_ASSERT_EQUAL_STRING("uart.frame", doc["traceEvents"][1]["name"]);
+    TEST_ASSERT_EQUAL_STRING("t", doc["traceEvents"][1]["s"]);
+}
+
+void test_trace_record_cost() {
+    // Test recording stays cheap enough for hot paths
+    static TraceRing<512> ring;
+    unsigned long start = micros();
+    for (uint32_t i = 0; i < 10000; i++) {
+        ring.record("loop", (i & 1) ? 'E' : 'B', 1, i);
+    }
+    unsigned long elapsed = micros() - start;
+    Serial.printf("10000 trace events: %lu us\n", elapsed);
+    TEST_ASSERT_TRUE(elapsed < 20000);  // Under 2 us each
+}
+
+// ===== HEAP TELEMETRY TESTS =====
+
+static AllocTracker<8> testAllocTracker;
+
+void test_alloc_tracker_attribution() {
+    // Test allocations are counted for the active tag, other tasks apart
+    testAllocTracker.resetCounts();
+    uint8_t sensor = testAllocTracker.registerTag("sensor");
+    uint8_t web = testAllocTracker.registerTag("web");
+    TEST_ASSERT_EQUAL(1, sensor);
+    TEST_ASSERT_EQUAL(2, web);
+    
+    testAllocTracker.recordAlloc(10, true);  // Outside any scope
+    testAllocTracker.enter(web);
+    testAllocTracker.recordAlloc(512, true);
+    testAllocTracker.recordAlloc(64, true);
+    testAllocTracker.recordAlloc(100, false);  // From another task
+    testAllocTracker.recordFree(64, true);
+    testAllocTracker.leave();
+    
+    TEST_ASSERT_EQUAL(1, testAllocTracker.getTag(0).allocs);
+    TEST_ASSERT_EQUAL(2, testAllocTracker.getTag(web).allocs);
+    TEST_ASSERT_EQUAL(576, (uint32_t)testAllocTracker.getTag(web).bytes);
+    TEST_ASSERT_EQUAL(512, testAllocTracker.getTag(web).retained);
+    TEST_ASSERT_EQUAL(0, testAllocTracker.getTag(sensor).allocs);
+    TEST_ASSERT_EQUAL(1, testAllocTracker.getForeignAllocs());
+    TEST_ASSERT_EQUAL(4, testAllocTracker.getTotalAllocs());
+    TEST_ASSERT_EQUAL(1, testAllocTracker.getFrees());
+    TEST_ASSERT_EQUAL_STRING("untagged", testAllocTracker.getTagName(0));
+}
+
+void test_alloc_tracker_leak_simulation() {
+    // Test a long simulated run singles out the subsystem that leaks, while
+    // another core allocates and frees concurrently
+    static AllocTracker<8> tracker;
+    uint8_t balanced = tracker.registerTag("display");
+    uint8_t leaking = tracker.registerTag("history");
+    for (int run = 0; run < 10000; run++) {
+        tracker.enter(balanced);
+        tracker.recordAlloc(128, true);
+        tracker.recordAlloc(4096, false);  // The other core grabs a buffer meanwhile
+        tracker.recordRealloc(128, 256, true);
+        tracker.recordFree(256, true);     // Frees everything it allocated
+        tracker.leave();
+        tracker.enter(leaking);
+        tracker.recordAlloc(24, true);
+        tracker.recordFree(4096, false);   // ...and releases it in this scope
+        if (run % 10 != 0) tracker.recordFree(24, true);  // Keeps one small block every 10th run
+        tracker.leave();
+    }
+    Serial.printf("Simulated leak: %d bytes retained by %s over %u runs\n",
+                  (int)tracker.getTag(leaking).retained, tracker.getTagName(leaking),
+                  (unsigned)tracker.getTag(leaking).scopes);
+    TEST_ASSERT_EQUAL(0, tracker.getTag(balanced).retained);
+    TEST_ASSERT_EQUAL(24000, tracker.getTag(leaking).retained);
+    TEST_ASSERT_EQUAL(10000, tracker.getTag(leaking).scopes);
+    TEST_ASSERT_EQUAL(10000, tracker.getForeignAllocs());
+}
+
+void test_heap_fragmentation_percent() {
+    // Test fragmentation from free heap and largest free block
+    TEST_ASSERT_EQUAL(0, heapFragmentationPercent(100000, 100000));
+    TEST_ASSERT_EQUAL(75, heapFragmentationPercent(100000, 25000));
+    TEST_ASSERT_EQUAL(0, heapFragmentationPercent(0, 0));
+    TEST_ASSERT_TRUE(ESP.getMaxAllocHeap() <= ESP.getFreeHeap());
+    TEST_ASSERT_TRUE(ESP.getMinFreeHeap() <= ESP.getFreeHeap());
+}
+
+// ===== ZERO ALLOCATION TESTS =====
+
+// Every heap allocation in the test binary, via -Wl,--wrap=malloc,...
+static volatile uint32_t testHeapAllocs = 0;
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) { testHeapAllocs++; return __real_malloc(size); }
+void* __wrap_calloc(size_t count, size_t size) { testHeapAllocs++; return __real_calloc(count, size); }
+void* __wrap_realloc(void* ptr, size_t size) { testHeapAllocs++; return __real_realloc(ptr, size); }
+void __wrap_free(void* ptr) { __real_free(ptr); }
+}
+
+static SampleRing<ChannelSample, 16> steadyRing;
+static MeasurementStore steadyStore;
+static TimeCache steadyClock;
+static DisplayData steadyShown;
+static char steadyDisplayLine[32];
+static DeadbandFilter steadyIndoorFilter(IndoorDeadband{0.1f, 0.5f, 0.5f, 5.0f});
+static uint8_t steadyIndoorPayload[INDOOR_SNAPSHOT_SIZE];
+static String steadyResponse;
+static uint32_t steadyEpoch = 1700000000;
+static uint32_t steadyStationSequence = 1;
+static uint32_t steadyIndoorSequence = 0;
+static uint32_t steadyApiRuns = 0;
+static uint32_t steadyApiAllocs = 0;
+
+// The loop's work with the firmware's own off-target pieces: the v2 frame
+// decoder filling a ChannelSample for the sample ring and the measurement
+// store, TimeCache, the DisplayData fill and redraw check, the BLE indoor
+// snapshot up to its encoded payload, and the /api/status projection and
+// serialization path (serializeTestFields above). What does not run here:
+// NimBLE delivering the write and sending the notification, TFT drawing and
+// the WebServer parsing the request and sending the response.
+static void steadyIngest() {
+    // One sample as a station writes it
+    OutdoorSample station = {0, 12.5f, 80.0f, 1009.0f, 3.9f, 88.0f};
+    uint8_t frame[outdoorFrameSize(1)];
+    size_t length = encodeOutdoorBatch(frame, sizeof(frame), steadyStationSequence++, &station, 1);
+    
+    OutdoorBatch batch;
+    if (decodeOutdoorFrame(frame, length, batch) == OUTDOOR_FRAME_OK) {
+        const OutdoorSample& sample = batch.samples[0];
+        ChannelSample reading = ChannelSample();
+        reading.values[CH_OUTDOOR_TEMPERATURE] = sample.temperature;
+        reading.values[CH_OUTDOOR_HUMIDITY] = sample.humidity;
+        reading.values[CH_OUTDOOR_PRESSURE] = sample.pressure;
+        reading.values[CH_OUTDOOR_BATTERY_VOLTAGE] = sample.batteryVoltage;
+        reading.values[CH_OUTDOOR_BATTERY_PERCENTAGE] = sample.batteryPercentage;
+        reading.isValid = true;
+        reading.timestamp = fakeMicros / 1000;
+        reading.sequence = nextSampleSequence();
+        steadyStore.writeSample(CHANNEL_GROUP_OUTDOOR, reading);
+        steadyRing.push(reading);
+    }
+    
+    // And an indoor reading, as the sensor manager fills it from a frame
+    ChannelSample indoor = ChannelSample();
+    indoor.values[CH_INDOOR_TEMPERATURE] = 21.5f;
+    indoor.values[CH_INDOOR_HUMIDITY] = 45.0f;
+    indoor.values[CH_INDOOR_PRESSURE] = 1013.2f;
+    indoor.values[CH_INDOOR_IAQ] = 25;
+    indoor.values[CH_INDOOR_IAQ_ACCURACY] = 3;
+    indoor.isValid = true;
+    indoor.timestamp = fakeMicros / 1000;
+    indoor.sequence = nextSampleSequence();
+    steadyIndoorSequence = indoor.sequence;
+    steadyStore.writeSample(CHANNEL_GROUP_INDOOR, indoor);
+    fakeMicros += 200;
+}
+
+static void steadyTime() {
+    steadyClock.refresh(steadyEpoch++);
+    fakeMicros += 50;
+}
+
+static void steadyDisplay() {
+    DisplayData next;
+    for (uint8_t id = 0; id < CHANNEL_COUNT; id++) {
+        next.values[id] = steadyStore.value((ChannelId)id);
+    }
+    next.station = 0;
+    next.stationCount = 1;
+    next.outdoorStaleMin = 0;
+    if (isDisplayedDifferently(next, steadyShown)) steadyShown = next;
+    
+    char value[16];
+    formatChannel(value, sizeof(value), steadyStore, CH_OUTDOOR_TEMPERATURE);
+    snprintf(steadyDisplayLine, sizeof(steadyDisplayLine), "%s %s", value, steadyClock.time);
+    fakeMicros += 500;
+}
+
+static void steadyNotify() {
+    IndoorSnapshot snapshot;
+    snapshot.sequence = steadyIndoorSequence;
+    snapshot.temperature = steadyStore.value(CH_INDOOR_TEMPERATURE);
+    snapshot.humidity = steadyStore.value(CH_INDOOR_HUMIDITY);
+    snapshot.pressure = steadyStore.value(CH_INDOOR_PRESSURE);
+    snapshot.iaq = (uint16_t)steadyStore.value(CH_INDOOR_IAQ);
+    snapshot.iaqAccuracy = (uint8_t)steadyStore.value(CH_INDOOR_IAQ_ACCURACY);
+    encodeIndoorSnapshot(steadyIndoorPayload, snapshot);
+    steadyIndoorFilter.update(snapshot);
+    fakeMicros += 100;
+}
+
+static void steadyApi() {
+    uint32_t allocsBefore = testHeapAllocs;
+    serializeTestFields(steadyResponse, nullptr);
+    steadyApiAllocs += testHeapAllocs - allocsBefore;
+    steadyApiRuns++;
+    fakeMicros += 1000;
+}
+
+void test_steady_state_loop_allocations() {
+    // Test a warmed-up loop pass allocates nothing outside the API response,
+    // and the response String once per request
+    fakeMicros = 0;
+    TickScheduler<5> scheduler(fakeClock);
+    scheduler.addTask("ingest", steadyIngest, 20, 50, 1000);
+    scheduler.addTask("time", steadyTime, 100, 400, 1000);
+    scheduler.addTask("display", steadyDisplay, 100, 500, 40000);
+    scheduler.addTask("notify", steadyNotify, 100, 500, 1000);
+    scheduler.addTask("api", steadyApi, 50, 50, 50000);
+    
+    // Warm-up: first-use allocations (libc float formatting state) are allowed
+    for (int pass = 0; pass < 50; pass++) {
+        fakeMicros += scheduler.run();
+    }
+    
+    uint32_t allocsBefore = testHeapAllocs;
+    uint32_t apiAllocsBefore = steadyApiAllocs;
+    uint32_t apiRunsBefore = steadyApiRuns;
+    for (int pass = 0; pass < 2000; pass++) {
+        fakeMicros += scheduler.run();
+    }
+    uint32_t apiAllocs = steadyApiAllocs - apiAllocsBefore;
+    uint32_t allocs = testHeapAllocs - allocsBefore - apiAllocs;
+    uint32_t responses = steadyApiRuns - apiRunsBefore;
+    
+    Serial.printf("Steady state: %u allocations outside the API and %u in %u responses over 2000 passes, arena high water %u bytes\n",
+                  (unsigned)allocs, (unsigned)apiAllocs, (unsigned)responses, (unsigned)projectionArena.getHighWater());
+    TEST_ASSERT_TRUE(responses > 100);
+    TEST_ASSERT_EQUAL(0, allocs);
+    // The document lives in the arena; the returned String is sized once
+    TEST_ASSERT_TRUE(apiAllocs <= responses);
+    TEST_ASSERT_EQUAL(0, projectionArena.getOverflows());
+    TEST_ASSERT_TRUE(steadyStore.has(CH_OUTDOOR_TEMPERATURE));
+    TEST_ASSERT_EQUAL(16, steadyRing.size());
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, steadyShown.values[CH_OUTDOOR_TEMPERATURE]);
+    TEST_ASSERT_EQUAL(1, steadyIndoorFilter.getPassed());
+    TEST_ASSERT_TRUE(strncmp(steadyDisplayLine, "12.50 °C ", strlen("12.50 °C ")) == 0);
+    TEST_ASSERT_TRUE(steadyResponse.indexOf("\"time\":{\"datetime\"") >= 0);
+}
+
+void test_json_arena_overflow_and_reset() {
+    // Test an exhausted arena falls back to the heap and recovers on reset
+    static JsonArena<2048> arena;
+    uint32_t allocsBefore = testHeapAllocs;
+    {
+        JsonDocument doc(&arena);
+        JsonArray values = doc["values"].to<JsonArray>();
+        for (int i = 0; i < 1000; i++) values.add(i);
+        TEST_ASSERT_EQUAL(1000, doc["values"].size());
+        TEST_ASSERT_EQUAL(999, doc["values"][999].as<int>());
+    }
+    arena.reset();
+    TEST_ASSERT_TRUE(arena.getOverflows() > 0);
+    TEST_ASSERT_TRUE(testHeapAllocs > allocsBefore);
+    TEST_ASSERT_EQUAL(0, arena.getUsed());
+    
+    uint32_t overflows = arena.getOverflows();
+    {
+        JsonDocument doc(&arena);
+        doc["small"] = 1;
+    }
+    arena.reset();
+    TEST_ASSERT_EQUAL(overflows, arena.getOverflows());
+}
+
+// ===== LOGGER TESTS =====
+
+void test_log_record_formatting() {
+    // Test deferred records format like printf and survive bad arguments
+    LogRing<8> ring;
+    static const char* status = "ok";
+    logTo(ring, LOGGER_LEVEL_INFO, 12345, "T=%.1f, H=%5.2f%%, IAQ %d, len %u, %s x%02X",
+          22.54f, 45.0, 25, (size_t)20, status, (uint8_t)0xAB);
+    logTo(ring, LOGGER_LEVEL_WARN, 7, "swapped %s %d, missing %d", 5, "text");
+    
+    LogRecord record;
+    char line[LOGGER_LINE_SIZE];
+    TEST_ASSERT_TRUE(ring.pop(record));
+    formatLogRecord(line, sizeof(line), record);
+    TEST_ASSERT_EQUAL_STRING("[  12345][I] T=22.5, H=45.00%, IAQ 25, len 20, ok xAB", line);
+    
+    TEST_ASSERT_TRUE(ring.pop(record));
+    formatLogRecord(line, sizeof(line), record);
+    TEST_ASSERT_EQUAL_STRING("[      7][W] swapped <?> <?>, missing <?>", line);
+    TEST_ASSERT_FALSE(ring.pop(record));
+    
+    char small[16];
+    logTo(ring, LOGGER_LEVEL_ERROR, 1, "much longer than the buffer %d", 1);
+    TEST_ASSERT_TRUE(ring.pop(record));
+    TEST_ASSERT_EQUAL(15, formatLogRecord(small, sizeof(small), record));
+}
+
+void test_log_ring_overrun() {
+    // Test a lagging drain keeps the newest records and counts the rest
+    LogRing<8> ring;
+    for (int i = 0; i < 20; i++) {
+        logTo(ring, LOGGER_LEVEL_INFO, i, "n=%d", i);
+    }
+    
+    LogRecord record;
+    int32_t expected = 12;
+    while (ring.pop(record)) {
+        TEST_ASSERT_EQUAL(expected, record.args[0].i);
+        expected++;
+    }
+    TEST_ASSERT_EQUAL(20, expected);
+    TEST_ASSERT_EQUAL(12, ring.getDropped());
+    TEST_ASSERT_EQUAL(20, ring.getWritten());
+}
+
+void test_log_level_stripping() {
+    // Test calls below LOGGER_LEVEL never reach the ring
+    uint32_t before = logRing().getWritten();
+    LOGGER_DEBUG("stripped at level %d", LOGGER_LEVEL);
+#if LOGGER_LEVEL >= LOGGER_LEVEL_DEBUG
+    TEST_ASSERT_EQUAL(before + 1, logRing().getWritten());
+#else
+    TEST_ASSERT_EQUAL(before, logRing().getWritten());
+#endif
+    LOGGER_ERROR("kept at level %d", LOGGER_LEVEL);
+    TEST_ASSERT_TRUE(logRing().getWritten() > before);
+}
+
+void test_log_call_cost() {
+    // Test a log call on the hot path is cheap and does not allocate
+    static LogRing<64> ring;
+    const int calls = 10000;
+    uint32_t allocsBefore = testHeapAllocs;
+    unsigned long start = micros();
+    for (int i = 0; i < calls; i++) {
+        logTo(ring, LOGGER_LEVEL_DEBUG, i, "Sensor T=%.1f H=%.1f IAQ %d", 21.5f, 40.0f, i);
+    }
+    unsigned long elapsed = micros() - start;
+    
+    Serial.printf("Log call: %.2f us each (%d calls)\n", (float)elapsed / calls, calls);
+    TEST_ASSERT_EQUAL(0, testHeapAllocs - allocsBefore);
+    TEST_ASSERT_TRUE(elapsed < calls * 3);  // Under 3 us per call at 240 MHz
+}
+
+// ===== STATION REGISTRY TESTS =====
+
+void test_station_registry_lookup() {
+    // Test each address gets its own slot and keeps it
+    StationRegistry<TestSample, 3> registry;
+    const uint8_t first[6] = {1, 2, 3, 4, 5, 6};
+    const uint8_t second[6] = {1, 2, 3, 4, 5, 7};
+    
+    TEST_ASSERT_EQUAL(-1, registry.find(first));
+    TEST_ASSERT_EQUAL(0, registry.lookupOrAdd(first, 1000, 60000));
+    TEST_ASSERT_EQUAL(1, registry.lookupOrAdd(second, 1100, 60000));
+    registry.get(0).data.value = 12.5f;
+    registry.touch(0, 1200);
+    registry.touch(0, 1300);
+    
+    TEST_ASSERT_EQUAL(0, registry.lookupOrAdd(first, 1400, 60000));
+    TEST_ASSERT_EQUAL(1, registry.find(second));
+    TEST_ASSERT_EQUAL(2, registry.size());
+    TEST_ASSERT_EQUAL(2, registry.get(0).writes);
+    TEST_ASSERT_EQUAL(1300, registry.get(0).lastSeenMs);
+    TEST_ASSERT_EQUAL(1000, registry.get(0).firstSeenMs);
+    TEST_ASSERT_EQUAL_FLOAT(12.5f, registry.get(0).data.value);
+    TEST_ASSERT_EQUAL_FLOAT(0.0f, registry.get(1).data.value);
+}
+
+void test_station_registry_full_and_eviction() {
+    // Test a full table only gives up the slot of a silent station
+    StationRegistry<TestSample, 3> registry;
+    uint8_t address[6] = {0xAA, 0, 0, 0, 0, 0};
+    for (uint8_t i = 0; i < 3; i++) {
+        address[5] = i;
+        registry.lookupOrAdd(address, 1000 + i, 60000);
+    }
+    
+    address[5] = 9;
+    TEST_ASSERT_EQUAL(-1, registry.lookupOrAdd(address, 30000, 60000));
+    
+    const uint8_t active[6] = {0xAA, 0, 0, 0, 0, 0};
+    registry.touch(registry.find(active), 50000);
+    TEST_ASSERT_EQUAL(1, registry.lookupOrAdd(address, 70000, 60000));  // Slot 1 was silent longest
+    TEST_ASSERT_EQUAL(1, registry.find(address));
+    const uint8_t evicted[6] = {0xAA, 0, 0, 0, 0, 1};
+    TEST_ASSERT_EQUAL(-1, registry.find(evicted));
+    TEST_ASSERT_EQUAL(0, registry.find(active));
+    TEST_ASSERT_EQUAL(3, registry.size());
+}
+
+void test_station_address_format() {
+    // Test addresses print most significant byte first
+    const uint8_t address[6] = {0x3c, 0x2b, 0x1a, 0x28, 0x6f, 0x24};
+    char text[18];
+    formatStationAddress(text, sizeof(text), address);
+    TEST_ASSERT_EQUAL_STRING("24:6f:28:1a:2b:3c", text);
+}
+
+// ===== OUTDOOR PROTOCOL TESTS =====
+
+static void fillOutdoorSamples(OutdoorSample* samples, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        samples[i].ageSeconds = (count - 1 - i) * 60;  // One per minute, newest last
+        samples[i].temperature = -5.25f + i * 0.5f;
+        samples[i].humidity = 81.5f - i;
+        samples[i].pressure = 1009.3f + i * 0.1f;
+        samples[i].batteryVoltage = 3.912f;
+        samples[i].batteryPercentage = 87.4f;
+    }
+}
+
+void test_outdoor_batch_roundtrip() {
+    // Test a version 2 batch decodes to the encoded values at wire precision
+    OutdoorSample samples[3];
+    fillOutdoorSamples(samples, 3);
+    uint8_t frame[OUTDOOR_FRAME_MAX_SIZE];
+    size_t length = encodeOutdoorBatch(frame, sizeof(frame), 41, samples, 3);
+    TEST_ASSERT_EQUAL(outdoorFrameSize(3), length);
+    TEST_ASSERT_EQUAL(41, length);
+    
+    OutdoorBatch batch;
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_OK, decodeOutdoorFrame(frame, length, batch));
+    TEST_ASSERT_EQUAL(2, batch.version);
+    TEST_ASSERT_EQUAL(3, batch.count);
+    TEST_ASSERT_EQUAL(41, batch.firstSequence);
+    TEST_ASSERT_EQUAL(120, batch.samples[0].ageSeconds);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, -5.25f, batch.samples[0].temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 79.5f, batch.samples[2].humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 1009.5f, batch.samples[2].pressure);
+    TEST_ASSERT_FLOAT_WITHIN(0.0005f, 3.912f, batch.samples[1].batteryVoltage);
+    TEST_ASSERT_EQUAL_FLOAT(87.0f, batch.samples[1].batteryPercentage);
+    
+    // A single sample fits the 20 bytes of a default ATT write
+    TEST_ASSERT_TRUE(outdoorFrameSize(1) <= 20);
+    TEST_ASSERT_EQUAL(0, encodeOutdoorBatch(frame, outdoorFrameSize(2) - 1, 1, samples, 2));
+}
+
+void test_outdoor_legacy_frame() {
+    // Test the five-float legacy payload is still accepted
+    float legacy[OUTDOOR_VALUES_COUNT] = {18.3f, 65.1f, 1012.8f, 3.85f, 85.2f};
+    OutdoorBatch batch;
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_OK, decodeOutdoorFrame((const uint8_t*)legacy, sizeof(legacy), batch));
+    TEST_ASSERT_EQUAL(1, batch.version);
+    TEST_ASSERT_EQUAL(1, batch.count);
+    TEST_ASSERT_EQUAL(0, batch.firstSequence);
+    TEST_ASSERT_EQUAL_FLOAT(18.3f, batch.samples[0].temperature);
+    TEST_ASSERT_EQUAL_FLOAT(85.2f, batch.samples[0].batteryPercentage);
+}
+
+void test_outdoor_frame_rejection() {
+    // Test corrupted, truncated and unknown frames are rejected
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, outdoorCrc16((const uint8_t*)"123456789", 9));
+    
+    OutdoorSample samples[2];
+    fillOutdoorSamples(samples, 2);
+    uint8_t frame[OUTDOOR_FRAME_MAX_SIZE];
+    size_t length = encodeOutdoorBatch(frame, sizeof(frame), 7, samples, 2);
+    OutdoorBatch batch;
+    
+    frame[9] ^= 0x01;  // Single bit error in the first sample
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_BAD_CRC, decodeOutdoorFrame(frame, length, batch));
+    frame[9] ^= 0x01;
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_BAD_LENGTH, decodeOutdoorFrame(frame, length - 1, batch));
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_BAD_LENGTH, decodeOutdoorFrame(frame, 3, batch));
+    frame[0] = 3;
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_BAD_VERSION, decodeOutdoorFrame(frame, length, batch));
+    frame[0] = OUTDOOR_PROTOCOL_VERSION;
+    frame[1] = OUTDOOR_BATCH_MAX + 1;
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_BAD_LENGTH, decodeOutdoorFrame(frame, length, batch));
+}
+
+void test_outdoor_codec_benchmark() {
+    // Test encode and decode of a full batch stay well inside a BLE write interval
+    OutdoorSample samples[OUTDOOR_BATCH_MAX];
+    fillOutdoorSamples(samples, OUTDOOR_BATCH_MAX);
+    uint8_t frame[OUTDOOR_FRAME_MAX_SIZE];
+    static OutdoorBatch batch;
+    const int rounds = 1000;
+    
+    unsigned long start = micros();
+    size_t length = 0;
+    for (int i = 0; i < rounds; i++) {
+        length = encodeOutdoorBatch(frame, sizeof(frame), i, samples, OUTDOOR_BATCH_MAX);
+    }
+    unsigned long encodeUs = micros() - start;
+    
+    start = micros();
+    int decoded = 0;
+    for (int i = 0; i < rounds; i++) {
+        decoded += decodeOutdoorFrame(frame, length, batch) == OUTDOOR_FRAME_OK;
+    }
+    unsigned long decodeUs = micros() - start;
+    
+    Serial.printf("Outdoor codec, %u-sample batch (%u bytes vs %u legacy): encode %.1f us, decode %.1f us\n",
+                  (unsigned)OUTDOOR_BATCH_MAX, (unsigned)length,
+                  (unsigned)(OUTDOOR_BATCH_MAX * OUTDOOR_LEGACY_FRAME_SIZE),
+                  (float)encodeUs / rounds, (float)decodeUs / rounds);
+    TEST_ASSERT_EQUAL(rounds, decoded);
+    TEST_ASSERT_TRUE(encodeUs / rounds < 200);
+    TEST_ASSERT_TRUE(decodeUs / rounds < 200);
+}
+
+void test_spsc_queue_handoff() {
+    // Test the queue keeps order and rejects pushes when full
+    SpscQueue<uint32_t, 4> queue;
+    for (uint32_t i = 1; i <= 5; i++) queue.push(i);
+    TEST_ASSERT_EQUAL(4, queue.size());
+    TEST_ASSERT_EQUAL(1, queue.getRejected());
+    
+    uint32_t value = 0;
+    for (uint32_t expected = 1; expected <= 4; expected++) {
+        TEST_ASSERT_TRUE(queue.pop(value));
+        TEST_ASSERT_EQUAL(expected, value);
+    }
+    TEST_ASSERT_FALSE(queue.pop(value));
+    TEST_ASSERT_TRUE(queue.push(6));
+    TEST_ASSERT_TRUE(queue.pop(value));
+    TEST_ASSERT_EQUAL(6, value);
+}
+
+// ===== OUTDOOR TRANSFER TESTS =====
+
+void test_outdoor_fragment_reassembly() {
+    // Test a full batch survives fragmentation, and lost fragments drop the frame
+    OutdoorSample samples[OUTDOOR_BATCH_MAX];
+    fillOutdoorSamples(samples, OUTDOOR_BATCH_MAX);
+    uint8_t frame[OUTDOOR_FRAME_MAX_SIZE];
+    size_t length = encodeOutdoorBatch(frame, sizeof(frame), 100, samples, OUTDOOR_BATCH_MAX);
+    static uint8_t fragments[OUTDOOR_FRAGMENT_MAX_COUNT * OUTDOOR_FRAGMENT_SIZE];
+    uint8_t count = fragmentOutdoorFrame(fragments, sizeof(fragments), frame, length);
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAGMENT_MAX_COUNT, count);
+    TEST_ASSERT_TRUE(isOutdoorFragment(fragments, OUTDOOR_FRAGMENT_SIZE));
+    TEST_ASSERT_FALSE(isOutdoorFragment(frame, outdoorFrameSize(1)));
+    
+    static OutdoorReassembler reassembler;
+    for (uint8_t i = 0; i + 1 < count; i++) {
+        TEST_ASSERT_EQUAL(OUTDOOR_REASSEMBLY_PENDING, reassembler.add(fragments + i * OUTDOOR_FRAGMENT_SIZE, i * 10));
+    }
+    TEST_ASSERT_EQUAL(OUTDOOR_REASSEMBLY_COMPLETE,
+                      reassembler.add(fragments + (count - 1) * OUTDOOR_FRAGMENT_SIZE, (count - 1) * 10));
+    TEST_ASSERT_EQUAL(length, reassembler.size());
+    TEST_ASSERT_EQUAL_MEMORY(frame, reassembler.data(), length);
+    TEST_ASSERT_EQUAL((count - 1) * 10, reassembler.getElapsedMs());
+    static OutdoorBatch batch;
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAME_OK, decodeOutdoorFrame(reassembler.data(), reassembler.size(), batch));
+    TEST_ASSERT_EQUAL(OUTDOOR_BATCH_MAX, batch.count);
+    
+    // A missing fragment drops the partial frame
+    reassembler.add(fragments, 0);
+    TEST_ASSERT_EQUAL(OUTDOOR_REASSEMBLY_OUT_OF_ORDER, reassembler.add(fragments + 2 * OUTDOOR_FRAGMENT_SIZE, 20));
+    TEST_ASSERT_FALSE(reassembler.isPending());
+    
+    // A first fragment mid-frame starts over, as after a reconnect
+    reassembler.add(fragments, 0);
+    reassembler.add(fragments + OUTDOOR_FRAGMENT_SIZE, 10);
+    for (uint8_t i = 0; i + 1 < count; i++) reassembler.add(fragments + i * OUTDOOR_FRAGMENT_SIZE, 100);
+    TEST_ASSERT_EQUAL(OUTDOOR_REASSEMBLY_COMPLETE, reassembler.add(fragments + (count - 1) * OUTDOOR_FRAGMENT_SIZE, 100));
+    TEST_ASSERT_EQUAL_MEMORY(frame, reassembler.data(), length);
+}
+
+// Outdoor station writing with response, at most one write per connection event
+struct SimulatedPeer {
+    uint16_t mtu;
+    uint32_t intervalMs;
+};
+
+// Sends one frame the way the write callback receives it; returns the milliseconds until it was decoded
+uint32_t transferBatch(const SimulatedPeer& peer, const uint8_t* frame, size_t length,
+                       OutdoorReassembler& reassembler, OutdoorTransferMeter& meter, OutdoorBatch& batch) {
+    static uint8_t fragments[OUTDOOR_FRAGMENT_MAX_COUNT * OUTDOOR_FRAGMENT_SIZE];
+    uint32_t now = 0;
+    
+    if (length <= (size_t)(peer.mtu - 3)) {
+        now += peer.intervalMs;
+        meter.recordWrite(length, false);
+        meter.recordBatch(length, 0);
+        return decodeOutdoorFrame(frame, length, batch) == OUTDOOR_FRAME_OK ? now : 0;
+    }
+    
+    uint8_t count = fragmentOutdoorFrame(fragments, sizeof(fragments), frame, length);
+    for (uint8_t i = 0; i < count; i++) {
+        now += peer.intervalMs;
+        meter.recordWrite(OUTDOOR_FRAGMENT_SIZE, true);
+        if (reassembler.add(fragments + i * OUTDOOR_FRAGMENT_SIZE, now) == OUTDOOR_REASSEMBLY_COMPLETE) {
+            meter.recordBatch(reassembler.size(), reassembler.getElapsedMs());
+            return decodeOutdoorFrame(reassembler.data(), reassembler.size(), batch) == OUTDOOR_FRAME_OK ? now : 0;
+        }
+    }
+    return 0;
+}
+
+void test_outdoor_transfer_simulated_peer() {
+    // Test a backfill batch moves in one write at the large MTU instead of a fragment per event
+    OutdoorSample samples[OUTDOOR_BATCH_MAX];
+    fillOutdoorSamples(samples, OUTDOOR_BATCH_MAX);
+    uint8_t frame[OUTDOOR_FRAME_MAX_SIZE];
+    size_t length = encodeOutdoorBatch(frame, sizeof(frame), 1, samples, OUTDOOR_BATCH_MAX);
+    static OutdoorReassembler reassembler;
+    static OutdoorBatch batch;
+    
+    SimulatedPeer small = {23, 30};
+    OutdoorTransferMeter smallMeter;
+    uint32_t smallMs = transferBatch(small, frame, length, reassembler, smallMeter, batch);
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAGMENT_MAX_COUNT * small.intervalMs, smallMs);
+    TEST_ASSERT_EQUAL(OUTDOOR_FRAGMENT_MAX_COUNT, smallMeter.fragments);
+    TEST_ASSERT_EQUAL(1, smallMeter.batches);
+    TEST_ASSERT_EQUAL((OUTDOOR_FRAGMENT_MAX_COUNT - 1) * small.intervalMs, smallMeter.batchLatencyMs.getMax());
+    TEST_ASSERT_EQUAL(length * 1000 / ((OUTDOOR_FRAGMENT_MAX_COUNT - 1) * small.intervalMs),
+                      smallMeter.lastBytesPerSecond);
+    
+    SimulatedPeer large = {BLE_PREFERRED_MTU, 30};
+    OutdoorTransferMeter largeMeter;
+    uint32_t largeMs = transferBatch(large, frame, length, reassembler, largeMeter, batch);
+    TEST_ASSERT_EQUAL(large.intervalMs, largeMs);
+    TEST_ASSERT_EQUAL(1, largeMeter.writes);
+    TEST_ASSERT_EQUAL(0, largeMeter.fragments);
+    TEST_ASSERT_EQUAL(OUTDOOR_BATCH_MAX, batch.count);
+    
+    Serial.printf("Outdoor %u-byte batch at 30 ms interval: MTU 23 %lu ms (%lu B/s, %lu writes), "
+                  "MTU %u %lu ms (%lu B/s, 1 write)\n",
+                  (unsigned)length, (unsigned long)smallMs, (unsigned long)(length * 1000 / smallMs),
+                  (unsigned long)smallMeter.writes, (unsigned)BLE_PREFERRED_MTU,
+                  (unsigned long)largeMs, (unsigned long)(length * 1000 / largeMs));
+    TEST_ASSERT_TRUE(largeMs * 10 <= smallMs);
+}
+
+void test_outdoor_sequence_order() {
+    // Test resent samples are duplicates, gaps are counted and wrapped counters stay in order
+    uint32_t lost;
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_NEW, classifyOutdoorSequence(0, 57, 256, lost));
+    TEST_ASSERT_EQUAL(0, lost);
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_NEW, classifyOutdoorSequence(57, 58, 256, lost));
+    TEST_ASSERT_EQUAL(0, lost);
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_NEW, classifyOutdoorSequence(58, 62, 256, lost));
+    TEST_ASSERT_EQUAL(3, lost);
+    
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_DUPLICATE, classifyOutdoorSequence(62, 62, 256, lost));
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_DUPLICATE, classifyOutdoorSequence(62, 30, 256, lost));
+    TEST_ASSERT_EQUAL(0, lost);
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_DUPLICATE, classifyOutdoorSequence(1, 1, 256, lost));
+    
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_NEW, classifyOutdoorSequence(0xFFFFFFFEu, 0xFFFFFFFFu, 256, lost));
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_NEW, classifyOutdoorSequence(0xFFFFFFFFu, 2, 256, lost));
+    TEST_ASSERT_EQUAL(2, lost);  // 0 and 1 skipped across the wrap
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_DUPLICATE, classifyOutdoorSequence(3, 0xFFFFFFF0u, 256, lost));
+}
+
+void test_outdoor_sequence_restart() {
+    // Test a rebooted station is recognised even when its old count was small
+    uint32_t lost;
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_RESTART, classifyOutdoorSequence(40, OUTDOOR_SEQUENCE_FIRST, 256, lost));
+    TEST_ASSERT_EQUAL(0, lost);
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_RESTART, classifyOutdoorSequence(2, OUTDOOR_SEQUENCE_FIRST, 256, lost));
+    TEST_ASSERT_EQUAL(OUTDOOR_SEQUENCE_RESTART, classifyOutdoorSequence(100000, 5, 256, lost));
+    
+    // A rebooted station's batch is taken whole, none of it dropped as resent
+    uint32_t last = 40;
+    uint8_t accepted = 0;
+    for (uint32_t remote = OUTDOOR_SEQUENCE_FIRST; remote < OUTDOOR_SEQUENCE_FIRST + 5; remote++) {
+        if (classifyOutdoorSequence(last, remote, 256, lost) != OUTDOOR_SEQUENCE_DUPLICATE) {
+            last = remote;
+            accepted++;
+        }
+    }
+    TEST_ASSERT_EQUAL(5, accepted);
+    TEST_ASSERT_EQUAL(5, last);
+}
+
+// ===== INDOOR NOTIFY TESTS =====
+
+void test_indoor_snapshot_roundtrip() {
+    // Test the notified snapshot decodes to the readings at wire precision
+    IndoorSnapshot snapshot = {1234, -3.456f, 45.67f, 1013.25f, 87, 3};
+    uint8_t payload[INDOOR_SNAPSHOT_SIZE];
+    encodeIndoorSnapshot(payload, snapshot);
+    
+    IndoorSnapshot decoded;
+    TEST_ASSERT_TRUE(decodeIndoorSnapshot(payload, sizeof(payload), decoded));
+    TEST_ASSERT_EQUAL(1234, decoded.sequence);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, -3.46f, decoded.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, 45.67f, decoded.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 1013.3f, decoded.pressure);
+    TEST_ASSERT_EQUAL(87, decoded.iaq);
+    TEST_ASSERT_EQUAL(3, decoded.iaqAccuracy);
+    
+    TEST_ASSERT_FALSE(decodeIndoorSnapshot(payload, sizeof(payload) - 1, decoded));
+    payload[0] = INDOOR_SNAPSHOT_VERSION + 1;
+    TEST_ASSERT_FALSE(decodeIndoorSnapshot(payload, sizeof(payload), decoded));
+}
+
+void test_deadband_filter() {
+    // Test only changes past the deadband are published, drift included
+    IndoorDeadband band = {0.2f, 1.0f, 0.5f, 10.0f};
+    DeadbandFilter filter(band);
+    IndoorSnapshot snapshot = {1, 21.0f, 40.0f, 1010.0f, 50, 3};
+    TEST_ASSERT_TRUE(filter.update(snapshot));  // First reading always goes out
+    
+    snapshot.temperature = 21.1f;
+    snapshot.humidity = 40.5f;
+    snapshot.iaq = 55;
+    TEST_ASSERT_FALSE(filter.update(snapshot));
+    snapshot.temperature = 21.25f;  // Small steps add up against the last published value
+    TEST_ASSERT_TRUE(filter.update(snapshot));
+    TEST_ASSERT_EQUAL_FLOAT(21.25f, filter.getPublished().temperature);
+    
+    snapshot.pressure = 1009.4f;
+    TEST_ASSERT_TRUE(filter.update(snapshot));
+    snapshot.iaqAccuracy = 2;
+    TEST_ASSERT_TRUE(filter.update(snapshot));
+    
+    // A steady room sends nothing
+    for (uint32_t i = 0; i < 100; i++) {
+        snapshot.sequence++;
+        snapshot.temperature = 21.25f + (i % 2 ? 0.1f : -0.1f);
+        filter.update(snapshot);
+    }
+    TEST_ASSERT_EQUAL(4, filter.getPassed());
+    TEST_ASSERT_EQUAL(101, filter.getSuppressed());
+}
+
+// ===== LINK METRICS TESTS =====
+
+void test_link_metrics_jitter() {
+    // Test mean, jitter and range of the write intervals
+    LinkMetrics metrics;
+    const uint32_t intervals[] = {60000, 61000, 59000, 60000, 62000, 58000};
+    uint32_t now = 1000;
+    metrics.record(now, 3, 3, 3);
+    for (uint8_t i = 0; i < 6; i++) {
+        now += intervals[i];
+        TEST_ASSERT_EQUAL(0, metrics.record(now, 3, 3, 3));
+    }
+    TEST_ASSERT_EQUAL(7, metrics.getArrivals());
+    TEST_ASSERT_EQUAL(60000, metrics.getMeanMs());
+    TEST_ASSERT_UINT32_WITHIN(2, 1414, metrics.getJitterMs());  // Sample standard deviation
+    TEST_ASSERT_EQUAL(58000, metrics.getMinMs());
+    TEST_ASSERT_EQUAL(62000, metrics.getMaxMs());
+}
+
+void test_link_metrics_gaps() {
+    // Test an outage is counted as a gap and kept out of the cadence
+    LinkMetrics metrics;
+    uint32_t now = 0;
+    metrics.record(now, 3, 3, 3);
+    for (uint8_t i = 0; i < 3; i++) {
+        now += 10000;
+        metrics.record(now, 3, 3, 3);
+    }
+    now += 45000;
+    TEST_ASSERT_EQUAL(45000, metrics.record(now, 3, 3, 3));
+    now += 10000;
+    TEST_ASSERT_EQUAL(0, metrics.record(now, 3, 3, 3));
+    TEST_ASSERT_EQUAL(1, metrics.getGaps());
+    TEST_ASSERT_EQUAL(45000, metrics.getLongestGapMs());
+    TEST_ASSERT_EQUAL(10000, metrics.getMeanMs());
+    TEST_ASSERT_EQUAL(0, metrics.getJitterMs());
+    
+    // Gaps are only judged once the cadence is known
+    LinkMetrics fresh;
+    fresh.record(0, 3, 3, 3);
+    fresh.record(10000, 3, 3, 3);
+    TEST_ASSERT_EQUAL(0, fresh.record(100000, 3, 3, 3));
+}
+
+void test_link_metrics_cadence_change() {
+    // Test a station that settles on a slower cadence is re-learnt instead of gapping forever
+    LinkMetrics metrics;
+    uint32_t now = 0;
+    metrics.record(now, 3, 3, 3);
+    for (uint8_t i = 0; i < 5; i++) {
+        now += 10000;
+        metrics.record(now, 3, 3, 3);
+    }
+    
+    // E.g. a switch to the low power profile: every write now comes 60 s apart
+    now += 60000;
+    TEST_ASSERT_EQUAL(60000, metrics.record(now, 3, 3, 3));
+    now += 60000;
+    TEST_ASSERT_EQUAL(60000, metrics.record(now, 3, 3, 3));
+    now += 60000;
+    TEST_ASSERT_EQUAL(0, metrics.record(now, 3, 3, 3));  // Third in a row: the new rhythm
+    TEST_ASSERT_EQUAL(2, metrics.getGaps());
+    TEST_ASSERT_EQUAL(60000, metrics.getMeanMs());
+    
+    for (uint8_t i = 0; i < 10; i++) {
+        now += 60000;
+        TEST_ASSERT_EQUAL(0, metrics.record(now, 3, 3, 3));
+    }
+    TEST_ASSERT_EQUAL(2, metrics.getGaps());
+    TEST_ASSERT_EQUAL(60000, metrics.getMeanMs());
+    TEST_ASSERT_EQUAL(60000, metrics.getMinMs());
+    TEST_ASSERT_EQUAL(LINK_FRESH_OK, metrics.freshness(now + 100000, 300000));
+    
+    // Outages on the new cadence are gaps again, and a normal write ends the run
+    now += 200000;
+    TEST_ASSERT_EQUAL(200000, metrics.record(now, 3, 3, 3));
+    now += 60000;
+    TEST_ASSERT_EQUAL(0, metrics.record(now, 3, 3, 3));
+    now += 200000;
+    TEST_ASSERT_EQUAL(200000, metrics.record(now, 3, 3, 3));
+    TEST_ASSERT_EQUAL(4, metrics.getGaps());
+}
+
+void test_link_freshness() {
+    // Test the freshness state follows the age of the last write
+    LinkMetrics metrics;
+    TEST_ASSERT_EQUAL(LINK_FRESH_NONE, metrics.freshness(5000, 300000));
+    metrics.record(0, 3, 3, 3);
+    TEST_ASSERT_EQUAL(LINK_FRESH_OK, metrics.freshness(200000, 300000));  // No cadence yet, only staleness
+    metrics.record(60000, 3, 3, 3);
+    TEST_ASSERT_EQUAL(LINK_FRESH_OK, metrics.freshness(60000 + 100000, 300000));
+    TEST_ASSERT_EQUAL(LINK_FRESH_LATE, metrics.freshness(60000 + 130000, 300000));
+    TEST_ASSERT_EQUAL(LINK_FRESH_STALE, metrics.freshness(60000 + 300001, 300000));
+    TEST_ASSERT_EQUAL(300001, metrics.getAgeMs(60000 + 300001));
+    TEST_ASSERT_EQUAL_STRING("late", linkFreshnessName(LINK_FRESH_LATE));
+}
+
+// ===== BLE PROFILE TESTS =====
+
+void test_ble_profile_lookup() {
+    // Test stored profile names map back to their profile
+    BleProfile profile = BLE_PROFILE_BALANCED;
+    TEST_ASSERT_TRUE(bleProfileFromName("low_power", profile));
+    TEST_ASSERT_EQUAL(BLE_PROFILE_LOW_POWER, profile);
+    TEST_ASSERT_FALSE(bleProfileFromName("turbo", profile));
+    TEST_ASSERT_EQUAL(BLE_PROFILE_LOW_POWER, profile);
+    for (uint8_t i = 0; i < BLE_PROFILE_COUNT; i++) {
+        TEST_ASSERT_TRUE(bleProfileFromName(BLE_PROFILES[i].name, profile));
+        TEST_ASSERT_EQUAL(i, profile);
+    }
+    TEST_ASSERT_EQUAL_STRING("balanced", bleProfileSettings((BleProfile)7).name);
+}
+
+void test_ble_profile_parameters_valid() {
+    // Test every profile stays within what the Bluetooth spec lets a controller accept
+    for (uint8_t i = 0; i < BLE_PROFILE_COUNT; i++) {
+        const BleProfileSettings& profile = BLE_PROFILES[i];
+        TEST_ASSERT_TRUE(profile.advMin >= 32 && profile.advMin <= profile.advMax && profile.advMax <= 16384);
+        TEST_ASSERT_TRUE(profile.connMin >= 6 && profile.connMin <= profile.connMax && profile.connMax <= 3200);
+        TEST_ASSERT_TRUE(profile.latency <= 499);
+        TEST_ASSERT_TRUE(profile.timeout >= 10 && profile.timeout <= 3200);
+        // Supervision timeout must outlast the skipped events with margin
+        TEST_ASSERT_TRUE(profile.timeout * 10.0f > bleConnIntervalMs(profile.connMax) * (1 + profile.latency) * 2);
+        TEST_ASSERT_TRUE(profile.txPowerDbm >= -12 && profile.txPowerDbm <= 9 && (profile.txPowerDbm + 12) % 3 == 0);
+    }
+}
+
+void test_ble_profile_current_estimate() {
+    // Test the current estimates rank the profiles as intended
+    const BleProfileSettings& fast = bleProfileSettings(BLE_PROFILE_LOW_LATENCY);
+    const BleProfileSettings& balanced = bleProfileSettings(BLE_PROFILE_BALANCED);
+    const BleProfileSettings& slow = bleProfileSettings(BLE_PROFILE_LOW_POWER);
+    TEST_ASSERT_TRUE(bleAdvertisingCurrentUa(fast) > bleAdvertisingCurrentUa(balanced));
+    TEST_ASSERT_TRUE(bleAdvertisingCurrentUa(balanced) > bleAdvertisingCurrentUa(slow));
+    TEST_ASSERT_TRUE(bleConnectedCurrentUa(fast) > bleConnectedCurrentUa(balanced));
+    TEST_ASSERT_TRUE(bleConnectedCurrentUa(balanced) > bleConnectedCurrentUa(slow));
+    
+    // Advertising every 30 ms at +9 dBm costs a few milliamps on average
+    TEST_ASSERT_UINT32_WITHIN(2000, 6000, bleAdvertisingCurrentUa(fast));
+    TEST_ASSERT_TRUE(bleAdvertisingCurrentUa(slow) < 500);
+    
+    Serial.printf("BLE profile estimates (advertising / per connection): %s %lu/%lu uA, %s %lu/%lu uA, %s %lu/%lu uA\n",
+                  fast.name, (unsigned long)bleAdvertisingCurrentUa(fast), (unsigned long)bleConnectedCurrentUa(fast),
+                  balanced.name, (unsigned long)bleAdvertisingCurrentUa(balanced), (unsigned long)bleConnectedCurrentUa(balanced),
+                  slow.name, (unsigned long)bleAdvertisingCurrentUa(slow), (unsigned long)bleConnectedCurrentUa(slow));
+}
+
+// ===== MEASUREMENT STORE TESTS =====
+
+void test_measurement_store_versions() {
+    // Test writes move the channel and store versions
+    MeasurementStore store;
+    TEST_ASSERT_FALSE(store.has(CH_INDOOR_TEMPERATURE));
+    TEST_ASSERT_EQUAL(0, store.getVersion());
+    TEST_ASSERT_EQUAL(0, store.get(CH_INDOOR_TEMPERATURE).version);
+    
+    store.write(CH_INDOOR_TEMPERATURE, 21.5f, 1000);
+    store.write(CH_INDOOR_TEMPERATURE, 21.75f, 2000);
+    store.write(CH_OUTDOOR_HUMIDITY, 64.0f, 1500);
+    Measurement temperature = store.get(CH_INDOOR_TEMPERATURE);
+    TEST_ASSERT_TRUE(store.has(CH_INDOOR_TEMPERATURE));
+    TEST_ASSERT_EQUAL_FLOAT(21.75f, temperature.value);
+    TEST_ASSERT_EQUAL(2000, temperature.timestampMs);
+    TEST_ASSERT_EQUAL(2, temperature.version);
+    TEST_ASSERT_EQUAL(1, store.get(CH_OUTDOOR_HUMIDITY).version);
+    TEST_ASSERT_EQUAL(3, store.getVersion());
+    
+    // Reads are copies, a later write does not change one already taken
+    store.write(CH_INDOOR_TEMPERATURE, 22.0f, 3000);
+    TEST_ASSERT_EQUAL_FLOAT(21.75f, temperature.value);
+    TEST_ASSERT_EQUAL_FLOAT(22.0f, store.value(CH_INDOOR_TEMPERATURE));
+    TEST_ASSERT_EQUAL(3, store.get(CH_INDOOR_TEMPERATURE).version);
+}
+
+void test_channel_table() {
+    // Test every channel has a unique API path, a sensible precision and lies within its group
+    char path[32];
+    char other[32];
+    for (uint8_t i = 0; i < CHANNEL_COUNT; i++) {
+        const ChannelGroupInfo& group = CHANNEL_GROUPS[CHANNELS[i].group];
+        TEST_ASSERT_TRUE(i >= group.first && i < group.end);
+        TEST_ASSERT_NOT_NULL(CHANNELS[i].label);
+        TEST_ASSERT_NOT_NULL(CHANNELS[i].unit);
+        TEST_ASSERT_TRUE(CHANNELS[i].precision <= 3);
+        formatChannelPath(path, sizeof(path), (ChannelId)i);
+        for (uint8_t j = i + 1; j < CHANNEL_COUNT; j++) {
+            formatChannelPath(other, sizeof(other), (ChannelId)j);
+            TEST_ASSERT_TRUE(strcmp(path, other) != 0);
+        }
+    }
+    formatChannelPath(path, sizeof(path), CH_OUTDOOR_BATTERY_PERCENTAGE);
+    TEST_ASSERT_EQUAL_STRING("outdoor.battery_percentage", path);
+}
+
+void test_channel_formatting() {
+    // Test values are printed at their channel's precision
+    MeasurementStore store;
+    char text[16];
+    formatChannel(text, sizeof(text), store, CH_INDOOR_TEMPERATURE);
+    TEST_ASSERT_EQUAL_STRING("--", text);
+    
+    store.write(CH_INDOOR_TEMPERATURE, 21.347f, 0);
+    store.write(CH_INDOOR_IAQ, 87.4f, 0);
+    store.write(CH_OUTDOOR_BATTERY_VOLTAGE, 3.91249f, 0);
+    formatChannel(text, sizeof(text), store, CH_INDOOR_TEMPERATURE);
+    TEST_ASSERT_EQUAL_STRING("21.35 °C", text);
+    formatChannel(text, sizeof(text), store, CH_INDOOR_IAQ);
+    TEST_ASSERT_EQUAL_STRING("87", text);
+    formatChannel(text, sizeof(text), store, CH_OUTDOOR_BATTERY_VOLTAGE);
+    TEST_ASSERT_EQUAL_STRING("3.912 V", text);
+}
+
+// ===== EVENT BUS TESTS =====
+
+static Event receivedEvents[8];
+static uint8_t receivedCount = 0;
+static uint8_t displayCalls = 0;
+
+static void recordEvent(const Event& event) {
+    if (receivedCount < 8) receivedEvents[receivedCount] = event;
+    receivedCount++;
+}
+
+static void countDisplayEvent(const Event&) {
+    displayCalls++;
+}
+
+void test_event_bus_publish() {
+    // Test events reach only subscribers whose mask includes them, in subscription order
+    EventBus<2, 4> bus;
+    receivedCount = 0;
+    displayCalls = 0;
+    TEST_ASSERT_TRUE(bus.subscribe(EVENT_MASK(EVENT_INDOOR_SAMPLE) | EVENT_MASK(EVENT_OUTDOOR_SAMPLE), recordEvent));
+    TEST_ASSERT_TRUE(bus.subscribe(EVENT_MASK(EVENT_TIME_MINUTE), countDisplayEvent));
+    TEST_ASSERT_FALSE(bus.subscribe(EVENT_MASK_ALL, countDisplayEvent));
+    
+    bus.publish(makeEvent(EVENT_INDOOR_SAMPLE, 0, 12, 3000));
+    bus.publish(makeMinuteEvent(0, 60000));
+    bus.publish(makeEvent(EVENT_TIME_SYNC, 0, 0, 61000));
+    TEST_ASSERT_EQUAL(1, receivedCount);
+    TEST_ASSERT_EQUAL(EVENT_INDOOR_SAMPLE, receivedEvents[0].type);
+    TEST_ASSERT_EQUAL(12, receivedEvents[0].sequence);
+    TEST_ASSERT_EQUAL(3000, receivedEvents[0].timestampMs);
+    TEST_ASSERT_EQUAL(1, displayCalls);
+    TEST_ASSERT_EQUAL(1, bus.getStats().published[EVENT_TIME_SYNC]);
+    TEST_ASSERT_EQUAL(2, bus.getStats().deliveries);
+}
+
+void test_event_bus_posted() {
+    // Test posted events wait for dispatch, keep their order and are dropped when the queue is full
+    EventBus<1, 4> bus;
+    receivedCount = 0;
+    bus.subscribe(EVENT_MASK_ALL, recordEvent);
+    for (uint8_t slot = 0; slot < 5; slot++) {
+        bus.post(EVENT_PRODUCER_BLE, makeEvent(EVENT_OUTDOOR_SAMPLE, slot, 100 + slot, 0));
+    }
+    TEST_ASSERT_EQUAL(0, receivedCount);
+    TEST_ASSERT_EQUAL(4, bus.getPending());
+    TEST_ASSERT_EQUAL(1, bus.getDropped());
+    
+    // Each producer has its own queue, so a full one does not block another
+    TEST_ASSERT_TRUE(bus.post(EVENT_PRODUCER_NETWORK, makeMinuteEvent(754, 0)));
+    
+    TEST_ASSERT_EQUAL(5, bus.dispatch());
+    TEST_ASSERT_EQUAL(5, receivedCount);
+    for (uint8_t i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(i, receivedEvents[i].source);
+        TEST_ASSERT_EQUAL(100 + i, receivedEvents[i].sequence);
+    }
+    TEST_ASSERT_EQUAL(EVENT_TIME_MINUTE, receivedEvents[4].type);
+    TEST_ASSERT_EQUAL(754, receivedEvents[4].minute);
+    TEST_ASSERT_EQUAL(0, bus.dispatch());
+    TEST_ASSERT_EQUAL(4, bus.getStats().published[EVENT_OUTDOOR_SAMPLE]);
+}
+
+// ===== DISPLAY TESTS =====
+
+void test_display_change_at_drawn_precision() {
+    // Test only changes that show on screen count, at the precision each value is drawn
+    DisplayData shown = DisplayData();
+    shown.values[CH_INDOOR_TEMPERATURE] = 22.54f;
+    shown.values[CH_INDOOR_HUMIDITY] = 45.9f;
+    shown.values[CH_INDOOR_IAQ] = 50;
+    shown.values[CH_INDOOR_IAQ_ACCURACY] = 3;
+    shown.values[CH_OUTDOOR_TEMPERATURE] = -3.26f;
+    shown.values[CH_OUTDOOR_HUMIDITY] = 80.2f;
+    shown.values[CH_OUTDOOR_PRESSURE] = 1013.4f;
+    shown.values[CH_OUTDOOR_BATTERY_VOLTAGE] = 3.91f;
+    shown.values[CH_OUTDOOR_BATTERY_PERCENTAGE] = 87.0f;
+    shown.stationCount = 1;
+    DisplayData next = shown;
+    TEST_ASSERT_FALSE(isDisplayedDifferently(next, shown));
+    
+    next.values[CH_INDOOR_TEMPERATURE] = 22.51f;    // Still 22.5
+    next.values[CH_INDOOR_HUMIDITY] = 45.1f;        // Still 45
+    next.values[CH_OUTDOOR_TEMPERATURE] = -3.29f;   // Still -3.3
+    next.values[CH_OUTDOOR_PRESSURE] = 1013.9f;     // Still 1013
+    next.values[CH_OUTDOOR_BATTERY_VOLTAGE] = 3.94f;  // Still 3.9
+    next.values[CH_INDOOR_PRESSURE] = 990.0f;       // Not on screen
+    TEST_ASSERT_FALSE(isDisplayedDifferently(next, shown));
+    
+    next = shown;
+    next.values[CH_INDOOR_TEMPERATURE] = 22.56f;
+    TEST_ASSERT_TRUE(isDisplayedDifferently(next, shown));
+    next = shown;
+    next.values[CH_INDOOR_HUMIDITY] = 46.0f;
+    TEST_ASSERT_TRUE(isDisplayedDifferently(next, shown));
+    next = shown;
+    next.values[CH_INDOOR_IAQ] = 51;
+    TEST_ASSERT_TRUE(isDisplayedDifferently(next, shown));
+    next = shown;
+    next.outdoorStaleMin = 1;
+    TEST_ASSERT_TRUE(isDisplayedDifferently(next, shown));
+    next = shown;
+    next.station = 1;
+    TEST_ASSERT_TRUE(isDisplayedDifferently(next, shown));
+}
+
+// ===== TASK LAYOUT TESTS =====
+
+struct HandoffItem {
+    uint32_t sequence;
+    uint32_t check;  // ~sequence, catches a torn copy
+};
+
+static SpscQueue<HandoffItem, 16> crossCoreQueue;
+static volatile bool crossCoreProducerDone = false;
+static const uint32_t CROSS_CORE_ITEMS = 5000;
+
+static void crossCoreProducer(void*) {
+    for (uint32_t i = 1; i <= CROSS_CORE_ITEMS; i++) {
+        HandoffItem item = {i, ~i};
+        while (!crossCoreQueue.push(item)) {
+            vTaskDelay(1);
+        }
+    }
+    crossCoreProducerDone = true;
+    vTaskDelete(nullptr);
+}
+
+void test_cross_core_handoff() {
+    // Test items pushed on the network core arrive whole and in order on the other
+    crossCoreProducerDone = false;
+    xTaskCreatePinnedToCore(crossCoreProducer, "producer", 2048, nullptr, 1, nullptr, NETWORK_TASK_CORE);
+    
+    uint32_t expected = 1;
+    bool intact = true;
+    unsigned long start = millis();
+    while (expected <= CROSS_CORE_ITEMS && millis() - start < TEST_TIMEOUT_MS) {
+        HandoffItem item;
+        if (!crossCoreQueue.pop(item)) {
+            vTaskDelay(1);
+            continue;
+        }
+        if (item.sequence != expected || item.check != ~expected) intact = false;
+        expected++;
+    }
+    
+    TEST_ASSERT_TRUE(intact);
+    TEST_ASSERT_EQUAL(CROSS_CORE_ITEMS + 1, expected);
+    TEST_ASSERT_TRUE(crossCoreProducerDone);
+}
+
+struct SeqLockedSnapshot {
+    uint32_t sequence;
+    uint32_t words[24];  // All sequence * i, so a mix of two writes shows
+};
+
+static SeqLock<SeqLockedSnapshot> crossCoreSnapshot;
+static volatile bool snapshotWriterDone = false;
+
+static void snapshotWriter(void*) {
+    static SeqLockedSnapshot next;
+    for (uint32_t i = 1; i <= CROSS_CORE_ITEMS; i++) {
+        next.sequence = i;
+        for (uint8_t w = 0; w < 24; w++) next.words[w] = i * (w + 1);
+        crossCoreSnapshot.write(next);
+        if (i % 64 == 0) vTaskDelay(1);
+    }
+    snapshotWriterDone = true;
+    vTaskDelete(nullptr);
+}
+
+void test_cross_core_snapshot() {
+    // Test snapshots written on the network core are never read half-updated on the other
+    snapshotWriterDone = false;
+    xTaskCreatePinnedToCore(snapshotWriter, "writer", 2048, nullptr, 1, nullptr, NETWORK_TASK_CORE);
+    
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t last = 0;
+    bool ordered = true;
+    unsigned long start = millis();
+    while (!snapshotWriterDone && millis() - start < TEST_TIMEOUT_MS) {
+        SeqLockedSnapshot seen;
+        crossCoreSnapshot.read(seen);
+        for (uint8_t w = 0; w < 24; w++) {
+            if (seen.words[w] != seen.sequence * (w + 1)) {
+                torn++;
+                break;
+            }
+        }
+        if (seen.sequence < last) ordered = false;
+        last = seen.sequence;
+        reads++;
+    }
+    
+    TEST_ASSERT_TRUE(snapshotWriterDone);
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL(CROSS_CORE_ITEMS, crossCoreSnapshot.getWrites());
+    TEST_ASSERT_TRUE(reads > 0);
+}
+
+// Sensor-to-display latency of the old single loop and of the split layout,
+// with and without /api/status load. Both use the real schedulers and task
+// periods on simulated time, one clock per core: frames reach the UART on
+// their own cadence, a redraw costs as much as a full TFT update and a loaded
+// web poll serves a request whenever one is waiting. Latency runs from the
+// frame's arrival to the end of its redraw, like display.latency_us.
+static const uint32_t LAYOUT_FRAME_US = 1000037;  // Drifts through the whole poll period over the run
+static const uint32_t LAYOUT_FRAMES = 600;
+static const uint32_t LAYOUT_POLL_US = 300;
+static const uint32_t LAYOUT_REDRAW_US = 25000;
+static const uint32_t LAYOUT_WEB_IDLE_US = 50;
+static const uint32_t LAYOUT_STATUS_US = 45000;   // Full /api/status, under the web budget
+static const uint32_t LAYOUT_REQUEST_GAP_US = 100000;
+
+static uint32_t layoutSensingUs;
+static uint32_t layoutNetworkUs;
+static bool layoutSingleLoop;
+static bool layoutLoaded;
+static uint32_t layoutNextFrameUs;
+static uint32_t layoutNextRequestUs;
+static uint32_t layoutPendingFrameUs;
+static bool layoutDirty;
+static uint32_t layoutLastRedrawUs;
+static LogHistogram<24> layoutLatencyUs;
+
+static uint32_t layoutSensingClock() { return layoutSensingUs; }
+static uint32_t layoutNetworkClock() { return layoutNetworkUs; }
+
+static void layoutRedraw() {
+    layoutSensingUs += LAYOUT_REDRAW_US;
+    layoutLatencyUs.record(layoutSensingUs - layoutPendingFrameUs);
+    layoutDirty = false;
+    layoutLastRedrawUs = layoutSensingUs;
+}
+
+static void layoutSensorPoll() {
+    layoutSensingUs += LAYOUT_POLL_US;
+    if ((int32_t)(layoutSensingUs - layoutNextFrameUs) < 0) return;
+    if (!layoutDirty) layoutPendingFrameUs = layoutNextFrameUs;
+    layoutNextFrameUs += LAYOUT_FRAME_US;
+    layoutDirty = true;
+    // The old loop redrew from the indoor event, inside the poll
+    if (layoutSingleLoop) layoutRedraw();
+}
+
+static void layoutDisplay() {
+    if (!layoutDirty || layoutSensingUs - layoutLastRedrawUs < DISPLAY_MIN_REDRAW_MS * 1000) return;
+    layoutRedraw();
+}
+
+static void layoutWeb() {
+    uint32_t& now = layoutSingleLoop ? layoutSensingUs : layoutNetworkUs;
+    if (layoutLoaded && (int32_t)(now - layoutNextRequestUs) >= 0) {
+        now += LAYOUT_STATUS_US;
+        layoutNextRequestUs += LAYOUT_REQUEST_GAP_US;
+    } else {
+        now += LAYOUT_WEB_IDLE_US;
+    }
+}
+
+static void simulateLayout(bool singleLoop, bool loaded) {
+    layoutSensingUs = 0;
+    layoutNetworkUs = 0;
+    layoutSingleLoop = singleLoop;
+    layoutLoaded = loaded;
+    layoutNextFrameUs = LAYOUT_FRAME_US / 2;
+    layoutNextRequestUs = 0;
+    layoutDirty = false;
+    layoutLastRedrawUs = 0;
+    layoutLatencyUs.reset();
+    
+    TickScheduler<4> sensing(layoutSensingClock);
+    TickScheduler<4> network(layoutNetworkClock);
+    TickScheduler<4>& webCore = singleLoop ? sensing : network;
+    sensing.addTask("sensor", layoutSensorPoll, TASK_SENSOR_PERIOD_MS, TASK_SENSOR_DEADLINE_MS, TASK_SENSOR_BUDGET_US);
+    webCore.addTask("web", layoutWeb, TASK_WEB_PERIOD_MS, TASK_WEB_DEADLINE_MS, TASK_WEB_BUDGET_US);
+    if (!singleLoop) {
+        sensing.addTask("display", layoutDisplay, TASK_DISPLAY_PERIOD_MS, TASK_DISPLAY_DEADLINE_MS, TASK_DISPLAY_BUDGET_US);
+    }
+    
+    // Each core sleeps until its next task is due; the one further behind runs next
+    uint32_t end = LAYOUT_FRAME_US * LAYOUT_FRAMES;
+    while (layoutSensingUs < end) {
+        if (!singleLoop && layoutNetworkUs < layoutSensingUs) {
+            layoutNetworkUs += network.run();
+        } else {
+            layoutSensingUs += sensing.run();
+        }
+    }
+}
+
+void test_display_latency_under_web_load() {
+    // Test the split layout keeps sensor-to-display latency flat under web load, where the single loop's grows
+    struct LayoutResult { uint32_t count; uint32_t p99; uint32_t max; };
+    LayoutResult results[2][2];  // [split][loaded]
+    const char* names[2] = {"single loop", "split tasks"};
+    for (uint8_t split = 0; split < 2; split++) {
+        for (uint8_t loaded = 0; loaded < 2; loaded++) {
+            simulateLayout(!split, loaded);
+            results[split][loaded].count = layoutLatencyUs.getCount();
+            results[split][loaded].p99 = layoutLatencyUs.percentile(99);
+            results[split][loaded].max = layoutLatencyUs.getMax();
+            Serial.printf("Display latency, %s, %s: p99 <= %lu us, max %lu us over %lu frames\n",
+                          names[split], loaded ? "web load" : "idle",
+                          (unsigned long)results[split][loaded].p99, (unsigned long)results[split][loaded].max,
+                          (unsigned long)results[split][loaded].count);
+        }
+    }
+    
+    for (uint8_t split = 0; split < 2; split++) {
+        for (uint8_t loaded = 0; loaded < 2; loaded++) {
+            TEST_ASSERT_TRUE(results[split][loaded].count >= LAYOUT_FRAMES - 1);
+        }
+    }
+    // Web load only reaches the display when both share a loop
+    TEST_ASSERT_TRUE(results[0][1].max >= results[0][0].max + LAYOUT_STATUS_US / 2);
+    TEST_ASSERT_EQUAL(results[1][0].max, results[1][1].max);
+    TEST_ASSERT_TRUE(results[1][1].max < results[0][1].max);
+    TEST_ASSERT_TRUE(results[1][1].p99 < results[0][1].p99);
+    // A frame waits at most a sensor and a display period before it is drawn
+    TEST_ASSERT_TRUE(results[1][1].max <= (TASK_SENSOR_PERIOD_MS + TASK_DISPLAY_PERIOD_MS) * 1000 + LAYOUT_POLL_US + LAYOUT_REDRAW_US);
+}
+
+// ===== CONFIG STORE TESTS =====
+
+// Scratch namespace, so the tests never touch the station's configuration
+#define TEST_CONFIG_NAMESPACE "cfgtest"
+
+static void eraseTestConfig() {
+    nvs_handle_t handle;
+    if (nvs_open(TEST_CONFIG_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK) {
+        nvs_erase_all(handle);
+        nvs_commit(handle);
+        nvs_close(handle);
+    }
+}
+
+void test_config_store_round_trip() {
+    // Test saved values come back from NVS in a fresh store, unset keys keep defaults
+    eraseTestConfig();
+    ConfigStore store(TEST_CONFIG_NAMESPACE);
+    store.begin();
+    TEST_ASSERT_TRUE(store.isReady());
+    TEST_ASSERT_EQUAL_STRING(TIMEZONE_LOCATION, store.get().timezone.c_str());
+    
+    StationConfig updated = store.get();
+    updated.timezone = "Europe/Berlin";
+    updated.wifiSSID = "test-network";
+    updated.bleProfile = "low_power";
+    TEST_ASSERT_EQUAL(3, store.countChanges(updated));
+    TEST_ASSERT_TRUE(store.save(updated));
+    TEST_ASSERT_EQUAL(3, store.getStats().writes);
+    TEST_ASSERT_EQUAL(1, store.getStats().commits);
+    
+    ConfigStore reloaded(TEST_CONFIG_NAMESPACE);
+    reloaded.begin();
+    TEST_ASSERT_EQUAL_STRING("Europe/Berlin", reloaded.get().timezone.c_str());
+    TEST_ASSERT_EQUAL_STRING("test-network", reloaded.get().wifiSSID.c_str());
+    TEST_ASSERT_EQUAL_STRING("low_power", reloaded.get().bleProfile.c_str());
+    TEST_ASSERT_EQUAL_STRING(WIFI_HOSTNAME, reloaded.get().hostname.c_str());
+    TEST_ASSERT_EQUAL(0, reloaded.countChanges(updated));
+    eraseTestConfig();
+}
+
+void test_config_store_skips_unchanged() {
+    // Test an unchanged save touches no NVS key and commits nothing
+    eraseTestConfig();
+    ConfigStore store(TEST_CONFIG_NAMESPACE);
+    store.begin();
+    
+    StationConfig same = store.get();
+    TEST_ASSERT_TRUE(store.save(same));
+    TEST_ASSERT_EQUAL(0, store.getStats().writes);
+    TEST_ASSERT_EQUAL(0, store.getStats().commits);
+    
+    // Only the changed key is written
+    same.hostname = "station-2";
+    TEST_ASSERT_TRUE(store.save(same));
+    TEST_ASSERT_EQUAL(1, store.getStats().writes);
+    TEST_ASSERT_EQUAL(1, store.getStats().commits);
+    TEST_ASSERT_TRUE(store.save(same));
+    TEST_ASSERT_EQUAL(1, store.getStats().commits);
+    eraseTestConfig();
+}
+
 // ===== MAIN TEST RUNNER =====
 
 void runAllTests() {
@@ -371,6 +2406,9 @@ void runAllTests() {
     Serial.println("Running performance tests...");
     RUN_TEST(test_memory_management);
     RUN_TEST(test_large_json_handling);
+    RUN_TEST(test_field_selection);
+    RUN_TEST(test_field_group_rows);
+    RUN_TEST(test_field_projection_benchmark);
     
     // Error handling tests
     Serial.println("Running error handling tests...");
@@ -382,6 +2420,134 @@ void runAllTests() {
     RUN_TEST(test_data_flow_simulation);
     RUN_TEST(test_configuration_handling);
     
+    // Sample history tests
+    Serial.println("Running sample history tests...");
+    RUN_TEST(test_sample_sequence_monotonic);
+    RUN_TEST(test_sample_ring_since);
+    RUN_TEST(test_sample_ring_eviction);
+    
+    // History export tests
+    Serial.println("Running history export tests...");
+    RUN_TEST(test_history_row_format);
+    RUN_TEST(test_history_range_search);
+    RUN_TEST(test_history_export_throughput);
+    RUN_TEST(test_history_clock_step_back_survives_reboot);
+    
+    // Chart downsampling tests
+    Serial.println("Running chart downsampling tests...");
+    RUN_TEST(test_lttb_preserves_shape);
+    RUN_TEST(test_minmax_downsampling);
+    
+    // WiFi reconnect tests
+    Serial.println("Running WiFi reconnect tests...");
+    RUN_TEST(test_reconnect_backoff_growth);
+    RUN_TEST(test_reconnect_flapping_link);
+    RUN_TEST(test_reconnect_retry_now);
+    RUN_TEST(test_log_histogram_percentiles);
+    
+    // Time formatting tests
+    Serial.println("Running time formatting tests...");
+    RUN_TEST(test_time_cache_boundaries);
+    RUN_TEST(test_time_cache_read_cost);
+    RUN_TEST(test_retained_time_validation);
+    
+    // Scheduler tests
+    Serial.println("Running scheduler tests...");
+    RUN_TEST(test_scheduler_periods_and_idle);
+    RUN_TEST(test_scheduler_stall_recovery);
+    RUN_TEST(test_scheduler_latency_histograms);
+    RUN_TEST(test_scheduler_long_handler_duration);
+    RUN_TEST(test_scheduler_reset_by_own_pass);
+    
+    // Trace tests
+    Serial.println("Running trace tests...");
+    RUN_TEST(test_trace_ring_wraps_in_order);
+    RUN_TEST(test_trace_chrome_format);
+    RUN_TEST(test_trace_record_cost);
+    
+    // Heap telemetry tests
+    Serial.println("Running heap telemetry tests...");
+    RUN_TEST(test_alloc_tracker_attribution);
+    RUN_TEST(test_alloc_tracker_leak_simulation);
+    RUN_TEST(test_heap_fragmentation_percent);
+    
+    // Zero allocation tests
+    Serial.println("Running zero allocation tests...");
+    RUN_TEST(test_steady_state_loop_allocations);
+    RUN_TEST(test_json_arena_overflow_and_reset);
+    
+    // Logger tests
+    Serial.println("Running logger tests...");
+    RUN_TEST(test_log_record_formatting);
+    RUN_TEST(test_log_ring_overrun);
+    RUN_TEST(test_log_level_stripping);
+    RUN_TEST(test_log_call_cost);
+    
+    // Station registry tests
+    Serial.println("Running station registry tests...");
+    RUN_TEST(test_station_registry_lookup);
+    RUN_TEST(test_station_registry_full_and_eviction);
+    RUN_TEST(test_station_address_format);
+    
+    // Outdoor protocol tests
+    Serial.println("Running outdoor protocol tests...");
+    RUN_TEST(test_outdoor_batch_roundtrip);
+    RUN_TEST(test_outdoor_legacy_frame);
+    RUN_TEST(test_outdoor_frame_rejection);
+    RUN_TEST(test_outdoor_codec_benchmark);
+    RUN_TEST(test_spsc_queue_handoff);
+    
+    // Outdoor transfer tests
+    Serial.println("Running outdoor transfer tests...");
+    RUN_TEST(test_outdoor_fragment_reassembly);
+    RUN_TEST(test_outdoor_transfer_simulated_peer);
+    RUN_TEST(test_outdoor_sequence_order);
+    RUN_TEST(test_outdoor_sequence_restart);
+    
+    // Indoor notify tests
+    Serial.println("Running indoor notify tests...");
+    RUN_TEST(test_indoor_snapshot_roundtrip);
+    RUN_TEST(test_deadband_filter);
+    
+    // Link metrics tests
+    Serial.println("Running link metrics tests...");
+    RUN_TEST(test_link_metrics_jitter);
+    RUN_TEST(test_link_metrics_gaps);
+    RUN_TEST(test_link_metrics_cadence_change);
+    RUN_TEST(test_link_freshness);
+    
+    // BLE profile tests
+    Serial.println("Running BLE profile tests...");
+    RUN_TEST(test_ble_profile_lookup);
+    RUN_TEST(test_ble_profile_parameters_valid);
+    RUN_TEST(test_ble_profile_current_estimate);
+    
+    // Measurement store tests
+    Serial.println("Running measurement store tests...");
+    RUN_TEST(test_measurement_store_versions);
+    RUN_TEST(test_channel_table);
+    RUN_TEST(test_channel_formatting);
+    
+    // Event bus tests
+    Serial.println("Running event bus tests...");
+    RUN_TEST(test_event_bus_publish);
+    RUN_TEST(test_event_bus_posted);
+    
+    // Display tests
+    Serial.println("Running display tests...");
+    RUN_TEST(test_display_change_at_drawn_precision);
+    
+    // Task layout tests
+    Serial.println("Running task layout tests...");
+    RUN_TEST(test_cross_core_handoff);
+    RUN_TEST(test_cross_core_snapshot);
+    RUN_TEST(test_display_latency_under_web_load);
+    
+    // Config store tests
+    Serial.println("Running config store tests...");
+    RUN_TEST(test_config_store_round_trip);
+    RUN_TEST(test_config_store_skips_unchanged);
+    
     Serial.println("======================================================");
     Serial.println("All comprehensive tests completed!");
 }